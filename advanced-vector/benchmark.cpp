@@ -0,0 +1,495 @@
+// Сравнение скорости Vector и std::vector на Google Benchmark.
+// Сборка: g++ -std=c++17 -O2 -DNDEBUG benchmark.cpp -lbenchmark -lpthread -o benchmark
+// Запуск одной операции: ./benchmark --benchmark_filter=Insert
+#include "vector.h"
+#include "devector.h"
+#include "block_cache.h"
+#include "flat_map.h"
+#include "static_vector.h"
+#include "deferred_destroy.h"
+#include "vector_algorithms.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Pod64 {
+    std::array<uint64_t, 8> words{};
+};
+
+// Перемещение может выбросить исключение, поэтому при реаллокации
+// элементы копируются, как у Obj из main.cpp с throw_on_copy
+struct ThrowingCopy {
+    ThrowingCopy() = default;
+    ThrowingCopy(const ThrowingCopy& other)
+        : payload(other.payload)  //
+    {
+        if (other.throw_on_copy) {
+            throw std::runtime_error("Oops");
+        }
+    }
+    ThrowingCopy(ThrowingCopy&& other) noexcept(false)
+        : payload(std::move(other.payload))  //
+    {
+    }
+    ThrowingCopy& operator=(const ThrowingCopy& other) = default;
+    ThrowingCopy& operator=(ThrowingCopy&& other) = default;
+
+    bool throw_on_copy = false;
+    std::string payload = std::string(40, 'x');
+};
+
+template <typename T>
+T MakeValue() {
+    if constexpr (std::is_same_v<T, std::string>) {
+        return std::string(40, 'x');
+    } else {
+        return T{};
+    }
+}
+
+// Самый большой размер, который имеет смысл для элементов типа T:
+// не больше 10^8 элементов и не больше 1 ГБ данных
+template <typename T>
+constexpr int64_t MaxSize() {
+    constexpr int64_t max_bytes = int64_t{1} << 30;
+    constexpr int64_t element_bytes = std::is_same_v<T, std::string> || std::is_same_v<T, ThrowingCopy>
+        ? static_cast<int64_t>(sizeof(T)) + 48
+        : static_cast<int64_t>(sizeof(T));
+    return std::min<int64_t>(100'000'000, max_bytes / element_bytes);
+}
+
+// Одинаковый интерфейс к обоим контейнерам, чтобы каждый бенчмарк
+// измерял Vector и std::vector одним и тем же кодом
+template <typename T>
+void Reserve(Vector<T>& v, size_t n) {
+    v.Reserve(n);
+}
+
+template <typename T>
+void Reserve(std::vector<T>& v, size_t n) {
+    v.reserve(n);
+}
+
+template <typename T, typename V>
+void PushBack(Vector<T>& v, V&& value) {
+    v.PushBack(std::forward<V>(value));
+}
+
+template <typename T, typename V>
+void PushBack(std::vector<T>& v, V&& value) {
+    v.push_back(std::forward<V>(value));
+}
+
+template <typename T>
+void EmplaceBack(Vector<T>& v) {
+    v.EmplaceBack();
+}
+
+template <typename T>
+void EmplaceBack(std::vector<T>& v) {
+    v.emplace_back();
+}
+
+template <typename T>
+void PopBack(Vector<T>& v) {
+    v.PopBack();
+}
+
+template <typename T>
+void PopBack(std::vector<T>& v) {
+    v.pop_back();
+}
+
+template <typename T>
+void Insert(Vector<T>& v, size_t index, const T& value) {
+    v.Insert(v.begin() + index, value);
+}
+
+template <typename T>
+void Insert(std::vector<T>& v, size_t index, const T& value) {
+    v.insert(v.begin() + index, value);
+}
+
+template <typename T>
+void Emplace(Vector<T>& v, size_t index) {
+    v.Emplace(v.begin() + index);
+}
+
+template <typename T>
+void Emplace(std::vector<T>& v, size_t index) {
+    v.emplace(v.begin() + index);
+}
+
+template <typename T>
+void Erase(Vector<T>& v, size_t index) {
+    v.Erase(v.begin() + index);
+}
+
+template <typename T>
+void Erase(std::vector<T>& v, size_t index) {
+    v.erase(v.begin() + index);
+}
+
+template <typename T>
+void Resize(Vector<T>& v, size_t n) {
+    v.Resize(n);
+}
+
+template <typename T>
+void Resize(std::vector<T>& v, size_t n) {
+    v.resize(n);
+}
+
+template <typename T>
+size_t Size(const Vector<T>& v) {
+    return v.Size();
+}
+
+template <typename T>
+size_t Size(const std::vector<T>& v) {
+    return v.size();
+}
+
+template <typename Container>
+Container MakeFilled(size_t n) {
+    Container v;
+    Reserve(v, n);
+    for (size_t i = 0; i < n; ++i) {
+        PushBack(v, MakeValue<typename Container::value_type>());
+    }
+    return v;
+}
+
+void SetItems(benchmark::State& state, int64_t items_per_iteration) {
+    state.SetItemsProcessed(state.iterations() * items_per_iteration);
+}
+
+enum class Position { FRONT, MIDDLE, BACK };
+
+size_t IndexAt(Position position, size_t size) {
+    switch (position) {
+        case Position::FRONT:
+            return 0;
+        case Position::MIDDLE:
+            return size / 2;
+        case Position::BACK:
+            return size;
+    }
+    return size;
+}
+
+template <typename Container>
+void BM_PushBack(benchmark::State& state) {
+    const size_t n = state.range(0);
+    const auto value = MakeValue<typename Container::value_type>();
+    for (auto _ : state) {
+        Container v;
+        for (size_t i = 0; i < n; ++i) {
+            PushBack(v, value);
+        }
+        benchmark::DoNotOptimize(v);
+    }
+    SetItems(state, state.range(0));
+}
+
+template <typename Container>
+void BM_EmplaceBack(benchmark::State& state) {
+    const size_t n = state.range(0);
+    for (auto _ : state) {
+        Container v;
+        for (size_t i = 0; i < n; ++i) {
+            EmplaceBack(v);
+        }
+        benchmark::DoNotOptimize(v);
+    }
+    SetItems(state, state.range(0));
+}
+
+// Реаллокация заполненного вектора: перемещение или копирование всех элементов
+template <typename Container>
+void BM_Reserve(benchmark::State& state) {
+    const size_t n = state.range(0);
+    for (auto _ : state) {
+        state.PauseTiming();
+        Container v = MakeFilled<Container>(n);
+        state.ResumeTiming();
+        Reserve(v, n * 2);
+        benchmark::DoNotOptimize(v);
+        state.PauseTiming();
+        v = Container{};
+        state.ResumeTiming();
+    }
+    SetItems(state, state.range(0));
+}
+
+template <typename Container, Position position>
+void BM_Insert(benchmark::State& state) {
+    const size_t n = state.range(0);
+    const auto value = MakeValue<typename Container::value_type>();
+    Container v = MakeFilled<Container>(n);
+    Reserve(v, n + 1);
+    const size_t index = IndexAt(position, n);
+    for (auto _ : state) {
+        Insert(v, index, value);
+        PopBack(v);
+        benchmark::ClobberMemory();
+    }
+    SetItems(state, 1);
+}
+
+template <typename Container, Position position>
+void BM_Emplace(benchmark::State& state) {
+    const size_t n = state.range(0);
+    Container v = MakeFilled<Container>(n);
+    Reserve(v, n + 1);
+    const size_t index = IndexAt(position, n);
+    for (auto _ : state) {
+        Emplace(v, index);
+        PopBack(v);
+        benchmark::ClobberMemory();
+    }
+    SetItems(state, 1);
+}
+
+template <typename Container, Position position>
+void BM_Erase(benchmark::State& state) {
+    const size_t n = state.range(0);
+    const auto value = MakeValue<typename Container::value_type>();
+    Container v = MakeFilled<Container>(n);
+    const size_t index = std::min(IndexAt(position, n), n - 1);
+    for (auto _ : state) {
+        Erase(v, index);
+        PushBack(v, value);
+        benchmark::ClobberMemory();
+    }
+    SetItems(state, 1);
+}
+
+template <typename Container>
+void BM_CopyAssignment(benchmark::State& state) {
+    const size_t n = state.range(0);
+    const Container source = MakeFilled<Container>(n);
+    Container target;
+    for (auto _ : state) {
+        target = source;
+        benchmark::DoNotOptimize(target);
+    }
+    SetItems(state, state.range(0));
+}
+
+template <typename Container>
+void BM_Resize(benchmark::State& state) {
+    const size_t n = state.range(0);
+    for (auto _ : state) {
+        Container v;
+        Resize(v, n);
+        benchmark::DoNotOptimize(v);
+        Resize(v, 0);
+    }
+    SetItems(state, state.range(0));
+}
+
+// Скользящее окно из n элементов: удаление из начала и вставка в конец
+template <typename T>
+void SlideWindow(Vector<T>& v, const T& value) {
+    v.Erase(v.begin());
+    v.PushBack(value);
+}
+
+template <typename T>
+void SlideWindow(Devector<T>& v, const T& value) {
+    v.PopFront();
+    v.PushBack(value);
+}
+
+template <typename Container>
+void BM_SlidingWindow(benchmark::State& state) {
+    const size_t n = state.range(0);
+    const auto value = MakeValue<typename Container::value_type>();
+    Container v;
+    for (size_t i = 0; i < n; ++i) {
+        v.PushBack(value);
+    }
+    for (auto _ : state) {
+        SlideWindow(v, value);
+        benchmark::ClobberMemory();
+    }
+    SetItems(state, 1);
+}
+
+// Короткоживущие векторы одного размера, как в обработчиках запросов
+template <typename Alloc>
+void BM_ShortLived(benchmark::State& state) {
+    const size_t n = state.range(0);
+    for (auto _ : state) {
+        Vector<typename Alloc::value_type, Alloc> v;
+        for (size_t i = 0; i < n; ++i) {
+            v.EmplaceBack();
+        }
+        benchmark::DoNotOptimize(v);
+    }
+    SetItems(state, state.range(0));
+}
+
+// Поиск случайных ключей в таблице из n элементов
+int Lookup(const FlatMap<int, int>& map, int key) {
+    const int* value = map.Find(key);
+    return value == nullptr ? 0 : *value;
+}
+
+int Lookup(const std::map<int, int>& map, int key) {
+    const auto it = map.find(key);
+    return it == map.end() ? 0 : it->second;
+}
+
+template <typename Map>
+void BM_Lookup(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    Map map;
+    for (int i = 0; i < n; ++i) {
+        map[i * 2] = i;
+    }
+    Vector<int> keys(1024);
+    for (size_t i = 0; i < keys.Size(); ++i) {
+        keys[i] = static_cast<int>((i * 2654435761u) % (2 * n));
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Lookup(map, keys[i++ % keys.Size()]));
+    }
+    SetItems(state, 1);
+}
+
+// Временный буфер с известной верхней границей во внутреннем цикле:
+// в каждой итерации набирается не больше 16 элементов и сразу суммируется
+template <typename Buffer>
+void BM_BoundedScratch(benchmark::State& state) {
+    const size_t n = state.range(0);
+    for (auto _ : state) {
+        Buffer buffer;
+        for (size_t i = 0; i < n; ++i) {
+            buffer.EmplaceBack(static_cast<int>(i));
+        }
+        int sum = 0;
+        for (const int value : buffer) {
+            sum += value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    SetItems(state, state.range(0));
+}
+
+// Время, на которое поток останавливается, отпуская вектор из n строк.
+// Отложенному освобождению очередь разбирается вне замера
+template <bool kDefer>
+void BM_DropStrings(benchmark::State& state) {
+    const size_t n = state.range(0);
+    for (auto _ : state) {
+        state.PauseTiming();
+        Vector<std::string> strings(n);
+        for (size_t i = 0; i < n; ++i) {
+            strings[i] = std::string(32, 'x');
+        }
+        state.ResumeTiming();
+        if constexpr (kDefer) {
+            DeferDestroy(std::move(strings));
+        } else {
+            Vector<std::string> dropped(std::move(strings));
+        }
+        state.PauseTiming();
+        Reclaimer::Default().Drain();
+        state.ResumeTiming();
+    }
+}
+
+// Ядра vector_algorithms.h на заданном уровне SIMD, SCALAR для сравнения
+template <typename T, SimdLevel level>
+void BM_SimdScan(benchmark::State& state) {
+    SetSimdLevel(level);
+    const size_t n = state.range(0);
+    Vector<T, AlignedAllocator<T, 64>> v(n);
+    for (size_t i = 0; i < n; ++i) {
+        v[i] = static_cast<T>(i % 100);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Sum(v));
+        benchmark::DoNotOptimize(Count(v, T(5)));
+        benchmark::DoNotOptimize(Find(v, T(-1)));
+    }
+    SetSimdLevel(SimdLevel::AVX512);
+    SetItems(state, state.range(0));
+}
+
+}  // namespace
+
+// Каждый случай регистрируется парой Vector/std::vector, поэтому в отчёте
+// результаты двух контейнеров идут друг за другом
+#define BENCHMARK_PAIR(func, T, max_size)                                               \
+    BENCHMARK_TEMPLATE(func, Vector<T>)->RangeMultiplier(10)->Range(1, max_size);       \
+    BENCHMARK_TEMPLATE(func, std::vector<T>)->RangeMultiplier(10)->Range(1, max_size)
+
+#define BENCHMARK_POSITION_PAIR(func, T, position, max_size)                                      \
+    BENCHMARK_TEMPLATE(func, Vector<T>, position)->RangeMultiplier(10)->Range(1, max_size);       \
+    BENCHMARK_TEMPLATE(func, std::vector<T>, position)->RangeMultiplier(10)->Range(1, max_size)
+
+// Вставка и удаление из середины стоят O(N), поэтому для них размеры меньше
+#define BENCHMARK_ALL(T)                                                                     \
+    BENCHMARK_PAIR(BM_PushBack, T, MaxSize<T>());                                            \
+    BENCHMARK_PAIR(BM_EmplaceBack, T, MaxSize<T>());                                         \
+    BENCHMARK_PAIR(BM_Reserve, T, MaxSize<T>() / 2);                                         \
+    BENCHMARK_POSITION_PAIR(BM_Insert, T, Position::FRONT, MaxSize<T>() / 100);              \
+    BENCHMARK_POSITION_PAIR(BM_Insert, T, Position::MIDDLE, MaxSize<T>() / 100);             \
+    BENCHMARK_POSITION_PAIR(BM_Insert, T, Position::BACK, MaxSize<T>());                     \
+    BENCHMARK_POSITION_PAIR(BM_Emplace, T, Position::FRONT, MaxSize<T>() / 100);             \
+    BENCHMARK_POSITION_PAIR(BM_Emplace, T, Position::MIDDLE, MaxSize<T>() / 100);            \
+    BENCHMARK_POSITION_PAIR(BM_Emplace, T, Position::BACK, MaxSize<T>());                    \
+    BENCHMARK_POSITION_PAIR(BM_Erase, T, Position::FRONT, MaxSize<T>() / 100);               \
+    BENCHMARK_POSITION_PAIR(BM_Erase, T, Position::MIDDLE, MaxSize<T>() / 100);              \
+    BENCHMARK_POSITION_PAIR(BM_Erase, T, Position::BACK, MaxSize<T>());                      \
+    BENCHMARK_PAIR(BM_CopyAssignment, T, MaxSize<T>() / 2);                                  \
+    BENCHMARK_PAIR(BM_Resize, T, MaxSize<T>())
+
+BENCHMARK_ALL(int);
+BENCHMARK_ALL(std::string);
+BENCHMARK_ALL(Pod64);
+BENCHMARK_ALL(ThrowingCopy);
+
+#define BENCHMARK_SIMD(T)                                                                                 \
+    BENCHMARK_TEMPLATE(BM_SimdScan, T, SimdLevel::SCALAR)->RangeMultiplier(100)->Range(1000, 10'000'000); \
+    BENCHMARK_TEMPLATE(BM_SimdScan, T, SimdLevel::SSE2)->RangeMultiplier(100)->Range(1000, 10'000'000);   \
+    BENCHMARK_TEMPLATE(BM_SimdScan, T, SimdLevel::AVX2)->RangeMultiplier(100)->Range(1000, 10'000'000);   \
+    BENCHMARK_TEMPLATE(BM_SimdScan, T, SimdLevel::AVX512)->RangeMultiplier(100)->Range(1000, 10'000'000)
+
+BENCHMARK_SIMD(int32_t);
+BENCHMARK_SIMD(float);
+
+BENCHMARK_TEMPLATE(BM_ShortLived, std::allocator<int>)->RangeMultiplier(10)->Range(10, 100'000);
+BENCHMARK_TEMPLATE(BM_ShortLived, CachingAllocator<int>)->RangeMultiplier(10)->Range(10, 100'000);
+BENCHMARK_TEMPLATE(BM_ShortLived, std::allocator<std::string>)->RangeMultiplier(10)->Range(10, 10'000);
+BENCHMARK_TEMPLATE(BM_ShortLived, CachingAllocator<std::string>)->RangeMultiplier(10)->Range(10, 10'000);
+
+BENCHMARK_TEMPLATE(BM_Lookup, FlatMap<int, int>)->RangeMultiplier(10)->Range(10, 1'000'000);
+BENCHMARK_TEMPLATE(BM_Lookup, std::map<int, int>)->RangeMultiplier(10)->Range(10, 1'000'000);
+
+BENCHMARK_TEMPLATE(BM_BoundedScratch, Vector<int>)->Arg(4)->Arg(16);
+BENCHMARK_TEMPLATE(BM_BoundedScratch, SmallVector<int, 16>)->Arg(4)->Arg(16);
+BENCHMARK_TEMPLATE(BM_BoundedScratch, StaticVector<int, 16>)->Arg(4)->Arg(16);
+
+BENCHMARK_TEMPLATE(BM_DropStrings, false)->RangeMultiplier(10)->Range(1'000, 1'000'000);
+BENCHMARK_TEMPLATE(BM_DropStrings, true)->RangeMultiplier(10)->Range(1'000, 1'000'000);
+
+BENCHMARK_TEMPLATE(BM_SlidingWindow, Vector<int>)->RangeMultiplier(10)->Range(10, 100'000);
+BENCHMARK_TEMPLATE(BM_SlidingWindow, Devector<int>)->RangeMultiplier(10)->Range(10, 100'000);
+BENCHMARK_TEMPLATE(BM_SlidingWindow, Vector<std::string>)->RangeMultiplier(10)->Range(10, 100'000);
+BENCHMARK_TEMPLATE(BM_SlidingWindow, Devector<std::string>)->RangeMultiplier(10)->Range(10, 100'000);
+
+BENCHMARK_MAIN();
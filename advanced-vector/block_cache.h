@@ -0,0 +1,258 @@
+#pragma once
+
+#include "vector.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+// Per-thread counters of the block cache behind CachingAllocator
+struct BlockCacheStats {
+    // Allocations served from the cache and from operator new
+    size_t hits = 0;
+    size_t misses = 0;
+    // Freed blocks kept in the cache and given back to operator delete
+    size_t recycled = 0;
+    size_t released = 0;
+    size_t cached_blocks = 0;
+    size_t cached_bytes = 0;
+};
+
+namespace detail {
+
+// Free lists of blocks of 2^k bytes, one set per thread. A freed block
+// stores the list link in its own first bytes, so caching allocates nothing.
+// Blocks larger than the biggest class and blocks over the byte limit go
+// straight back to operator delete
+class BlockCache {
+public:
+    static constexpr size_t kMinClassBits = 4;
+    static constexpr size_t kMaxClassBits = 20;
+    static constexpr size_t kClassCount = kMaxClassBits - kMinClassBits + 1;
+    static constexpr size_t kDefaultLimitBytes = size_t{8} << 20;
+
+    BlockCache() = default;
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+    ~BlockCache();
+
+    // nullptr while the cache of the calling thread is being destroyed at thread exit
+    static BlockCache* ForThisThread() noexcept;
+    // Size of the class of a block of bytes, 0 if such blocks are not cached
+    static size_t ClassBytes(size_t bytes) noexcept;
+
+    // bytes must be ClassBytes of the request
+    void* Allocate(size_t bytes);
+    void Deallocate(void* p, size_t bytes) noexcept;
+    // Frees cached blocks, largest first, until at most max_bytes are cached
+    void Trim(size_t max_bytes) noexcept;
+    void SetLimit(size_t max_bytes) noexcept;
+    const BlockCacheStats& Stats() const noexcept;
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static size_t ClassIndex(size_t bytes) noexcept;
+
+    FreeBlock* free_[kClassCount] = {};
+    size_t limit_bytes_ = kDefaultLimitBytes;
+    BlockCacheStats stats_;
+};
+
+// Trivially destructible, so it can be read after the cache itself is gone
+inline thread_local bool block_cache_destroyed = false;
+
+}  // namespace detail
+
+// Counters of the calling thread
+inline BlockCacheStats GetBlockCacheStats() noexcept;
+// Gives cached blocks of the calling thread back to the heap until at most
+// max_bytes stay cached
+inline void TrimBlockCache(size_t max_bytes = 0) noexcept;
+// Bounds the bytes the calling thread keeps cached, trimming right away
+inline void SetBlockCacheLimit(size_t max_bytes) noexcept;
+
+// Allocator that recycles freed buffers through a per-thread, size-classed
+// cache before going to operator new. Capacities are rounded up to the size
+// class with allocate_at_least, so a vector gets the whole block and a
+// block freed by one vector fits the next vector of a similar size.
+// Blocks may be freed on another thread than the one that allocated them
+template <typename T>
+struct CachingAllocator {
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "operator new cannot satisfy alignment of T");
+
+    CachingAllocator() = default;
+    template <typename U>
+    CachingAllocator(const CachingAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n);
+    AllocationResult<T*> allocate_at_least(size_t n);
+    void deallocate(T* p, size_t n) noexcept;
+
+    friend bool operator==(const CachingAllocator&, const CachingAllocator&) noexcept { return true; }
+    friend bool operator!=(const CachingAllocator&, const CachingAllocator&) noexcept { return false; }
+};
+
+namespace detail {
+
+inline BlockCache::~BlockCache()
+{
+    block_cache_destroyed = true;
+    Trim(0);
+}
+
+inline BlockCache* BlockCache::ForThisThread() noexcept
+{
+    if (block_cache_destroyed)
+    {
+        return nullptr;
+    }
+    thread_local BlockCache cache;
+    return &cache;
+}
+
+inline size_t BlockCache::ClassBytes(size_t bytes) noexcept
+{
+    if (bytes > (size_t{1} << kMaxClassBits))
+    {
+        return 0;
+    }
+    if (bytes <= (size_t{1} << kMinClassBits))
+    {
+        return size_t{1} << kMinClassBits;
+    }
+    return size_t{1} << (64 - __builtin_clzll(static_cast<uint64_t>(bytes - 1)));
+}
+
+inline size_t BlockCache::ClassIndex(size_t bytes) noexcept
+{
+    return __builtin_ctzll(static_cast<uint64_t>(bytes)) - kMinClassBits;
+}
+
+inline void* BlockCache::Allocate(size_t bytes)
+{
+    FreeBlock*& head = free_[ClassIndex(bytes)];
+    if (head == nullptr)
+    {
+        ++stats_.misses;
+        return ::operator new(bytes);
+    }
+    FreeBlock* block = head;
+    head = block->next;
+    ++stats_.hits;
+    --stats_.cached_blocks;
+    stats_.cached_bytes -= bytes;
+    return block;
+}
+
+inline void BlockCache::Deallocate(void* p, size_t bytes) noexcept
+{
+    if (stats_.cached_bytes + bytes > limit_bytes_)
+    {
+        ++stats_.released;
+        ::operator delete(p);
+        return;
+    }
+    FreeBlock*& head = free_[ClassIndex(bytes)];
+    head = new (p) FreeBlock{head};
+    ++stats_.recycled;
+    ++stats_.cached_blocks;
+    stats_.cached_bytes += bytes;
+}
+
+inline void BlockCache::Trim(size_t max_bytes) noexcept
+{
+    for (size_t index = kClassCount; index-- > 0 && stats_.cached_bytes > max_bytes;)
+    {
+        const size_t bytes = size_t{1} << (index + kMinClassBits);
+        while (free_[index] != nullptr && stats_.cached_bytes > max_bytes)
+        {
+            FreeBlock* block = free_[index];
+            free_[index] = block->next;
+            ::operator delete(block);
+            --stats_.cached_blocks;
+            stats_.cached_bytes -= bytes;
+        }
+    }
+}
+
+inline void BlockCache::SetLimit(size_t max_bytes) noexcept
+{
+    limit_bytes_ = max_bytes;
+    Trim(max_bytes);
+}
+
+inline const BlockCacheStats& BlockCache::Stats() const noexcept
+{
+    return stats_;
+}
+
+}  // namespace detail
+
+inline BlockCacheStats GetBlockCacheStats() noexcept
+{
+    const detail::BlockCache* cache = detail::BlockCache::ForThisThread();
+    return cache == nullptr ? BlockCacheStats{} : cache->Stats();
+}
+
+inline void TrimBlockCache(size_t max_bytes) noexcept
+{
+    if (detail::BlockCache* cache = detail::BlockCache::ForThisThread())
+    {
+        cache->Trim(max_bytes);
+    }
+}
+
+inline void SetBlockCacheLimit(size_t max_bytes) noexcept
+{
+    if (detail::BlockCache* cache = detail::BlockCache::ForThisThread())
+    {
+        cache->SetLimit(max_bytes);
+    }
+}
+
+template<typename T>
+T* CachingAllocator<T>::allocate(size_t n)
+{
+    return allocate_at_least(n).ptr;
+}
+
+template<typename T>
+AllocationResult<T*> CachingAllocator<T>::allocate_at_least(size_t n)
+{
+    if (n > SIZE_MAX / sizeof(T))
+    {
+        throw std::bad_array_new_length();
+    }
+    const size_t bytes = detail::BlockCache::ClassBytes(n * sizeof(T));
+    if (bytes == 0)
+    {
+        return {static_cast<T*>(::operator new(n * sizeof(T))), n};
+    }
+    // The block always spans its whole class, even without a cache, since
+    // another thread may cache it when it is freed. More than half of the
+    // class is used by the returned count, so freeing it maps back to the
+    // same class
+    detail::BlockCache* cache = detail::BlockCache::ForThisThread();
+    void* p = cache == nullptr ? ::operator new(bytes) : cache->Allocate(bytes);
+    return {static_cast<T*>(p), bytes / sizeof(T)};
+}
+
+template<typename T>
+void CachingAllocator<T>::deallocate(T* p, size_t n) noexcept
+{
+    const size_t bytes = detail::BlockCache::ClassBytes(n * sizeof(T));
+    detail::BlockCache* cache = detail::BlockCache::ForThisThread();
+    if (bytes == 0 || cache == nullptr)
+    {
+        ::operator delete(p);
+        return;
+    }
+    cache->Deallocate(p, bytes);
+}
@@ -0,0 +1,458 @@
+#pragma once
+
+#include "vector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Vector stored as a Vector of fixed-size RawMemory chunks. Growth adds a
+// chunk and never moves elements, so EmplaceBack is O(1) in the worst case
+// apart from the occasional growth of the small chunk table, and pointers
+// to elements stay valid until the element is removed
+template <typename T, size_t ChunkSize = 1024, typename Alloc = std::allocator<T>>
+class ChunkedVector
+{
+    template <typename Vec, typename Value>
+    class Iterator;
+
+public:
+    using value_type = T;
+    using iterator = Iterator<ChunkedVector, T>;
+    using const_iterator = Iterator<const ChunkedVector, const T>;
+    using allocator_type = Alloc;
+
+    static_assert(ChunkSize > 0 && (ChunkSize & (ChunkSize - 1)) == 0, "ChunkSize must be a power of two");
+
+    ChunkedVector() = default;
+    explicit ChunkedVector(const Alloc& alloc);
+    ChunkedVector(const ChunkedVector& other);
+    ChunkedVector& operator=(const ChunkedVector& rhs);
+    ChunkedVector(ChunkedVector&& other) noexcept;
+    ChunkedVector& operator=(ChunkedVector&& rhs) noexcept;
+    ~ChunkedVector();
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+    const_iterator cbegin() const noexcept;
+    const_iterator cend() const noexcept;
+
+    size_t Size() const noexcept;
+    size_t Capacity() const noexcept;
+    size_t ChunkCount() const noexcept;
+    allocator_type GetAllocator() const noexcept;
+    // Allocates chunks up front. Existing elements stay where they are
+    void Reserve(size_t new_capacity);
+    // Destroys the elements and keeps the chunks
+    void Clear() noexcept;
+    const T& operator[](size_t index) const noexcept;
+    T& operator[](size_t index) noexcept;
+    void Swap(ChunkedVector& other) noexcept;
+    template<typename F>
+    void PushBack(F&& value);
+    void PopBack() noexcept;
+    template<typename... Ts>
+    T& EmplaceBack(Ts&&... vs);
+
+    // Calls f(T* first, size_t count) for the elements of every chunk in order
+    template <typename F>
+    void ForEachChunk(F&& f);
+    template <typename F>
+    void ForEachChunk(F&& f) const;
+    // The same with chunks spread over threads. f must be safe to call
+    // concurrently for different chunks. policy.threshold counts elements
+    template <typename F>
+    void ForEachChunk(const ParallelPolicy& policy, F&& f);
+    template <typename F>
+    void ForEachChunk(const ParallelPolicy& policy, F&& f) const;
+
+    // Copies the elements into one contiguous Vector
+    Vector<T, Alloc> Flatten() const&;
+    // Moves the elements into one contiguous Vector, freeing every chunk as
+    // soon as it is emptied, and leaves this vector empty
+    Vector<T, Alloc> Flatten() &&;
+
+private:
+    using Chunk = RawMemory<T, Alloc>;
+    using ChunkAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Chunk>;
+
+    static constexpr size_t kShift = __builtin_ctzll(ChunkSize);
+
+    // Number of elements in chunk index
+    size_t ChunkElements(size_t chunk) const noexcept;
+    template <typename Self, typename F>
+    static void ForEachChunk(Self& self, const ParallelPolicy& policy, F& f);
+    void DestroyAll() noexcept;
+
+    Alloc alloc_;
+    Vector<Chunk, ChunkAlloc> chunks_;
+    size_t size_ = 0;
+};
+
+template <typename T, size_t ChunkSize, typename Alloc>
+template <typename Vec, typename Value>
+class ChunkedVector<T, ChunkSize, Alloc>::Iterator
+{
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::remove_const_t<Value>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    Iterator() = default;
+    Iterator(Vec* vector, size_t index) noexcept
+        : vector_(vector)
+        , index_(index)
+    {
+    }
+    // iterator converts to const_iterator
+    template <typename OtherVec, typename OtherValue,
+        typename = std::enable_if_t<std::is_convertible_v<OtherValue*, Value*>>>
+    Iterator(const Iterator<OtherVec, OtherValue>& other) noexcept
+        : vector_(other.vector_)
+        , index_(other.index_)
+    {
+    }
+
+    reference operator*() const noexcept { return (*vector_)[index_]; }
+    pointer operator->() const noexcept { return &(*vector_)[index_]; }
+    reference operator[](difference_type n) const noexcept { return (*vector_)[index_ + n]; }
+
+    Iterator& operator++() noexcept { ++index_; return *this; }
+    Iterator operator++(int) noexcept { Iterator old = *this; ++index_; return old; }
+    Iterator& operator--() noexcept { --index_; return *this; }
+    Iterator operator--(int) noexcept { Iterator old = *this; --index_; return old; }
+    Iterator& operator+=(difference_type n) noexcept { index_ += n; return *this; }
+    Iterator& operator-=(difference_type n) noexcept { index_ -= n; return *this; }
+    friend Iterator operator+(Iterator it, difference_type n) noexcept { return it += n; }
+    friend Iterator operator+(difference_type n, Iterator it) noexcept { return it += n; }
+    friend Iterator operator-(Iterator it, difference_type n) noexcept { return it -= n; }
+    friend difference_type operator-(const Iterator& lhs, const Iterator& rhs) noexcept
+    {
+        return static_cast<difference_type>(lhs.index_) - static_cast<difference_type>(rhs.index_);
+    }
+
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ == rhs.index_; }
+    friend bool operator!=(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ != rhs.index_; }
+    friend bool operator<(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ < rhs.index_; }
+    friend bool operator>(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ > rhs.index_; }
+    friend bool operator<=(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ <= rhs.index_; }
+    friend bool operator>=(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ >= rhs.index_; }
+
+private:
+    template <typename, typename>
+    friend class Iterator;
+
+    Vec* vector_ = nullptr;
+    size_t index_ = 0;
+};
+
+template<typename T, size_t ChunkSize, typename Alloc>
+ChunkedVector<T, ChunkSize, Alloc>::ChunkedVector(const Alloc& alloc)
+    : alloc_(alloc)
+    , chunks_(ChunkAlloc(alloc))
+{
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+ChunkedVector<T, ChunkSize, Alloc>::ChunkedVector(const ChunkedVector& other)
+    : alloc_(std::allocator_traits<Alloc>::select_on_container_copy_construction(other.alloc_))
+    , chunks_(ChunkAlloc(alloc_))
+{
+    try
+    {
+        Reserve(other.size_);
+        other.ForEachChunk([this](const T* first, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+            {
+                EmplaceBack(first[i]);
+            }
+        });
+    }
+    catch (...)
+    {
+        DestroyAll();
+        throw;
+    }
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+ChunkedVector<T, ChunkSize, Alloc>& ChunkedVector<T, ChunkSize, Alloc>::operator=(const ChunkedVector& rhs)
+{
+    if (this != &rhs)
+    {
+        ChunkedVector rhs_copy(rhs);
+        Swap(rhs_copy);
+    }
+    return *this;
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+ChunkedVector<T, ChunkSize, Alloc>::ChunkedVector(ChunkedVector&& other) noexcept
+    : alloc_(other.alloc_)
+    , chunks_(std::move(other.chunks_))
+    , size_(std::exchange(other.size_, 0))
+{
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+ChunkedVector<T, ChunkSize, Alloc>& ChunkedVector<T, ChunkSize, Alloc>::operator=(ChunkedVector&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        ChunkedVector rhs_move(std::move(rhs));
+        Swap(rhs_move);
+    }
+    return *this;
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+ChunkedVector<T, ChunkSize, Alloc>::~ChunkedVector()
+{
+    DestroyAll();
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+typename ChunkedVector<T, ChunkSize, Alloc>::iterator ChunkedVector<T, ChunkSize, Alloc>::begin() noexcept
+{
+    return iterator(this, 0);
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+typename ChunkedVector<T, ChunkSize, Alloc>::iterator ChunkedVector<T, ChunkSize, Alloc>::end() noexcept
+{
+    return iterator(this, size_);
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+typename ChunkedVector<T, ChunkSize, Alloc>::const_iterator ChunkedVector<T, ChunkSize, Alloc>::begin() const noexcept
+{
+    return const_iterator(this, 0);
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+typename ChunkedVector<T, ChunkSize, Alloc>::const_iterator ChunkedVector<T, ChunkSize, Alloc>::end() const noexcept
+{
+    return const_iterator(this, size_);
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+typename ChunkedVector<T, ChunkSize, Alloc>::const_iterator ChunkedVector<T, ChunkSize, Alloc>::cbegin() const noexcept
+{
+    return begin();
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+typename ChunkedVector<T, ChunkSize, Alloc>::const_iterator ChunkedVector<T, ChunkSize, Alloc>::cend() const noexcept
+{
+    return end();
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+size_t ChunkedVector<T, ChunkSize, Alloc>::Size() const noexcept
+{
+    return size_;
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+size_t ChunkedVector<T, ChunkSize, Alloc>::Capacity() const noexcept
+{
+    return chunks_.Size() * ChunkSize;
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+size_t ChunkedVector<T, ChunkSize, Alloc>::ChunkCount() const noexcept
+{
+    return chunks_.Size();
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+typename ChunkedVector<T, ChunkSize, Alloc>::allocator_type ChunkedVector<T, ChunkSize, Alloc>::GetAllocator() const noexcept
+{
+    return alloc_;
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+void ChunkedVector<T, ChunkSize, Alloc>::Reserve(size_t new_capacity)
+{
+    const size_t chunk_count = (new_capacity + ChunkSize - 1) >> kShift;
+    chunks_.Reserve(chunk_count);
+    while (chunks_.Size() < chunk_count)
+    {
+        chunks_.EmplaceBack(ChunkSize, alloc_);
+    }
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+void ChunkedVector<T, ChunkSize, Alloc>::Clear() noexcept
+{
+    DestroyAll();
+    size_ = 0;
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+const T& ChunkedVector<T, ChunkSize, Alloc>::operator[](size_t index) const noexcept
+{
+    return const_cast<ChunkedVector&>(*this)[index];
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+T& ChunkedVector<T, ChunkSize, Alloc>::operator[](size_t index) noexcept
+{
+    assert(index < size_);
+    return chunks_[index >> kShift][index & (ChunkSize - 1)];
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+void ChunkedVector<T, ChunkSize, Alloc>::Swap(ChunkedVector& other) noexcept
+{
+    using std::swap;
+    swap(alloc_, other.alloc_);
+    chunks_.Swap(other.chunks_);
+    swap(size_, other.size_);
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+template<typename F>
+void ChunkedVector<T, ChunkSize, Alloc>::PushBack(F&& value)
+{
+    EmplaceBack(std::forward<F>(value));
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+void ChunkedVector<T, ChunkSize, Alloc>::PopBack() noexcept
+{
+    assert(size_ > 0);
+    std::destroy_at(&(*this)[size_ - 1]);
+    --size_;
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+template<typename... Ts>
+T& ChunkedVector<T, ChunkSize, Alloc>::EmplaceBack(Ts&&... vs)
+{
+    if (size_ == Capacity())
+    {
+        // Existing elements do not move, so vs stays valid
+        chunks_.EmplaceBack(ChunkSize, alloc_);
+    }
+    T* result = new (chunks_[size_ >> kShift] + (size_ & (ChunkSize - 1))) T(std::forward<Ts>(vs)...);
+    ++size_;
+    return *result;
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+template<typename F>
+void ChunkedVector<T, ChunkSize, Alloc>::ForEachChunk(F&& f)
+{
+    for (size_t chunk = 0; chunk < chunks_.Size() && chunk * ChunkSize < size_; ++chunk)
+    {
+        f(chunks_[chunk].GetAddress(), ChunkElements(chunk));
+    }
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+template<typename F>
+void ChunkedVector<T, ChunkSize, Alloc>::ForEachChunk(F&& f) const
+{
+    for (size_t chunk = 0; chunk < chunks_.Size() && chunk * ChunkSize < size_; ++chunk)
+    {
+        f(static_cast<const T*>(chunks_[chunk].GetAddress()), ChunkElements(chunk));
+    }
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+template<typename F>
+void ChunkedVector<T, ChunkSize, Alloc>::ForEachChunk(const ParallelPolicy& policy, F&& f)
+{
+    ForEachChunk(*this, policy, f);
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+template<typename F>
+void ChunkedVector<T, ChunkSize, Alloc>::ForEachChunk(const ParallelPolicy& policy, F&& f) const
+{
+    ForEachChunk(*this, policy, f);
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+template<typename Self, typename F>
+void ChunkedVector<T, ChunkSize, Alloc>::ForEachChunk(Self& self, const ParallelPolicy& policy, F& f)
+{
+    using Pointer = std::conditional_t<std::is_const_v<Self>, const T*, T*>;
+    const size_t used_chunks = (self.size_ + ChunkSize - 1) >> kShift;
+    const ParallelPolicy chunk_policy{policy.threads, (policy.threshold + ChunkSize - 1) >> kShift};
+    detail::ParallelFor(used_chunks, chunk_policy,
+        [&self, &f](size_t first, size_t last) {
+            for (size_t chunk = first; chunk < last; ++chunk)
+            {
+                f(static_cast<Pointer>(self.chunks_[chunk].GetAddress()), self.ChunkElements(chunk));
+            }
+        },
+        [](size_t, size_t) noexcept {});
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+Vector<T, Alloc> ChunkedVector<T, ChunkSize, Alloc>::Flatten() const&
+{
+    Vector<T, Alloc> result(alloc_);
+    result.Reserve(size_);
+    ForEachChunk([&result](const T* first, size_t count) {
+        result.Append(first, first + count);
+    });
+    return result;
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+Vector<T, Alloc> ChunkedVector<T, ChunkSize, Alloc>::Flatten() &&
+{
+    if constexpr (!std::is_nothrow_move_constructible_v<T>)
+    {
+        // A throwing move could fail halfway through, copy instead
+        Vector<T, Alloc> result = static_cast<const ChunkedVector&>(*this).Flatten();
+        ChunkedVector empty(alloc_);
+        Swap(empty);
+        return result;
+    }
+    else
+    {
+        Vector<T, Alloc> result(alloc_);
+        result.Reserve(size_);
+        for (size_t chunk = 0; chunk < chunks_.Size(); ++chunk)
+        {
+            T* first = chunks_[chunk].GetAddress();
+            const size_t count = ChunkElements(chunk);
+            result.Append(std::make_move_iterator(first), std::make_move_iterator(first + count));
+            std::destroy_n(first, count);
+            Chunk empty(alloc_);
+            chunks_[chunk].Swap(empty);
+        }
+        size_ = 0;
+        Vector<Chunk, ChunkAlloc> no_chunks(chunks_.GetAllocator());
+        chunks_.Swap(no_chunks);
+        return result;
+    }
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+size_t ChunkedVector<T, ChunkSize, Alloc>::ChunkElements(size_t chunk) const noexcept
+{
+    const size_t first = chunk * ChunkSize;
+    return first >= size_ ? 0 : std::min(ChunkSize, size_ - first);
+}
+
+template<typename T, size_t ChunkSize, typename Alloc>
+void ChunkedVector<T, ChunkSize, Alloc>::DestroyAll() noexcept
+{
+    ForEachChunk([](T* first, size_t count) {
+        std::destroy_n(first, count);
+    });
+    size_ = 0;
+}
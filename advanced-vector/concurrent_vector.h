@@ -0,0 +1,265 @@
+#pragma once
+
+#include "vector.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Append-only vector for many producer threads. Elements live in segments
+// of 2^k * kFirstSegmentSize slots that are never moved, so references stay
+// valid. EmplaceBack claims a slot with one fetch_add and constructs the
+// element in it; operator[] may read any slot for which IsReady is true.
+// Everything except EmplaceBack, IsReady, operator[], Size and Reserve
+// needs exclusive access
+template <typename T, typename Alloc = std::allocator<T>>
+class ConcurrentVector
+{
+public:
+    using value_type = T;
+    using allocator_type = Alloc;
+
+    static constexpr size_t kFirstSegmentBits = 5;
+    static constexpr size_t kFirstSegmentSize = size_t{1} << kFirstSegmentBits;
+
+    ConcurrentVector() = default;
+    explicit ConcurrentVector(const Alloc& alloc) noexcept;
+    ConcurrentVector(const ConcurrentVector&) = delete;
+    ConcurrentVector& operator=(const ConcurrentVector&) = delete;
+    ~ConcurrentVector();
+
+    // Lock-free apart from the allocation of a new segment. If the
+    // constructor throws the slot stays empty and is skipped by Freeze
+    template<typename... Ts>
+    T& EmplaceBack(Ts&&... vs);
+    template<typename F>
+    T& PushBack(F&& value);
+    // Number of claimed slots, including the ones still being constructed
+    size_t Size() const noexcept;
+    bool IsReady(size_t index) const noexcept;
+    // Wait-free. The element must be ready
+    const T& operator[](size_t index) const noexcept;
+    T& operator[](size_t index) noexcept;
+    // Allocates the segments for the first capacity slots up front
+    void Reserve(size_t capacity);
+    // Moves the ready elements in index order into a contiguous Vector
+    // and leaves this vector empty. No other thread may use it meanwhile
+    Vector<T, Alloc> Freeze();
+
+private:
+    enum class SlotState : uint8_t { EMPTY, READY };
+
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        std::atomic<SlotState> state;
+
+        T* Value() noexcept
+        {
+            return std::launder(reinterpret_cast<T*>(storage));
+        }
+    };
+
+    using SlotAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Slot>;
+
+    static constexpr size_t kMaxSegments = 64 - kFirstSegmentBits;
+
+    static size_t SegmentOf(size_t index) noexcept;
+    static size_t SegmentStart(size_t segment) noexcept;
+    static size_t SegmentSize(size_t segment) noexcept;
+    Slot& GetSlot(size_t index) const noexcept;
+    Slot* EnsureSegment(size_t segment);
+    void DestroyAll() noexcept;
+
+    Alloc alloc_;
+    std::atomic<size_t> size_ = 0;
+    std::atomic<Slot*> segments_[kMaxSegments] = {};
+    // Owners of the published segments, written only by the thread whose
+    // pointer won the publication
+    RawMemory<Slot, SlotAlloc> blocks_[kMaxSegments];
+};
+
+template<typename T, typename Alloc>
+ConcurrentVector<T, Alloc>::ConcurrentVector(const Alloc& alloc) noexcept
+    : alloc_(alloc)
+{
+}
+
+template<typename T, typename Alloc>
+ConcurrentVector<T, Alloc>::~ConcurrentVector()
+{
+    DestroyAll();
+}
+
+template<typename T, typename Alloc>
+template<typename... Ts>
+T& ConcurrentVector<T, Alloc>::EmplaceBack(Ts&&... vs)
+{
+    const size_t index = size_.fetch_add(1, std::memory_order_relaxed);
+    const size_t segment = SegmentOf(index);
+    Slot* slots = segments_[segment].load(std::memory_order_acquire);
+    if (slots == nullptr)
+    {
+        slots = EnsureSegment(segment);
+    }
+    Slot& slot = slots[index - SegmentStart(segment)];
+    T* result = new (slot.storage) T(std::forward<Ts>(vs)...);
+    slot.state.store(SlotState::READY, std::memory_order_release);
+    return *result;
+}
+
+template<typename T, typename Alloc>
+template<typename F>
+T& ConcurrentVector<T, Alloc>::PushBack(F&& value)
+{
+    return EmplaceBack(std::forward<F>(value));
+}
+
+template<typename T, typename Alloc>
+size_t ConcurrentVector<T, Alloc>::Size() const noexcept
+{
+    return size_.load(std::memory_order_acquire);
+}
+
+template<typename T, typename Alloc>
+bool ConcurrentVector<T, Alloc>::IsReady(size_t index) const noexcept
+{
+    const Slot* slots = segments_[SegmentOf(index)].load(std::memory_order_acquire);
+    return slots != nullptr &&
+        slots[index - SegmentStart(SegmentOf(index))].state.load(std::memory_order_acquire) == SlotState::READY;
+}
+
+template<typename T, typename Alloc>
+const T& ConcurrentVector<T, Alloc>::operator[](size_t index) const noexcept
+{
+    return const_cast<ConcurrentVector&>(*this)[index];
+}
+
+template<typename T, typename Alloc>
+T& ConcurrentVector<T, Alloc>::operator[](size_t index) noexcept
+{
+    assert(IsReady(index));
+    return *GetSlot(index).Value();
+}
+
+template<typename T, typename Alloc>
+void ConcurrentVector<T, Alloc>::Reserve(size_t capacity)
+{
+    if (capacity == 0)
+    {
+        return;
+    }
+    const size_t last = SegmentOf(capacity - 1);
+    for (size_t segment = 0; segment <= last; ++segment)
+    {
+        if (segments_[segment].load(std::memory_order_acquire) == nullptr)
+        {
+            EnsureSegment(segment);
+        }
+    }
+}
+
+template<typename T, typename Alloc>
+Vector<T, Alloc> ConcurrentVector<T, Alloc>::Freeze()
+{
+    const size_t size = size_.load(std::memory_order_acquire);
+    Vector<T, Alloc> result(alloc_);
+    result.Reserve(size);
+    for (size_t index = 0; index < size; ++index)
+    {
+        const size_t segment = SegmentOf(index);
+        Slot* slots = segments_[segment].load(std::memory_order_acquire);
+        if (slots == nullptr)
+        {
+            // A failed segment allocation can leave a hole
+            index = SegmentStart(segment + 1) - 1;
+            continue;
+        }
+        Slot& slot = slots[index - SegmentStart(segment)];
+        if (slot.state.load(std::memory_order_acquire) == SlotState::READY)
+        {
+            result.EmplaceBack(std::move_if_noexcept(*slot.Value()));
+        }
+    }
+    DestroyAll();
+    for (size_t segment = 0; segment < kMaxSegments; ++segment)
+    {
+        segments_[segment].store(nullptr, std::memory_order_relaxed);
+        RawMemory<Slot, SlotAlloc> empty(blocks_[segment].GetAllocator());
+        blocks_[segment].Swap(empty);
+    }
+    size_.store(0, std::memory_order_release);
+    return result;
+}
+
+template<typename T, typename Alloc>
+size_t ConcurrentVector<T, Alloc>::SegmentOf(size_t index) noexcept
+{
+    // Segment k covers [kFirstSegmentSize * (2^k - 1), kFirstSegmentSize * (2^(k+1) - 1))
+    const uint64_t biased = static_cast<uint64_t>(index) + kFirstSegmentSize;
+    return 63 - __builtin_clzll(biased) - kFirstSegmentBits;
+}
+
+template<typename T, typename Alloc>
+size_t ConcurrentVector<T, Alloc>::SegmentStart(size_t segment) noexcept
+{
+    return (kFirstSegmentSize << segment) - kFirstSegmentSize;
+}
+
+template<typename T, typename Alloc>
+size_t ConcurrentVector<T, Alloc>::SegmentSize(size_t segment) noexcept
+{
+    return kFirstSegmentSize << segment;
+}
+
+template<typename T, typename Alloc>
+typename ConcurrentVector<T, Alloc>::Slot& ConcurrentVector<T, Alloc>::GetSlot(size_t index) const noexcept
+{
+    const size_t segment = SegmentOf(index);
+    return segments_[segment].load(std::memory_order_acquire)[index - SegmentStart(segment)];
+}
+
+template<typename T, typename Alloc>
+typename ConcurrentVector<T, Alloc>::Slot* ConcurrentVector<T, Alloc>::EnsureSegment(size_t segment)
+{
+    assert(segment < kMaxSegments);
+    const size_t size = SegmentSize(segment);
+    RawMemory<Slot, SlotAlloc> block(size, SlotAlloc(alloc_));
+    for (size_t i = 0; i < size; ++i)
+    {
+        new (&block[i].state) std::atomic<SlotState>(SlotState::EMPTY);
+    }
+    Slot* expected = nullptr;
+    if (segments_[segment].compare_exchange_strong(expected, block.GetAddress(),
+        std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+        blocks_[segment].Swap(block);
+        return blocks_[segment].GetAddress();
+    }
+    // Another thread published the segment first, ours is freed
+    return expected;
+}
+
+template<typename T, typename Alloc>
+void ConcurrentVector<T, Alloc>::DestroyAll() noexcept
+{
+    for (size_t segment = 0; segment < kMaxSegments; ++segment)
+    {
+        Slot* slots = segments_[segment].load(std::memory_order_acquire);
+        if (slots == nullptr)
+        {
+            continue;
+        }
+        for (size_t i = 0, size = SegmentSize(segment); i < size; ++i)
+        {
+            if (slots[i].state.load(std::memory_order_relaxed) == SlotState::READY)
+            {
+                std::destroy_at(slots[i].Value());
+                slots[i].state.store(SlotState::EMPTY, std::memory_order_relaxed);
+            }
+        }
+    }
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Background thread that destroys containers handed to it, so a huge
+// Vector of strings does not stall the thread that drops it. Moving a
+// Vector in costs one small allocation and a push to a lock-free list; the
+// thread takes the whole list at once and destroys it off the critical path.
+// Blocks come back to the allocator on the reclaimer thread, so a
+// CachingAllocator block ends up in that thread's cache
+class Reclaimer {
+public:
+    Reclaimer();
+    Reclaimer(const Reclaimer&) = delete;
+    Reclaimer& operator=(const Reclaimer&) = delete;
+    // Destroys whatever is still pending and joins the thread
+    ~Reclaimer();
+
+    // Shared instance started on first use
+    static Reclaimer& Default();
+
+    // Takes over an rvalue container, leaving the source in its moved-from state
+    template <typename Container>
+    void Defer(Container&& container);
+    // Blocks until everything deferred before the call is destroyed
+    void Drain();
+    // Containers deferred but not yet destroyed
+    size_t Pending() const noexcept;
+
+private:
+    struct Job {
+        Job* next = nullptr;
+        void (*destroy)(Job*) noexcept = nullptr;
+    };
+
+    template <typename Container>
+    struct ContainerJob : Job {
+        explicit ContainerJob(Container&& c);
+
+        Container container;
+    };
+
+    void Push(Job* job) noexcept;
+    void Run() noexcept;
+    static void DestroyAll(Job* job) noexcept;
+
+    std::atomic<Job*> head_{nullptr};
+    std::atomic<size_t> deferred_{0};
+    std::atomic<size_t> destroyed_{0};
+    mutable std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+// Destroys container on Reclaimer::Default() instead of at the end of the
+// caller's scope. Must not be called once static destructors have run
+template <typename Container>
+void DeferDestroy(Container&& container);
+
+inline Reclaimer::Reclaimer()
+    : thread_([this] { Run(); })
+{
+}
+
+inline Reclaimer::~Reclaimer()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    work_ready_.notify_one();
+    thread_.join();
+}
+
+inline Reclaimer& Reclaimer::Default()
+{
+    static Reclaimer reclaimer;
+    return reclaimer;
+}
+
+template <typename Container>
+Reclaimer::ContainerJob<Container>::ContainerJob(Container&& c)
+    : container(std::move(c))
+{
+    destroy = [](Job* job) noexcept { delete static_cast<ContainerJob*>(job); };
+}
+
+template <typename Container>
+void Reclaimer::Defer(Container&& container)
+{
+    static_assert(!std::is_lvalue_reference_v<Container>, "Defer takes containers by rvalue, use std::move");
+    // If the job cannot be allocated the container stays with the caller
+    Push(new ContainerJob<Container>(std::move(container)));
+}
+
+inline void Reclaimer::Drain()
+{
+    const size_t target = deferred_.load(std::memory_order_acquire);
+    std::unique_lock lock(mutex_);
+    work_done_.wait(lock, [&] { return destroyed_.load(std::memory_order_relaxed) >= target; });
+}
+
+inline size_t Reclaimer::Pending() const noexcept
+{
+    // destroyed_ never passes deferred_, so reading it first keeps the difference non-negative
+    const size_t destroyed = destroyed_.load(std::memory_order_relaxed);
+    return deferred_.load(std::memory_order_relaxed) - destroyed;
+}
+
+inline void Reclaimer::Push(Job* job) noexcept
+{
+    deferred_.fetch_add(1, std::memory_order_release);
+    Job* old_head = head_.load(std::memory_order_relaxed);
+    do
+    {
+        job->next = old_head;
+    } while (!head_.compare_exchange_weak(old_head, job, std::memory_order_release, std::memory_order_relaxed));
+    // job may be destroyed already, so only old_head is looked at. Only the
+    // push onto an empty list can find the thread asleep. Taking the mutex
+    // orders it with the check the thread makes before waiting
+    if (old_head == nullptr)
+    {
+        {
+            std::lock_guard lock(mutex_);
+        }
+        work_ready_.notify_one();
+    }
+}
+
+inline void Reclaimer::Run() noexcept
+{
+    std::unique_lock lock(mutex_);
+    while (true)
+    {
+        work_ready_.wait(lock, [&] { return stop_ || head_.load(std::memory_order_relaxed) != nullptr; });
+        Job* batch = head_.exchange(nullptr, std::memory_order_acquire);
+        if (batch == nullptr)
+        {
+            return;
+        }
+        lock.unlock();
+        size_t count = 0;
+        for (Job* job = batch; job != nullptr; job = job->next)
+        {
+            ++count;
+        }
+        DestroyAll(batch);
+        lock.lock();
+        destroyed_.fetch_add(count, std::memory_order_relaxed);
+        work_done_.notify_all();
+    }
+}
+
+inline void Reclaimer::DestroyAll(Job* job) noexcept
+{
+    while (job != nullptr)
+    {
+        Job* next = job->next;
+        job->destroy(job);
+        job = next;
+    }
+}
+
+template <typename Container>
+void DeferDestroy(Container&& container)
+{
+    Reclaimer::Default().Defer(std::forward<Container>(container));
+}
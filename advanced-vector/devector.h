@@ -0,0 +1,590 @@
+#pragma once
+
+#include "vector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Vector with spare capacity on both sides of its elements, so it works as
+// a queue or a sliding window: EmplaceFront and PopFront are amortized O(1)
+// like EmplaceBack and PopBack, and an insert or erase in the middle shifts
+// the shorter side. The elements stay contiguous in [begin(), end())
+template <typename T, typename Alloc = std::allocator<T>, typename Growth = DoublingGrowth>
+class Devector
+{
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using allocator_type = Alloc;
+    using growth_policy = Growth;
+
+    Devector() = default;
+    explicit Devector(const Alloc& alloc) noexcept;
+    explicit Devector(size_t size, const Alloc& alloc = Alloc());
+    Devector(std::initializer_list<T> init, const Alloc& alloc = Alloc());
+    Devector(const Devector& other);
+    Devector& operator=(const Devector& rhs);
+    Devector(Devector&& other) noexcept;
+    Devector& operator=(Devector&& rhs) noexcept;
+    ~Devector();
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+    const_iterator cbegin() const noexcept;
+    const_iterator cend() const noexcept;
+
+    size_t Size() const noexcept;
+    size_t Capacity() const noexcept;
+    // Free slots before the first and after the last element
+    size_t FrontCapacity() const noexcept;
+    size_t BackCapacity() const noexcept;
+    allocator_type GetAllocator() const noexcept;
+    // Grows the block so that new_capacity - Size() slots are free at the back
+    void Reserve(size_t new_capacity);
+    // Destroys all elements, keeps the capacity and splits it between both sides
+    void Clear() noexcept;
+    const T& operator[](size_t index) const noexcept;
+    T& operator[](size_t index) noexcept;
+    void Swap(Devector& other) noexcept;
+    void Resize(size_t new_size);
+    template<typename F>
+    void PushBack(F&& value);
+    template<typename F>
+    void PushFront(F&& value);
+    void PopBack() noexcept;
+    void PopFront() noexcept;
+    template<typename... Ts>
+    T& EmplaceBack(Ts&&... vs);
+    template<typename... Ts>
+    T& EmplaceFront(Ts&&... vs);
+    template <typename... Ts>
+    iterator Emplace(const_iterator pos, Ts&&... vs);
+    template<typename F>
+    iterator Insert(const_iterator pos, F&& value);
+    iterator Erase(const_iterator pos) noexcept(std::is_nothrow_move_assignable_v<T>);
+    iterator Erase(const_iterator first, const_iterator last) noexcept(std::is_nothrow_move_assignable_v<T>);
+
+private:
+    static constexpr bool kNothrowRelocate = detail::kNothrowRelocate<T>;
+
+    // Makes room for count elements at pos_index and constructs them with
+    // init(T* first_uninitialized). Uses the free slots of the block when
+    // that is cheap, otherwise builds the result in a new block
+    template <typename Init>
+    iterator InsertUninitialized(size_t pos_index, size_t count, Init&& init);
+    // Moves the elements so that the first starts at new_front with count
+    // free slots at pos_index. Only for kNothrowShift types
+    void OpenGap(size_t new_front, size_t pos_index, size_t count) noexcept;
+    // Undoes OpenGap(new_front, pos_index, count)
+    void CloseGap(size_t new_front, size_t pos_index, size_t count) noexcept;
+    // Relocates two runs inside the block; each run may overlap itself
+    void MoveRuns(size_t from_a, size_t to_a, size_t count_a, size_t from_b, size_t to_b, size_t count_b) noexcept;
+    // Moves the elements to new_data starting at new_front with count free
+    // slots at pos_index. If that throws the devector keeps all its elements
+    void RelocateAround(RawMemory<T, Alloc>& new_data, size_t new_front, size_t pos_index, size_t count) noexcept(kNothrowRelocate);
+
+    RawMemory<T, Alloc> data_;
+    // Index of the first element in data_
+    size_t front_ = 0;
+    size_t size_ = 0;
+};
+
+template<typename T, typename Alloc, typename Growth>
+Devector<T, Alloc, Growth>::Devector(const Alloc& alloc) noexcept
+    : data_(alloc)
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+Devector<T, Alloc, Growth>::Devector(size_t size, const Alloc& alloc)
+    : data_(size, alloc)
+{
+    std::uninitialized_value_construct_n(data_.GetAddress(), size);
+    size_ = size;
+}
+
+template<typename T, typename Alloc, typename Growth>
+Devector<T, Alloc, Growth>::Devector(std::initializer_list<T> init, const Alloc& alloc)
+    : data_(init.size(), alloc)
+{
+    std::uninitialized_copy(init.begin(), init.end(), data_.GetAddress());
+    size_ = init.size();
+}
+
+template<typename T, typename Alloc, typename Growth>
+Devector<T, Alloc, Growth>::Devector(const Devector& other)
+    : data_(other.size_, std::allocator_traits<Alloc>::select_on_container_copy_construction(other.data_.GetAllocator()))
+{
+    std::uninitialized_copy_n(other.begin(), other.size_, data_.GetAddress());
+    size_ = other.size_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+Devector<T, Alloc, Growth>& Devector<T, Alloc, Growth>::operator=(const Devector& rhs)
+{
+    if (this != &rhs)
+    {
+        Devector rhs_copy(rhs);
+        Swap(rhs_copy);
+    }
+    return *this;
+}
+
+template<typename T, typename Alloc, typename Growth>
+Devector<T, Alloc, Growth>::Devector(Devector&& other) noexcept
+    : data_(std::move(other.data_))
+    , front_(std::exchange(other.front_, 0))
+    , size_(std::exchange(other.size_, 0))
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+Devector<T, Alloc, Growth>& Devector<T, Alloc, Growth>::operator=(Devector&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        Devector rhs_move(std::move(rhs));
+        Swap(rhs_move);
+    }
+    return *this;
+}
+
+template<typename T, typename Alloc, typename Growth>
+Devector<T, Alloc, Growth>::~Devector()
+{
+    std::destroy_n(begin(), size_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Devector<T, Alloc, Growth>::iterator Devector<T, Alloc, Growth>::begin() noexcept
+{
+    return data_ + front_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Devector<T, Alloc, Growth>::iterator Devector<T, Alloc, Growth>::end() noexcept
+{
+    return data_ + (front_ + size_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Devector<T, Alloc, Growth>::const_iterator Devector<T, Alloc, Growth>::begin() const noexcept
+{
+    return data_ + front_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Devector<T, Alloc, Growth>::const_iterator Devector<T, Alloc, Growth>::end() const noexcept
+{
+    return data_ + (front_ + size_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Devector<T, Alloc, Growth>::const_iterator Devector<T, Alloc, Growth>::cbegin() const noexcept
+{
+    return begin();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Devector<T, Alloc, Growth>::const_iterator Devector<T, Alloc, Growth>::cend() const noexcept
+{
+    return end();
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t Devector<T, Alloc, Growth>::Size() const noexcept
+{
+    return size_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t Devector<T, Alloc, Growth>::Capacity() const noexcept
+{
+    return data_.Capacity();
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t Devector<T, Alloc, Growth>::FrontCapacity() const noexcept
+{
+    return front_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t Devector<T, Alloc, Growth>::BackCapacity() const noexcept
+{
+    return data_.Capacity() - front_ - size_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Devector<T, Alloc, Growth>::allocator_type Devector<T, Alloc, Growth>::GetAllocator() const noexcept
+{
+    return data_.GetAllocator();
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Devector<T, Alloc, Growth>::Reserve(size_t new_capacity)
+{
+    if (new_capacity <= data_.Capacity() - front_ || data_.TryExpand(new_capacity + front_))
+    {
+        return;
+    }
+    RawMemory<T, Alloc> new_data(new_capacity, data_.GetAllocator());
+    RelocateAround(new_data, 0, size_, 0);
+    data_.Swap(new_data);
+    front_ = 0;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Devector<T, Alloc, Growth>::Clear() noexcept
+{
+    std::destroy_n(begin(), size_);
+    size_ = 0;
+    front_ = data_.Capacity() / 2;
+}
+
+template<typename T, typename Alloc, typename Growth>
+const T& Devector<T, Alloc, Growth>::operator[](size_t index) const noexcept
+{
+    return const_cast<Devector&>(*this)[index];
+}
+
+template<typename T, typename Alloc, typename Growth>
+T& Devector<T, Alloc, Growth>::operator[](size_t index) noexcept
+{
+    assert(index < size_);
+    return data_[front_ + index];
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Devector<T, Alloc, Growth>::Swap(Devector& other) noexcept
+{
+    data_.Swap(other.data_);
+    std::swap(front_, other.front_);
+    std::swap(size_, other.size_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Devector<T, Alloc, Growth>::Resize(size_t new_size)
+{
+    if (new_size < size_)
+    {
+        std::destroy_n(begin() + new_size, size_ - new_size);
+        size_ = new_size;
+        return;
+    }
+    InsertUninitialized(size_, new_size - size_, [count = new_size - size_](T* first) {
+        std::uninitialized_value_construct_n(first, count);
+    });
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename F>
+void Devector<T, Alloc, Growth>::PushBack(F&& value)
+{
+    EmplaceBack(std::forward<F>(value));
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename F>
+void Devector<T, Alloc, Growth>::PushFront(F&& value)
+{
+    EmplaceFront(std::forward<F>(value));
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Devector<T, Alloc, Growth>::PopBack() noexcept
+{
+    assert(size_ > 0);
+    std::destroy_at(end() - 1);
+    --size_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Devector<T, Alloc, Growth>::PopFront() noexcept
+{
+    assert(size_ > 0);
+    std::destroy_at(begin());
+    ++front_;
+    --size_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename... Ts>
+T& Devector<T, Alloc, Growth>::EmplaceBack(Ts&&... vs)
+{
+    return *Emplace(end(), std::forward<Ts>(vs)...);
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename... Ts>
+T& Devector<T, Alloc, Growth>::EmplaceFront(Ts&&... vs)
+{
+    return *Emplace(begin(), std::forward<Ts>(vs)...);
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename... Ts>
+typename Devector<T, Alloc, Growth>::iterator Devector<T, Alloc, Growth>::Emplace(const_iterator pos, Ts&&... vs)
+{
+    assert(pos >= begin() && pos <= end());
+    const size_t pos_index = pos - begin();
+    if (pos_index == size_ && BackCapacity() != 0)
+    {
+        T* result = new (end()) T(std::forward<Ts>(vs)...);
+        ++size_;
+        return result;
+    }
+    if (pos_index == 0 && front_ != 0)
+    {
+        T* result = new (begin() - 1) T(std::forward<Ts>(vs)...);
+        --front_;
+        ++size_;
+        return result;
+    }
+    // vs may refer to an element that is about to be shifted or relocated
+    T value(std::forward<Ts>(vs)...);
+    return InsertUninitialized(pos_index, 1, [&value](T* slot) {
+        new (slot) T(std::move_if_noexcept(value));
+    });
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename F>
+typename Devector<T, Alloc, Growth>::iterator Devector<T, Alloc, Growth>::Insert(const_iterator pos, F&& value)
+{
+    return Emplace(pos, std::forward<F>(value));
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Devector<T, Alloc, Growth>::iterator Devector<T, Alloc, Growth>::Erase(const_iterator pos) noexcept(std::is_nothrow_move_assignable_v<T>)
+{
+    assert(pos >= begin() && pos < end());
+    return Erase(pos, pos + 1);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Devector<T, Alloc, Growth>::iterator Devector<T, Alloc, Growth>::Erase(const_iterator first, const_iterator last) noexcept(std::is_nothrow_move_assignable_v<T>)
+{
+    assert(first >= begin() && first <= last && last <= end());
+    const size_t first_index = first - begin();
+    const size_t count = last - first;
+    if (count == 0)
+    {
+        return begin() + first_index;
+    }
+    const size_t tail = size_ - first_index - count;
+    // Shift whichever side of the erased range is shorter
+    const bool shift_front = first_index < tail;
+    if constexpr (IsTriviallyRelocatable<T>::value)
+    {
+        std::destroy_n(begin() + first_index, count);
+        if (shift_front)
+        {
+            detail::RelocateOverlapping(begin(), first_index, begin() + count);
+        }
+        else
+        {
+            detail::RelocateOverlapping(begin() + first_index + count, tail, begin() + first_index);
+        }
+    }
+    else
+    {
+        constexpr bool kMove = std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>;
+        if (shift_front)
+        {
+            if constexpr (kMove)
+            {
+                std::move_backward(begin(), begin() + first_index, begin() + first_index + count);
+            }
+            else
+            {
+                std::copy_backward(begin(), begin() + first_index, begin() + first_index + count);
+            }
+            std::destroy_n(begin(), count);
+        }
+        else
+        {
+            if constexpr (kMove)
+            {
+                std::move(begin() + first_index + count, end(), begin() + first_index);
+            }
+            else
+            {
+                std::copy(begin() + first_index + count, end(), begin() + first_index);
+            }
+            std::destroy_n(end() - count, count);
+        }
+    }
+    if (shift_front)
+    {
+        front_ += count;
+    }
+    size_ -= count;
+    return begin() + first_index;
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename Init>
+typename Devector<T, Alloc, Growth>::iterator Devector<T, Alloc, Growth>::InsertUninitialized(size_t pos_index, size_t count, Init&& init)
+{
+    if (count == 0)
+    {
+        return begin() + pos_index;
+    }
+    const size_t capacity = data_.Capacity();
+    const bool at_back = pos_index == size_;
+    const bool at_front = pos_index == 0 && !at_back;
+    // Shifting throwing elements in place cannot be undone, so for them
+    // only an insert at a free end stays in the block
+    if (at_back && (BackCapacity() >= count || data_.TryExpand(std::max(front_ + size_ + count,
+        front_ + Growth::NextCapacity(size_, sizeof(T))))))
+    {
+        init(end());
+        size_ += count;
+        return end() - count;
+    }
+    if (at_front && front_ >= count)
+    {
+        init(begin() - count);
+        front_ -= count;
+        size_ += count;
+        return begin();
+    }
+    if constexpr (detail::kNothrowShift<T>)
+    {
+        size_t new_front = capacity;
+        if (!at_back && pos_index <= size_ - pos_index && front_ >= count)
+        {
+            new_front = front_ - count;
+        }
+        else if (!at_front && BackCapacity() >= count)
+        {
+            new_front = front_;
+        }
+        else if (size_ + count <= capacity / 3 * 2)
+        {
+            // Block at most two thirds full: center the elements instead of
+            // growing. Each side gets at least half as many free slots as
+            // there are elements, so the shift is amortized over the inserts
+            // that follow
+            new_front = (capacity - size_ - count) / 2;
+        }
+        if (new_front != capacity)
+        {
+            OpenGap(new_front, pos_index, count);
+            try
+            {
+                init(data_ + (new_front + pos_index));
+            }
+            catch (...)
+            {
+                CloseGap(new_front, pos_index, count);
+                throw;
+            }
+            front_ = new_front;
+            size_ += count;
+            return begin() + pos_index;
+        }
+    }
+    const size_t new_capacity = std::max(size_ + count, Growth::NextCapacity(size_, sizeof(T)));
+    RawMemory<T, Alloc> new_data(new_capacity, data_.GetAllocator());
+    // Growing at one end keeps the free slots of the other end, up to half
+    // of the new ones, and gives the rest to the growing end. A middle
+    // insert splits them evenly
+    const size_t spare = new_data.Capacity() - size_ - count;
+    size_t new_front = spare / 2;
+    if (at_back)
+    {
+        new_front = std::min(front_, spare / 2);
+    }
+    else if (at_front)
+    {
+        new_front = spare - std::min(BackCapacity(), spare / 2);
+    }
+    init(new_data + (new_front + pos_index));
+    try
+    {
+        RelocateAround(new_data, new_front, pos_index, count);
+    }
+    catch (...)
+    {
+        std::destroy_n(new_data + (new_front + pos_index), count);
+        throw;
+    }
+    data_.Swap(new_data);
+    front_ = new_front;
+    size_ += count;
+    return begin() + pos_index;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Devector<T, Alloc, Growth>::OpenGap(size_t new_front, size_t pos_index, size_t count) noexcept
+{
+    MoveRuns(front_, new_front, pos_index,
+        front_ + pos_index, new_front + pos_index + count, size_ - pos_index);
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Devector<T, Alloc, Growth>::CloseGap(size_t new_front, size_t pos_index, size_t count) noexcept
+{
+    MoveRuns(new_front, front_, pos_index,
+        new_front + pos_index + count, front_ + pos_index, size_ - pos_index);
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Devector<T, Alloc, Growth>::MoveRuns(size_t from_a, size_t to_a, size_t count_a,
+    size_t from_b, size_t to_b, size_t count_b) noexcept
+{
+    const auto move = [this](size_t from, size_t count, size_t to) {
+        // A run that stays in place must not be moved onto itself
+        if (from != to)
+        {
+            detail::RelocateOverlapping(data_ + from, count, data_ + to);
+        }
+    };
+    // Run a precedes run b before and after the move. If b moves right it
+    // has to leave first to make room for a, otherwise a leaves first
+    if (to_b > from_b)
+    {
+        move(from_b, count_b, to_b);
+        move(from_a, count_a, to_a);
+    }
+    else
+    {
+        move(from_a, count_a, to_a);
+        move(from_b, count_b, to_b);
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Devector<T, Alloc, Growth>::RelocateAround(RawMemory<T, Alloc>& new_data, size_t new_front, size_t pos_index, size_t count) noexcept(kNothrowRelocate)
+{
+    T* to = new_data + new_front;
+    if constexpr (kNothrowRelocate)
+    {
+        detail::Relocate(begin(), pos_index, to);
+        detail::Relocate(begin() + pos_index, size_ - pos_index, to + pos_index + count);
+    }
+    else
+    {
+        detail::UninitializedCopyOrMoveN(begin(), pos_index, to);
+        try
+        {
+            detail::UninitializedCopyOrMoveN(begin() + pos_index, size_ - pos_index, to + pos_index + count);
+        }
+        catch (...)
+        {
+            std::destroy_n(to, pos_index);
+            throw;
+        }
+        std::destroy_n(begin(), size_);
+    }
+}
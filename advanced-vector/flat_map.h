@@ -0,0 +1,656 @@
+#pragma once
+
+#include "vector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace detail {
+
+// Binary search without unpredictable branches: every step halves the
+// range with a conditional move, so the loop runs log2(count) times
+// whatever the data. Returns the index of the first key not less than key
+template <typename K, typename Compare>
+size_t FlatLowerBound(const K* keys, size_t count, const K& key, const Compare& comp)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    const K* base = keys;
+    while (count > 1)
+    {
+        const size_t half = count / 2;
+        // A multiplication, because compilers turn the ternary back into a branch
+        base += static_cast<size_t>(comp(base[half - 1], key)) * half;
+        count -= half;
+    }
+    return (base - keys) + (comp(*base, key) ? 1 : 0);
+}
+
+}  // namespace detail
+
+// Sorted set of unique keys stored contiguously in a Vector. Lookups are
+// branchless binary searches over one cache-friendly array; inserting one
+// key shifts the tail, bulk inserts merge in a single pass
+template <typename K, typename Compare = std::less<K>>
+class FlatSet
+{
+public:
+    using key_type = K;
+    using value_type = K;
+    using key_compare = Compare;
+    using const_iterator = const K*;
+    using iterator = const_iterator;
+
+    FlatSet() = default;
+    explicit FlatSet(const Compare& comp);
+    // Bulk loading: takes keys in any order, sorts them once and drops duplicates
+    explicit FlatSet(Vector<K>&& keys, const Compare& comp = Compare());
+    FlatSet(std::initializer_list<K> init, const Compare& comp = Compare());
+
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    size_t Size() const noexcept;
+    void Reserve(size_t new_capacity);
+    void Clear() noexcept;
+    const Vector<K>& Keys() const noexcept;
+
+    // Index of the first key not less than key
+    size_t LowerBound(const K& key) const;
+    // Index of key or Size()
+    size_t IndexOf(const K& key) const;
+    bool Contains(const K& key) const;
+    // Returns the index of key and whether it was inserted
+    template <typename KeyArg>
+    std::pair<size_t, bool> Insert(KeyArg&& key);
+    // Inserts a range sorted by Compare. Keys already present are skipped
+    template <typename InputIt>
+    void InsertSorted(InputIt first, InputIt last);
+    // Inserts a range in any order, sorting it once
+    template <typename InputIt>
+    void InsertUnsorted(InputIt first, InputIt last);
+    bool Erase(const K& key);
+    void EraseAt(size_t index);
+
+private:
+    bool Equivalent(const K& lhs, const K& rhs) const;
+    // Merges a sorted run in. A bulk insert first copies its range into a
+    // run, so nothing can fail once the old keys start to move
+    void Merge(Vector<K>&& run);
+
+    Compare comp_;
+    Vector<K> keys_;
+};
+
+// Sorted map stored as two parallel Vectors, keys and values, so a lookup
+// touches only the dense key array and the values of the found entry.
+// Insertion does not invalidate anything but indices after the insert
+// point; no std::pair of key and value is ever stored
+template <typename K, typename V, typename Compare = std::less<K>>
+class FlatMap
+{
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using key_compare = Compare;
+
+    FlatMap() = default;
+    explicit FlatMap(const Compare& comp);
+    // Bulk loading: takes entries in any order, sorts them once and keeps
+    // the first entry of every key. keys and values must be of equal size
+    FlatMap(Vector<K>&& keys, Vector<V>&& values, const Compare& comp = Compare());
+    FlatMap(std::initializer_list<std::pair<K, V>> init, const Compare& comp = Compare());
+
+    size_t Size() const noexcept;
+    void Reserve(size_t new_capacity);
+    void Clear() noexcept;
+    const Vector<K>& Keys() const noexcept;
+    const Vector<V>& Values() const noexcept;
+    // Values may be changed in place, keys may not
+    Vector<V>& Values() noexcept;
+
+    size_t LowerBound(const K& key) const;
+    size_t IndexOf(const K& key) const;
+    bool Contains(const K& key) const;
+    // nullptr if there is no such key
+    const V* Find(const K& key) const;
+    V* Find(const K& key);
+    // Throws std::out_of_range if there is no such key
+    const V& At(const K& key) const;
+    V& At(const K& key);
+    // Inserts a value-initialized value if there is no such key
+    V& operator[](const K& key);
+    // Constructs the value from args unless the key is present. Returns the
+    // index of key and whether it was inserted
+    template <typename KeyArg, typename... Args>
+    std::pair<size_t, bool> Emplace(KeyArg&& key, Args&&... args);
+    template <typename KeyArg, typename F>
+    std::pair<size_t, bool> InsertOrAssign(KeyArg&& key, F&& value);
+    // Inserts a range of (key, value) pairs sorted by key. Keys already
+    // present are skipped, like Emplace would
+    template <typename InputIt>
+    void InsertSorted(InputIt first, InputIt last);
+    // Inserts a range of (key, value) pairs in any order, sorting it once
+    template <typename InputIt>
+    void InsertUnsorted(InputIt first, InputIt last);
+    bool Erase(const K& key);
+    void EraseAt(size_t index);
+
+private:
+    bool Equivalent(const K& lhs, const K& rhs) const;
+    // Sorts keys_ and values_ alike, keeping the first of equal keys
+    void Sort();
+    // Merges a sorted run in, keeping the first entry of every key. A bulk
+    // insert first copies its range into a run, so nothing can fail once
+    // the old entries start to move
+    void Merge(Vector<K>&& run_keys, Vector<V>&& run_values);
+    // Old entries are moved only if neither keys nor values can throw on a
+    // move: moving one and copying the other would leave moved-from keys
+    // behind when a copy fails. Move-only types are moved regardless
+    static constexpr bool kMoveEntries =
+        (std::is_nothrow_move_constructible_v<K> && std::is_nothrow_move_constructible_v<V>) ||
+        !std::is_copy_constructible_v<K> || !std::is_copy_constructible_v<V>;
+    template <typename T>
+    static std::conditional_t<kMoveEntries, T&&, const T&> TakeEntry(T& entry) noexcept;
+
+    Compare comp_;
+    Vector<K> keys_;
+    Vector<V> values_;
+};
+
+template<typename K, typename Compare>
+FlatSet<K, Compare>::FlatSet(const Compare& comp)
+    : comp_(comp)
+{
+}
+
+template<typename K, typename Compare>
+FlatSet<K, Compare>::FlatSet(Vector<K>&& keys, const Compare& comp)
+    : comp_(comp)
+    , keys_(std::move(keys))
+{
+    std::sort(keys_.begin(), keys_.end(), comp_);
+    const auto equal = [this](const K& lhs, const K& rhs) { return Equivalent(lhs, rhs); };
+    keys_.Erase(std::unique(keys_.begin(), keys_.end(), equal), keys_.end());
+}
+
+template<typename K, typename Compare>
+FlatSet<K, Compare>::FlatSet(std::initializer_list<K> init, const Compare& comp)
+    : FlatSet(Vector<K>(init), comp)
+{
+}
+
+template<typename K, typename Compare>
+typename FlatSet<K, Compare>::const_iterator FlatSet<K, Compare>::begin() const noexcept
+{
+    return keys_.begin();
+}
+
+template<typename K, typename Compare>
+typename FlatSet<K, Compare>::const_iterator FlatSet<K, Compare>::end() const noexcept
+{
+    return keys_.end();
+}
+
+template<typename K, typename Compare>
+size_t FlatSet<K, Compare>::Size() const noexcept
+{
+    return keys_.Size();
+}
+
+template<typename K, typename Compare>
+void FlatSet<K, Compare>::Reserve(size_t new_capacity)
+{
+    keys_.Reserve(new_capacity);
+}
+
+template<typename K, typename Compare>
+void FlatSet<K, Compare>::Clear() noexcept
+{
+    keys_.Clear();
+}
+
+template<typename K, typename Compare>
+const Vector<K>& FlatSet<K, Compare>::Keys() const noexcept
+{
+    return keys_;
+}
+
+template<typename K, typename Compare>
+size_t FlatSet<K, Compare>::LowerBound(const K& key) const
+{
+    return detail::FlatLowerBound(keys_.begin(), keys_.Size(), key, comp_);
+}
+
+template<typename K, typename Compare>
+size_t FlatSet<K, Compare>::IndexOf(const K& key) const
+{
+    const size_t index = LowerBound(key);
+    return index != keys_.Size() && !comp_(key, keys_[index]) ? index : keys_.Size();
+}
+
+template<typename K, typename Compare>
+bool FlatSet<K, Compare>::Contains(const K& key) const
+{
+    return IndexOf(key) != keys_.Size();
+}
+
+template<typename K, typename Compare>
+template<typename KeyArg>
+std::pair<size_t, bool> FlatSet<K, Compare>::Insert(KeyArg&& key)
+{
+    const size_t index = LowerBound(key);
+    if (index != keys_.Size() && !comp_(key, keys_[index]))
+    {
+        return {index, false};
+    }
+    keys_.Emplace(keys_.begin() + index, std::forward<KeyArg>(key));
+    return {index, true};
+}
+
+template<typename K, typename Compare>
+template<typename InputIt>
+void FlatSet<K, Compare>::InsertSorted(InputIt first, InputIt last)
+{
+    Merge(Vector<K>(first, last));
+}
+
+template<typename K, typename Compare>
+template<typename InputIt>
+void FlatSet<K, Compare>::InsertUnsorted(InputIt first, InputIt last)
+{
+    Vector<K> run(first, last);
+    std::sort(run.begin(), run.end(), comp_);
+    Merge(std::move(run));
+}
+
+template<typename K, typename Compare>
+bool FlatSet<K, Compare>::Erase(const K& key)
+{
+    const size_t index = IndexOf(key);
+    if (index == keys_.Size())
+    {
+        return false;
+    }
+    EraseAt(index);
+    return true;
+}
+
+template<typename K, typename Compare>
+void FlatSet<K, Compare>::EraseAt(size_t index)
+{
+    assert(index < keys_.Size());
+    keys_.Erase(keys_.begin() + index);
+}
+
+template<typename K, typename Compare>
+void FlatSet<K, Compare>::Merge(Vector<K>&& run)
+{
+    const auto equal = [this](const K& lhs, const K& rhs) { return Equivalent(lhs, rhs); };
+    run.Erase(std::unique(run.begin(), run.end(), equal), run.end());
+    if (run.Size() == 0)
+    {
+        return;
+    }
+    const size_t old_size = keys_.Size();
+    if (old_size == 0 || comp_(keys_[old_size - 1], run[0]))
+    {
+        // Everything goes after the existing keys
+        keys_.Append(std::make_move_iterator(run.begin()), std::make_move_iterator(run.end()));
+        return;
+    }
+    // One merge pass into a new block. Old keys are moved only if that
+    // cannot throw, so the set stays intact if a copy fails
+    Vector<K> merged;
+    merged.Reserve(old_size + run.Size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < old_size || j < run.Size())
+    {
+        if (i == old_size || (j < run.Size() && comp_(run[j], keys_[i])))
+        {
+            merged.EmplaceBack(std::move_if_noexcept(run[j++]));
+            continue;
+        }
+        if (j < run.Size() && !comp_(keys_[i], run[j]))
+        {
+            ++j;
+        }
+        merged.EmplaceBack(std::move_if_noexcept(keys_[i++]));
+    }
+    keys_.Swap(merged);
+}
+
+template<typename K, typename Compare>
+bool FlatSet<K, Compare>::Equivalent(const K& lhs, const K& rhs) const
+{
+    return !comp_(lhs, rhs) && !comp_(rhs, lhs);
+}
+
+template<typename K, typename V, typename Compare>
+FlatMap<K, V, Compare>::FlatMap(const Compare& comp)
+    : comp_(comp)
+{
+}
+
+template<typename K, typename V, typename Compare>
+FlatMap<K, V, Compare>::FlatMap(Vector<K>&& keys, Vector<V>&& values, const Compare& comp)
+    : comp_(comp)
+    , keys_(std::move(keys))
+    , values_(std::move(values))
+{
+    assert(keys_.Size() == values_.Size());
+    Sort();
+}
+
+template<typename K, typename V, typename Compare>
+FlatMap<K, V, Compare>::FlatMap(std::initializer_list<std::pair<K, V>> init, const Compare& comp)
+    : comp_(comp)
+{
+    InsertUnsorted(init.begin(), init.end());
+}
+
+template<typename K, typename V, typename Compare>
+size_t FlatMap<K, V, Compare>::Size() const noexcept
+{
+    return keys_.Size();
+}
+
+template<typename K, typename V, typename Compare>
+void FlatMap<K, V, Compare>::Reserve(size_t new_capacity)
+{
+    keys_.Reserve(new_capacity);
+    values_.Reserve(new_capacity);
+}
+
+template<typename K, typename V, typename Compare>
+void FlatMap<K, V, Compare>::Clear() noexcept
+{
+    keys_.Clear();
+    values_.Clear();
+}
+
+template<typename K, typename V, typename Compare>
+const Vector<K>& FlatMap<K, V, Compare>::Keys() const noexcept
+{
+    return keys_;
+}
+
+template<typename K, typename V, typename Compare>
+const Vector<V>& FlatMap<K, V, Compare>::Values() const noexcept
+{
+    return values_;
+}
+
+template<typename K, typename V, typename Compare>
+Vector<V>& FlatMap<K, V, Compare>::Values() noexcept
+{
+    return values_;
+}
+
+template<typename K, typename V, typename Compare>
+size_t FlatMap<K, V, Compare>::LowerBound(const K& key) const
+{
+    return detail::FlatLowerBound(keys_.begin(), keys_.Size(), key, comp_);
+}
+
+template<typename K, typename V, typename Compare>
+size_t FlatMap<K, V, Compare>::IndexOf(const K& key) const
+{
+    const size_t index = LowerBound(key);
+    return index != keys_.Size() && !comp_(key, keys_[index]) ? index : keys_.Size();
+}
+
+template<typename K, typename V, typename Compare>
+bool FlatMap<K, V, Compare>::Contains(const K& key) const
+{
+    return IndexOf(key) != keys_.Size();
+}
+
+template<typename K, typename V, typename Compare>
+const V* FlatMap<K, V, Compare>::Find(const K& key) const
+{
+    const size_t index = IndexOf(key);
+    return index == keys_.Size() ? nullptr : &values_[index];
+}
+
+template<typename K, typename V, typename Compare>
+V* FlatMap<K, V, Compare>::Find(const K& key)
+{
+    return const_cast<V*>(static_cast<const FlatMap&>(*this).Find(key));
+}
+
+template<typename K, typename V, typename Compare>
+const V& FlatMap<K, V, Compare>::At(const K& key) const
+{
+    const V* value = Find(key);
+    if (value == nullptr)
+    {
+        throw std::out_of_range("FlatMap::At: no such key");
+    }
+    return *value;
+}
+
+template<typename K, typename V, typename Compare>
+V& FlatMap<K, V, Compare>::At(const K& key)
+{
+    return const_cast<V&>(static_cast<const FlatMap&>(*this).At(key));
+}
+
+template<typename K, typename V, typename Compare>
+V& FlatMap<K, V, Compare>::operator[](const K& key)
+{
+    return values_[Emplace(key).first];
+}
+
+template<typename K, typename V, typename Compare>
+template<typename KeyArg, typename... Args>
+std::pair<size_t, bool> FlatMap<K, V, Compare>::Emplace(KeyArg&& key, Args&&... args)
+{
+    const size_t index = LowerBound(key);
+    if (index != keys_.Size() && !comp_(key, keys_[index]))
+    {
+        return {index, false};
+    }
+    keys_.Emplace(keys_.begin() + index, std::forward<KeyArg>(key));
+    try
+    {
+        values_.Emplace(values_.begin() + index, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        keys_.Erase(keys_.begin() + index);
+        throw;
+    }
+    return {index, true};
+}
+
+template<typename K, typename V, typename Compare>
+template<typename KeyArg, typename F>
+std::pair<size_t, bool> FlatMap<K, V, Compare>::InsertOrAssign(KeyArg&& key, F&& value)
+{
+    const size_t index = IndexOf(key);
+    if (index != keys_.Size())
+    {
+        values_[index] = std::forward<F>(value);
+        return {index, false};
+    }
+    return Emplace(std::forward<KeyArg>(key), std::forward<F>(value));
+}
+
+template<typename K, typename V, typename Compare>
+template<typename InputIt>
+void FlatMap<K, V, Compare>::InsertSorted(InputIt first, InputIt last)
+{
+    Vector<K> run_keys;
+    Vector<V> run_values;
+    for (; first != last; ++first)
+    {
+        auto&& entry = *first;
+        run_keys.EmplaceBack(std::forward<decltype(entry)>(entry).first);
+        run_values.EmplaceBack(std::forward<decltype(entry)>(entry).second);
+    }
+    Merge(std::move(run_keys), std::move(run_values));
+}
+
+template<typename K, typename V, typename Compare>
+template<typename InputIt>
+void FlatMap<K, V, Compare>::InsertUnsorted(InputIt first, InputIt last)
+{
+    Vector<K> run_keys;
+    Vector<V> run_values;
+    for (; first != last; ++first)
+    {
+        auto&& entry = *first;
+        run_keys.EmplaceBack(std::forward<decltype(entry)>(entry).first);
+        run_values.EmplaceBack(std::forward<decltype(entry)>(entry).second);
+    }
+    FlatMap run(std::move(run_keys), std::move(run_values), comp_);
+    Merge(std::move(run.keys_), std::move(run.values_));
+}
+
+template<typename K, typename V, typename Compare>
+bool FlatMap<K, V, Compare>::Erase(const K& key)
+{
+    const size_t index = IndexOf(key);
+    if (index == keys_.Size())
+    {
+        return false;
+    }
+    EraseAt(index);
+    return true;
+}
+
+template<typename K, typename V, typename Compare>
+void FlatMap<K, V, Compare>::EraseAt(size_t index)
+{
+    assert(index < keys_.Size());
+    keys_.Erase(keys_.begin() + index);
+    values_.Erase(values_.begin() + index);
+}
+
+template<typename K, typename V, typename Compare>
+void FlatMap<K, V, Compare>::Merge(Vector<K>&& run_keys, Vector<V>&& run_values)
+{
+    const size_t old_size = keys_.Size();
+    if (run_keys.Size() == 0)
+    {
+        return;
+    }
+    if (old_size == 0 || comp_(keys_[old_size - 1], run_keys[0]))
+    {
+        // Everything goes after the existing keys: one Append per vector,
+        // after the duplicates inside the run are squeezed out
+        size_t count = 1;
+        for (size_t j = 1; j < run_keys.Size(); ++j)
+        {
+            if (!comp_(run_keys[count - 1], run_keys[j]))
+            {
+                continue;
+            }
+            if (count != j)
+            {
+                run_keys[count] = std::move(run_keys[j]);
+                run_values[count] = std::move(run_values[j]);
+            }
+            ++count;
+        }
+        keys_.Append(std::make_move_iterator(run_keys.begin()), std::make_move_iterator(run_keys.begin() + count));
+        try
+        {
+            values_.Append(std::make_move_iterator(run_values.begin()), std::make_move_iterator(run_values.begin() + count));
+        }
+        catch (...)
+        {
+            keys_.Erase(keys_.begin() + old_size, keys_.end());
+            throw;
+        }
+        return;
+    }
+    // One merge pass into new blocks. The run is ours to move from, old
+    // entries go through TakeEntry, so the map stays intact if a copy fails
+    Vector<K> merged_keys;
+    Vector<V> merged_values;
+    merged_keys.Reserve(old_size + run_keys.Size());
+    merged_values.Reserve(old_size + run_keys.Size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < old_size || j < run_keys.Size())
+    {
+        if (i == old_size || (j < run_keys.Size() && comp_(run_keys[j], keys_[i])))
+        {
+            if (merged_keys.Size() == 0 || comp_(merged_keys[merged_keys.Size() - 1], run_keys[j]))
+            {
+                merged_keys.EmplaceBack(std::move(run_keys[j]));
+                merged_values.EmplaceBack(std::move(run_values[j]));
+            }
+            ++j;
+            continue;
+        }
+        while (j < run_keys.Size() && !comp_(keys_[i], run_keys[j]))
+        {
+            ++j;
+        }
+        merged_keys.EmplaceBack(TakeEntry(keys_[i]));
+        merged_values.EmplaceBack(TakeEntry(values_[i]));
+        ++i;
+    }
+    keys_.Swap(merged_keys);
+    values_.Swap(merged_values);
+}
+
+template<typename K, typename V, typename Compare>
+template<typename T>
+std::conditional_t<FlatMap<K, V, Compare>::kMoveEntries, T&&, const T&> FlatMap<K, V, Compare>::TakeEntry(T& entry) noexcept
+{
+    if constexpr (kMoveEntries)
+    {
+        return std::move(entry);
+    }
+    else
+    {
+        return entry;
+    }
+}
+
+template<typename K, typename V, typename Compare>
+bool FlatMap<K, V, Compare>::Equivalent(const K& lhs, const K& rhs) const
+{
+    return !comp_(lhs, rhs) && !comp_(rhs, lhs);
+}
+
+template<typename K, typename V, typename Compare>
+void FlatMap<K, V, Compare>::Sort()
+{
+    // Sort a permutation instead of the two vectors, then gather once.
+    // stable_sort keeps the first of equal keys in front
+    Vector<size_t> order(keys_.Size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::stable_sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+        return comp_(keys_[lhs], keys_[rhs]);
+    });
+    Vector<K> sorted_keys;
+    Vector<V> sorted_values;
+    sorted_keys.Reserve(keys_.Size());
+    sorted_values.Reserve(keys_.Size());
+    for (size_t index : order)
+    {
+        if (sorted_keys.Size() != 0 && Equivalent(sorted_keys[sorted_keys.Size() - 1], keys_[index]))
+        {
+            continue;
+        }
+        sorted_keys.EmplaceBack(TakeEntry(keys_[index]));
+        sorted_values.EmplaceBack(TakeEntry(values_[index]));
+    }
+    keys_.Swap(sorted_keys);
+    values_.Swap(sorted_values);
+}
@@ -0,0 +1,623 @@
+#pragma once
+
+#include "vector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Vector whose EmplaceBack never relocates all elements at once. When it is
+// full it allocates the next block and moves a few old elements on every
+// following push, so the worst case push is O(1). While the migration is in
+// progress the elements live in two blocks:
+//     [0, migrated_)        new block
+//     [migrated_, old_end_) old block
+//     [old_end_, size_)     new block
+// Migration moves elements one step at a time, so T must relocate without throwing.
+// Only appending keeps the O(1) bound: Resize and inserting or erasing in
+// the middle finish the migration first and then shift one block, O(N) like Vector
+template <typename T, typename Alloc = std::allocator<T>, typename Growth = DoublingGrowth>
+class IncrementalVector
+{
+    template <typename Vec, typename Value>
+    class Iterator;
+
+public:
+    using value_type = T;
+    using iterator = Iterator<IncrementalVector, T>;
+    using const_iterator = Iterator<const IncrementalVector, const T>;
+    using allocator_type = Alloc;
+    using growth_policy = Growth;
+
+    static_assert(IsTriviallyRelocatable<T>::value || std::is_nothrow_move_constructible_v<T>,
+        "incremental migration needs nothrow relocation");
+
+    // Elements moved per push at least, so a migration ends soon after it begins
+    static constexpr size_t kMinMigrationStep = 2;
+
+    IncrementalVector() = default;
+    explicit IncrementalVector(const Alloc& alloc) noexcept;
+    explicit IncrementalVector(size_t size, const Alloc& alloc = Alloc());
+    template <typename InputIt, typename = std::enable_if_t<detail::IsIterator<InputIt>::value>>
+    IncrementalVector(InputIt first, InputIt last, const Alloc& alloc = Alloc());
+    IncrementalVector(std::initializer_list<T> init, const Alloc& alloc = Alloc());
+    IncrementalVector(const IncrementalVector& other);
+    IncrementalVector& operator=(const IncrementalVector& rhs);
+    IncrementalVector(IncrementalVector&& other) noexcept;
+    IncrementalVector& operator=(IncrementalVector&& rhs) noexcept;
+    ~IncrementalVector();
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+    const_iterator cbegin() const noexcept;
+    const_iterator cend() const noexcept;
+
+    size_t Size() const noexcept;
+    size_t Capacity() const noexcept;
+    allocator_type GetAllocator() const noexcept;
+    bool IsMigrating() const noexcept;
+    // Moves the rest of the old block at once. Afterwards the elements are contiguous
+    void FinishMigration() noexcept;
+    // Contiguous elements, finishing the migration first
+    T* Data() noexcept;
+    void Reserve(size_t new_capacity);
+    void Clear() noexcept;
+    const T& operator[](size_t index) const noexcept;
+    T& operator[](size_t index) noexcept;
+    void Swap(IncrementalVector& other) noexcept;
+    void Resize(size_t new_size);
+    template<typename F>
+    void PushBack(F&& value);
+    void PopBack() noexcept;
+    template<typename... Ts>
+    T& EmplaceBack(Ts&&... vs);
+    template <typename... Ts>
+    iterator Emplace(const_iterator pos, Ts&&... vs);
+    template<typename F>
+    iterator Insert(const_iterator pos, F&& value);
+    iterator Insert(const_iterator pos, size_t count, const T& value);
+    template <typename InputIt, typename = std::enable_if_t<detail::IsIterator<InputIt>::value>>
+    iterator Insert(const_iterator pos, InputIt first, InputIt last);
+    iterator Insert(const_iterator pos, std::initializer_list<T> init);
+    iterator Erase(const_iterator pos) noexcept;
+    iterator Erase(const_iterator first, const_iterator last) noexcept;
+
+private:
+    void MigrateStep() noexcept;
+    void Migrate(size_t count) noexcept;
+    void DestroyAll() noexcept;
+    // Finishes the migration, makes room for count elements at pos_index and
+    // constructs them with init(T* first_uninitialized). If init throws the
+    // vector is left as it was
+    template <typename Init>
+    iterator InsertUninitialized(size_t pos_index, size_t count, Init&& init);
+
+    RawMemory<T, Alloc> data_;
+    // Block being drained into data_, empty when not migrating
+    RawMemory<T, Alloc> old_;
+    size_t size_ = 0;
+    size_t migrated_ = 0;
+    size_t old_end_ = 0;
+    size_t migration_step_ = 0;
+};
+
+template <typename T, typename Alloc, typename Growth>
+template <typename Vec, typename Value>
+class IncrementalVector<T, Alloc, Growth>::Iterator
+{
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::remove_const_t<Value>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    Iterator() = default;
+    Iterator(Vec* vector, size_t index) noexcept
+        : vector_(vector)
+        , index_(index)
+    {
+    }
+    // iterator converts to const_iterator
+    template <typename OtherVec, typename OtherValue,
+        typename = std::enable_if_t<std::is_convertible_v<OtherValue*, Value*>>>
+    Iterator(const Iterator<OtherVec, OtherValue>& other) noexcept
+        : vector_(other.vector_)
+        , index_(other.index_)
+    {
+    }
+
+    reference operator*() const noexcept { return (*vector_)[index_]; }
+    pointer operator->() const noexcept { return &(*vector_)[index_]; }
+    reference operator[](difference_type n) const noexcept { return (*vector_)[index_ + n]; }
+
+    Iterator& operator++() noexcept { ++index_; return *this; }
+    Iterator operator++(int) noexcept { Iterator old = *this; ++index_; return old; }
+    Iterator& operator--() noexcept { --index_; return *this; }
+    Iterator operator--(int) noexcept { Iterator old = *this; --index_; return old; }
+    Iterator& operator+=(difference_type n) noexcept { index_ += n; return *this; }
+    Iterator& operator-=(difference_type n) noexcept { index_ -= n; return *this; }
+    friend Iterator operator+(Iterator it, difference_type n) noexcept { return it += n; }
+    friend Iterator operator+(difference_type n, Iterator it) noexcept { return it += n; }
+    friend Iterator operator-(Iterator it, difference_type n) noexcept { return it -= n; }
+    friend difference_type operator-(const Iterator& lhs, const Iterator& rhs) noexcept
+    {
+        return static_cast<difference_type>(lhs.index_) - static_cast<difference_type>(rhs.index_);
+    }
+
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ == rhs.index_; }
+    friend bool operator!=(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ != rhs.index_; }
+    friend bool operator<(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ < rhs.index_; }
+    friend bool operator>(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ > rhs.index_; }
+    friend bool operator<=(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ <= rhs.index_; }
+    friend bool operator>=(const Iterator& lhs, const Iterator& rhs) noexcept { return lhs.index_ >= rhs.index_; }
+
+private:
+    template <typename, typename>
+    friend class Iterator;
+
+    Vec* vector_ = nullptr;
+    size_t index_ = 0;
+};
+
+template<typename T, typename Alloc, typename Growth>
+IncrementalVector<T, Alloc, Growth>::IncrementalVector(const Alloc& alloc) noexcept
+    : data_(alloc)
+    , old_(alloc)
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+IncrementalVector<T, Alloc, Growth>::IncrementalVector(size_t size, const Alloc& alloc)
+    : data_(size, alloc)
+    , old_(alloc)
+{
+    std::uninitialized_value_construct_n(data_.GetAddress(), size);
+    size_ = size;
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename InputIt, typename>
+IncrementalVector<T, Alloc, Growth>::IncrementalVector(InputIt first, InputIt last, const Alloc& alloc)
+    : IncrementalVector(alloc)
+{
+    Insert(end(), first, last);
+}
+
+template<typename T, typename Alloc, typename Growth>
+IncrementalVector<T, Alloc, Growth>::IncrementalVector(std::initializer_list<T> init, const Alloc& alloc)
+    : IncrementalVector(init.begin(), init.end(), alloc)
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+IncrementalVector<T, Alloc, Growth>::IncrementalVector(const IncrementalVector& other)
+    : data_(other.size_, std::allocator_traits<Alloc>::select_on_container_copy_construction(other.data_.GetAllocator()))
+    , old_(data_.GetAllocator())
+{
+    // The copy is contiguous even if other is migrating
+    try
+    {
+        for (; size_ < other.size_; ++size_)
+        {
+            new (data_ + size_) T(other[size_]);
+        }
+    }
+    catch (...)
+    {
+        std::destroy_n(data_.GetAddress(), size_);
+        throw;
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+IncrementalVector<T, Alloc, Growth>& IncrementalVector<T, Alloc, Growth>::operator=(const IncrementalVector& rhs)
+{
+    if (this != &rhs)
+    {
+        IncrementalVector rhs_copy(rhs);
+        Swap(rhs_copy);
+    }
+    return *this;
+}
+
+template<typename T, typename Alloc, typename Growth>
+IncrementalVector<T, Alloc, Growth>::IncrementalVector(IncrementalVector&& other) noexcept
+    : data_(std::move(other.data_))
+    , old_(std::move(other.old_))
+    , size_(std::exchange(other.size_, 0))
+    , migrated_(std::exchange(other.migrated_, 0))
+    , old_end_(std::exchange(other.old_end_, 0))
+    , migration_step_(other.migration_step_)
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+IncrementalVector<T, Alloc, Growth>& IncrementalVector<T, Alloc, Growth>::operator=(IncrementalVector&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        IncrementalVector rhs_move(std::move(rhs));
+        Swap(rhs_move);
+    }
+    return *this;
+}
+
+template<typename T, typename Alloc, typename Growth>
+IncrementalVector<T, Alloc, Growth>::~IncrementalVector()
+{
+    DestroyAll();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename IncrementalVector<T, Alloc, Growth>::iterator IncrementalVector<T, Alloc, Growth>::begin() noexcept
+{
+    return iterator(this, 0);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename IncrementalVector<T, Alloc, Growth>::iterator IncrementalVector<T, Alloc, Growth>::end() noexcept
+{
+    return iterator(this, size_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename IncrementalVector<T, Alloc, Growth>::const_iterator IncrementalVector<T, Alloc, Growth>::begin() const noexcept
+{
+    return const_iterator(this, 0);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename IncrementalVector<T, Alloc, Growth>::const_iterator IncrementalVector<T, Alloc, Growth>::end() const noexcept
+{
+    return const_iterator(this, size_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename IncrementalVector<T, Alloc, Growth>::const_iterator IncrementalVector<T, Alloc, Growth>::cbegin() const noexcept
+{
+    return begin();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename IncrementalVector<T, Alloc, Growth>::const_iterator IncrementalVector<T, Alloc, Growth>::cend() const noexcept
+{
+    return end();
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t IncrementalVector<T, Alloc, Growth>::Size() const noexcept
+{
+    return size_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t IncrementalVector<T, Alloc, Growth>::Capacity() const noexcept
+{
+    return data_.Capacity();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename IncrementalVector<T, Alloc, Growth>::allocator_type IncrementalVector<T, Alloc, Growth>::GetAllocator() const noexcept
+{
+    return data_.GetAllocator();
+}
+
+template<typename T, typename Alloc, typename Growth>
+bool IncrementalVector<T, Alloc, Growth>::IsMigrating() const noexcept
+{
+    return old_.GetAddress() != nullptr;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void IncrementalVector<T, Alloc, Growth>::FinishMigration() noexcept
+{
+    if (IsMigrating())
+    {
+        Migrate(old_end_ - migrated_);
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+T* IncrementalVector<T, Alloc, Growth>::Data() noexcept
+{
+    FinishMigration();
+    return data_.GetAddress();
+}
+
+template<typename T, typename Alloc, typename Growth>
+void IncrementalVector<T, Alloc, Growth>::Reserve(size_t new_capacity)
+{
+    if (new_capacity <= data_.Capacity())
+    {
+        return;
+    }
+    // An explicit Reserve is allowed to take O(N)
+    RawMemory<T, Alloc> new_data(new_capacity, data_.GetAllocator());
+    FinishMigration();
+    detail::Relocate(data_.GetAddress(), size_, new_data.GetAddress());
+    data_.Swap(new_data);
+}
+
+template<typename T, typename Alloc, typename Growth>
+void IncrementalVector<T, Alloc, Growth>::Clear() noexcept
+{
+    DestroyAll();
+    RawMemory<T, Alloc> empty(old_.GetAllocator());
+    old_.Swap(empty);
+    size_ = 0;
+    migrated_ = 0;
+    old_end_ = 0;
+}
+
+template<typename T, typename Alloc, typename Growth>
+const T& IncrementalVector<T, Alloc, Growth>::operator[](size_t index) const noexcept
+{
+    return const_cast<IncrementalVector&>(*this)[index];
+}
+
+template<typename T, typename Alloc, typename Growth>
+T& IncrementalVector<T, Alloc, Growth>::operator[](size_t index) noexcept
+{
+    assert(index < size_);
+    if (index >= migrated_ && index < old_end_)
+    {
+        return old_[index];
+    }
+    return data_[index];
+}
+
+template<typename T, typename Alloc, typename Growth>
+void IncrementalVector<T, Alloc, Growth>::Swap(IncrementalVector& other) noexcept
+{
+    data_.Swap(other.data_);
+    old_.Swap(other.old_);
+    std::swap(size_, other.size_);
+    std::swap(migrated_, other.migrated_);
+    std::swap(old_end_, other.old_end_);
+    std::swap(migration_step_, other.migration_step_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+void IncrementalVector<T, Alloc, Growth>::Resize(size_t new_size)
+{
+    // Growing in place would outrun the migration steps, so it ends here
+    FinishMigration();
+    if (new_size < size_)
+    {
+        std::destroy_n(data_ + new_size, size_ - new_size);
+    }
+    else if (new_size > size_)
+    {
+        Reserve(new_size);
+        std::uninitialized_value_construct_n(data_ + size_, new_size - size_);
+    }
+    size_ = new_size;
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename F>
+void IncrementalVector<T, Alloc, Growth>::PushBack(F&& value)
+{
+    EmplaceBack(std::forward<F>(value));
+}
+
+template<typename T, typename Alloc, typename Growth>
+void IncrementalVector<T, Alloc, Growth>::PopBack() noexcept
+{
+    assert(size_ > 0);
+    std::destroy_at(&(*this)[size_ - 1]);
+    --size_;
+    if (size_ < old_end_)
+    {
+        // The last element came from the old block, so the new region is empty
+        old_end_ = size_;
+        migrated_ = std::min(migrated_, old_end_);
+        Migrate(0);
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename... Ts>
+T& IncrementalVector<T, Alloc, Growth>::EmplaceBack(Ts&&... vs)
+{
+    T* result;
+    if (size_ == data_.Capacity())
+    {
+        // Cannot be migrating: every push moves enough elements to finish
+        // the migration before the new block fills up
+        assert(!IsMigrating());
+        const size_t new_capacity = Growth::NextCapacity(size_, sizeof(T));
+        RawMemory<T, Alloc> new_data(new_capacity, data_.GetAllocator());
+        result = new (new_data + size_) T(std::forward<Ts>(vs)...);
+        old_.Swap(data_);
+        data_.Swap(new_data);
+        migrated_ = 0;
+        old_end_ = size_;
+        const size_t free_slots = new_capacity - size_;
+        migration_step_ = std::max(kMinMigrationStep, (size_ + free_slots - 1) / free_slots);
+    }
+    else
+    {
+        result = new (data_ + size_) T(std::forward<Ts>(vs)...);
+    }
+    ++size_;
+    MigrateStep();
+    return *result;
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename... Ts>
+typename IncrementalVector<T, Alloc, Growth>::iterator IncrementalVector<T, Alloc, Growth>::Emplace(const_iterator pos, Ts&&... vs)
+{
+    assert(pos >= cbegin() && pos <= cend());
+    const size_t pos_index = pos - cbegin();
+    if (pos_index == size_)
+    {
+        EmplaceBack(std::forward<Ts>(vs)...);
+        return iterator(this, pos_index);
+    }
+    // Built before anything moves: vs may refer to an element
+    T value(std::forward<Ts>(vs)...);
+    return InsertUninitialized(pos_index, 1, [&value](T* to)
+        {
+            new (to) T(std::move(value));
+        });
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename F>
+typename IncrementalVector<T, Alloc, Growth>::iterator IncrementalVector<T, Alloc, Growth>::Insert(const_iterator pos, F&& value)
+{
+    return Emplace(pos, std::forward<F>(value));
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename IncrementalVector<T, Alloc, Growth>::iterator IncrementalVector<T, Alloc, Growth>::Insert(const_iterator pos, size_t count, const T& value)
+{
+    assert(pos >= cbegin() && pos <= cend());
+    // value may be an element of this vector
+    const T value_copy(value);
+    return InsertUninitialized(pos - cbegin(), count, [&value_copy, count](T* first)
+        {
+            std::uninitialized_fill_n(first, count, value_copy);
+        });
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename InputIt, typename>
+typename IncrementalVector<T, Alloc, Growth>::iterator IncrementalVector<T, Alloc, Growth>::Insert(const_iterator pos, InputIt first, InputIt last)
+{
+    assert(pos >= cbegin() && pos <= cend());
+    const size_t pos_index = pos - cbegin();
+    if constexpr (detail::kIsForwardIterator<InputIt>)
+    {
+        const size_t count = std::distance(first, last);
+        return InsertUninitialized(pos_index, count, [first, count](T* to)
+            {
+                std::uninitialized_copy_n(first, count, to);
+            });
+    }
+    else
+    {
+        const size_t old_size = size_;
+        for (; first != last; ++first)
+        {
+            EmplaceBack(*first);
+        }
+        T* elements = Data();
+        std::rotate(elements + pos_index, elements + old_size, elements + size_);
+        return iterator(this, pos_index);
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename IncrementalVector<T, Alloc, Growth>::iterator IncrementalVector<T, Alloc, Growth>::Insert(const_iterator pos, std::initializer_list<T> init)
+{
+    return Insert(pos, init.begin(), init.end());
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename IncrementalVector<T, Alloc, Growth>::iterator IncrementalVector<T, Alloc, Growth>::Erase(const_iterator pos) noexcept
+{
+    assert(pos >= cbegin() && pos < cend());
+    return Erase(pos, pos + 1);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename IncrementalVector<T, Alloc, Growth>::iterator IncrementalVector<T, Alloc, Growth>::Erase(const_iterator first, const_iterator last) noexcept
+{
+    assert(first >= cbegin() && first <= last && last <= cend());
+    const size_t first_index = first - cbegin();
+    const size_t count = last - first;
+    if (count != 0)
+    {
+        FinishMigration();
+        std::destroy_n(data_ + first_index, count);
+        detail::RelocateOverlapping(data_ + first_index + count, size_ - first_index - count, data_ + first_index);
+        size_ -= count;
+    }
+    return iterator(this, first_index);
+}
+
+template<typename T, typename Alloc, typename Growth>
+void IncrementalVector<T, Alloc, Growth>::MigrateStep() noexcept
+{
+    if (IsMigrating())
+    {
+        Migrate(std::min(migration_step_, old_end_ - migrated_));
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+void IncrementalVector<T, Alloc, Growth>::Migrate(size_t count) noexcept
+{
+    detail::Relocate(old_ + migrated_, count, data_ + migrated_);
+    migrated_ += count;
+    if (migrated_ == old_end_)
+    {
+        RawMemory<T, Alloc> drained(old_.GetAllocator());
+        old_.Swap(drained);
+        migrated_ = 0;
+        old_end_ = 0;
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+void IncrementalVector<T, Alloc, Growth>::DestroyAll() noexcept
+{
+    if (IsMigrating())
+    {
+        std::destroy_n(data_.GetAddress(), migrated_);
+        std::destroy_n(old_ + migrated_, old_end_ - migrated_);
+        std::destroy_n(data_ + old_end_, size_ - old_end_);
+    }
+    else
+    {
+        std::destroy_n(data_.GetAddress(), size_);
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename Init>
+typename IncrementalVector<T, Alloc, Growth>::iterator IncrementalVector<T, Alloc, Growth>::InsertUninitialized(size_t pos_index, size_t count, Init&& init)
+{
+    assert(pos_index <= size_);
+    FinishMigration();
+    if (count == 0)
+    {
+        return iterator(this, pos_index);
+    }
+    if (size_ + count > data_.Capacity())
+    {
+        const size_t new_capacity = std::max(size_ + count, Growth::NextCapacity(size_, sizeof(T)));
+        RawMemory<T, Alloc> new_data(new_capacity, data_.GetAllocator());
+        init(new_data + pos_index);
+        detail::Relocate(data_.GetAddress(), pos_index, new_data.GetAddress());
+        detail::Relocate(data_ + pos_index, size_ - pos_index, new_data + pos_index + count);
+        data_.Swap(new_data);
+    }
+    else
+    {
+        // Shifting cannot fail, so a throwing init is undone by shifting back
+        detail::RelocateOverlapping(data_ + pos_index, size_ - pos_index, data_ + pos_index + count);
+        try
+        {
+            init(data_ + pos_index);
+        }
+        catch (...)
+        {
+            detail::RelocateOverlapping(data_ + pos_index + count, size_ - pos_index, data_ + pos_index);
+            throw;
+        }
+    }
+    size_ += count;
+    return iterator(this, pos_index);
+}
@@ -1,8 +1,29 @@
 #include "vector.h"
+#include "mmap_allocator.h"
+#include "mapped_vector.h"
+#include "serialization.h"
+#include "incremental_vector.h"
+#include "concurrent_vector.h"
+#include "vector_algorithms.h"
+#include "soa_vector.h"
+#include "chunked_vector.h"
+#include "devector.h"
+#include "shared_vector.h"
+#include "block_cache.h"
+#include "flat_map.h"
+#include "static_vector.h"
+#include "deferred_destroy.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 namespace {
 
@@ -98,8 +119,193 @@ struct Obj {
     static inline int num_destroyed = 0;
 };
 
+template <typename T, bool Propagate = true>
+struct CountingAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::bool_constant<Propagate>;
+    using propagate_on_container_move_assignment = std::bool_constant<Propagate>;
+    using propagate_on_container_swap = std::bool_constant<Propagate>;
+    using is_always_equal = std::false_type;
+
+    explicit CountingAllocator(int id = 0)
+        : id(id)  //
+    {
+    }
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U, Propagate>& other)
+        : id(other.id)  //
+    {
+    }
+
+    T* allocate(size_t n) {
+        ++num_allocations;
+        return static_cast<T*>(operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        ++num_deallocations;
+        operator delete(p);
+    }
+
+    friend bool operator==(const CountingAllocator& lhs, const CountingAllocator& rhs) {
+        return lhs.id == rhs.id;
+    }
+
+    friend bool operator!=(const CountingAllocator& lhs, const CountingAllocator& rhs) {
+        return !(lhs == rhs);
+    }
+
+    static void ResetCounters() {
+        num_allocations = 0;
+        num_deallocations = 0;
+    }
+
+    int id = 0;
+
+    static inline int num_allocations = 0;
+    static inline int num_deallocations = 0;
+};
+
+// Перемещается побайтовым копированием, что разрешено специализацией IsTriviallyRelocatable
+struct RelocatableObj {
+    RelocatableObj() = default;
+    explicit RelocatableObj(int id)
+        : id(std::make_unique<int>(id))  //
+    {
+    }
+    RelocatableObj(RelocatableObj&& other) noexcept
+        : id(std::move(other.id))  //
+    {
+        ++num_moved;
+    }
+    RelocatableObj& operator=(RelocatableObj&& other) noexcept {
+        id = std::move(other.id);
+        ++num_moved;
+        return *this;
+    }
+
+    std::unique_ptr<int> id;
+
+    static inline int num_moved = 0;
+};
+
+// Заполняет выделенную память известным значением, чтобы было видно, какие байты инициализированы
+template <typename T>
+struct PatternAllocator {
+    using value_type = T;
+    static constexpr unsigned char PATTERN = 0xAB;
+
+    PatternAllocator() = default;
+    template <typename U>
+    PatternAllocator(const PatternAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        void* p = operator new(n * sizeof(T));
+        std::memset(p, PATTERN, n * sizeof(T));
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        operator delete(p);
+    }
+
+    friend bool operator==(const PatternAllocator&, const PatternAllocator&) {
+        return true;
+    }
+
+    friend bool operator!=(const PatternAllocator&, const PatternAllocator&) {
+        return false;
+    }
+};
+
+// Счётчик живых объектов атомарный, поэтому их можно создавать
+// и уничтожать из нескольких потоков одновременно
+struct SharedObj {
+    SharedObj() {
+        ++alive;
+    }
+    SharedObj(const SharedObj& other)
+        : id(other.id)  //
+    {
+        if (other.id == THROW_ON_COPY_ID) {
+            throw std::runtime_error("Oops");
+        }
+        ++alive;
+    }
+    SharedObj& operator=(const SharedObj& other) = default;
+    ~SharedObj() {
+        --alive;
+    }
+
+    static constexpr int THROW_ON_COPY_ID = -1;
+
+    int id = 0;
+    std::string name = std::string(32, 'x');
+
+    static inline std::atomic<int> alive = 0;
+};
+
+// Перемещение может выбросить исключение, поэтому контейнеры его копируют.
+// Годится и как ключ, и как значение FlatMap
+struct ThrowingMoveObj {
+    explicit ThrowingMoveObj(int id)
+        : id(id)  //
+    {
+    }
+    ThrowingMoveObj(const ThrowingMoveObj& other)
+        : throw_on_copy(other.throw_on_copy)
+        , id(other.id)  //
+    {
+        if (other.throw_on_copy) {
+            throw std::runtime_error("Oops");
+        }
+    }
+    ThrowingMoveObj(ThrowingMoveObj&& other) noexcept(false)
+        : id(other.id)  //
+    {
+    }
+    ThrowingMoveObj& operator=(const ThrowingMoveObj& other) = default;
+
+    bool operator<(const ThrowingMoveObj& other) const {
+        return id < other.id;
+    }
+
+    bool throw_on_copy = false;
+    int id = 0;
+};
+
+// Только перемещаемый тип, перемещение которого может выбросить исключение
+struct ThrowingMoveOnly {
+    explicit ThrowingMoveOnly(int id)
+        : id(id)  //
+    {
+        ++alive;
+    }
+    ThrowingMoveOnly(const ThrowingMoveOnly&) = delete;
+    ThrowingMoveOnly(ThrowingMoveOnly&& other) noexcept(false)
+        : id(other.id)  //
+    {
+        if (move_throw_countdown > 0 && --move_throw_countdown == 0) {
+            throw std::runtime_error("Oops");
+        }
+        ++alive;
+    }
+    ThrowingMoveOnly& operator=(ThrowingMoveOnly&& other) = default;
+    ~ThrowingMoveOnly() {
+        --alive;
+    }
+
+    static inline int alive = 0;
+    static inline int move_throw_countdown = 0;
+    int id = 0;
+};
+
 }  // namespace
 
+template <>
+struct IsTriviallyRelocatable<RelocatableObj> : std::true_type {};
+
 void Test1() {
     Obj::ResetCounters();
     const size_t SIZE = 100500;
@@ -380,6 +586,1886 @@ void Test5() {
     }
 }
 
+void Test6() {
+    const size_t SIZE = 10;
+    {
+        using Alloc = CountingAllocator<int>;
+        Alloc::ResetCounters();
+        {
+            Vector<int, Alloc> v(SIZE, Alloc{1});
+            assert(Alloc::num_allocations == 1);
+            v.PushBack(42);
+            assert(Alloc::num_allocations == 2);
+            assert(Alloc::num_deallocations == 1);
+
+            Vector<int, Alloc> v_copy(v);
+            assert(v_copy.GetAllocator().id == 1);
+
+            Vector<int, Alloc> v_other(Alloc{2});
+            v_other = std::move(v);
+            assert(v_other.GetAllocator().id == 1);
+            assert(v_other.Size() == SIZE + 1);
+            assert(v_other[SIZE] == 42);
+        }
+        assert(Alloc::num_allocations == Alloc::num_deallocations);
+    }
+    {
+        using Alloc = CountingAllocator<Obj, false>;
+        Obj::ResetCounters();
+        Alloc::ResetCounters();
+        {
+            Vector<Obj, Alloc> v(SIZE, Alloc{1});
+            Vector<Obj, Alloc> v_other(Alloc{2});
+            v_other = std::move(v);
+            assert(v_other.GetAllocator().id == 2);
+            assert(v_other.Size() == SIZE);
+            assert(Obj::num_moved == SIZE);
+
+            Vector<Obj, Alloc> v_copy(Alloc{3});
+            v_copy = v_other;
+            assert(v_copy.GetAllocator().id == 3);
+            assert(Obj::num_copied == SIZE);
+        }
+        assert(Alloc::num_allocations == Alloc::num_deallocations);
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+}
+
+void Test7() {
+    const size_t SIZE = 100;
+    const int ID = 42;
+    static_assert(IsTriviallyRelocatable<int>::value);
+    static_assert(IsTriviallyRelocatable<std::unique_ptr<int>>::value);
+    static_assert(!IsTriviallyRelocatable<Obj>::value);
+    {
+        RelocatableObj::num_moved = 0;
+        Vector<RelocatableObj> v;
+        for (size_t i = 0; i < SIZE; ++i) {
+            v.EmplaceBack(static_cast<int>(i));
+        }
+        v.Reserve(SIZE * 4);
+        assert(RelocatableObj::num_moved == 0);
+        assert(v.Size() == SIZE);
+        for (size_t i = 0; i < SIZE; ++i) {
+            assert(*v[i].id == static_cast<int>(i));
+        }
+    }
+    {
+        Vector<std::unique_ptr<int>> v;
+        v.EmplaceBack(std::make_unique<int>(ID));
+        v.Emplace(v.begin(), std::make_unique<int>(ID + 1));
+        assert(*v[0] == ID + 1);
+        assert(*v[1] == ID);
+    }
+}
+
+void Test8() {
+    const int SIZE = 100'000;
+    {
+        Vector<int, MallocAllocator<int>> v;
+        for (int i = 0; i < SIZE; ++i) {
+            v.PushBack(i);
+        }
+        v.PushBack(v[0]);
+        v.Emplace(v.begin() + 1, -1);
+        v.Reserve(SIZE * 4);
+        assert(v.Size() == SIZE + 2);
+        assert(v.Capacity() == SIZE * 4);
+        assert(v[0] == 0 && v[1] == -1 && v[SIZE + 1] == 0);
+        for (int i = 1; i < SIZE; ++i) {
+            assert(v[i + 1] == i);
+        }
+    }
+    {
+        Vector<std::unique_ptr<int>, MallocAllocator<std::unique_ptr<int>>> v;
+        for (int i = 0; i < 10; ++i) {
+            v.EmplaceBack(std::make_unique<int>(i));
+        }
+        v.Emplace(v.begin(), std::make_unique<int>(-1));
+        assert(*v[0] == -1 && *v[10] == 9);
+    }
+    {
+        // Размер в байтах переполнился бы и превратился в 4
+        const size_t WRAPPING = SIZE_MAX / sizeof(int) + 2;
+        MallocAllocator<int> alloc;
+        bool thrown = false;
+        try {
+            alloc.allocate(WRAPPING);
+        } catch (const std::bad_array_new_length&) {
+            thrown = true;
+        }
+        assert(thrown);
+        int* p = alloc.allocate(1);
+        thrown = false;
+        try {
+            p = alloc.reallocate(p, 1, WRAPPING);
+        } catch (const std::bad_array_new_length&) {
+            thrown = true;
+        }
+        assert(thrown);
+        alloc.deallocate(p, 1);
+    }
+}
+
+void Test9() {
+    static_assert(OneAndHalfGrowth::NextCapacity(0, 4) == 1);
+    static_assert(OneAndHalfGrowth::NextCapacity(1, 4) == 2);
+    static_assert(OneAndHalfGrowth::NextCapacity(100, 4) == 150);
+    static_assert(CacheLineGrowth<>::NextCapacity(0, 4) == 16);
+    static_assert(CacheLineGrowth<>::NextCapacity(32, 4) == 64);
+    static_assert(SizeClassGrowth<>::RoundToSizeClass(100) == 112);
+    static_assert(SizeClassGrowth<>::RoundToSizeClass(1000) == 1024);
+    static_assert(SizeClassGrowth<>::RoundToSizeClass(1100) == 1280);
+    static_assert(SizeClassGrowth<OneAndHalfGrowth>::NextCapacity(100, 8) == 160);
+    {
+        Vector<int, std::allocator<int>, CacheLineGrowth<OneAndHalfGrowth>> v;
+        v.PushBack(1);
+        assert(v.Capacity() == 16);
+        for (int i = 0; i < 16; ++i) {
+            v.Emplace(v.begin(), i);
+        }
+        assert(v.Size() == 17);
+        assert(v.Capacity() == 24);
+        assert(v[0] == 15 && v[16] == 1);
+    }
+}
+
+void Test10() {
+    const size_t N = 4;
+    const int ID = 42;
+    using namespace std::literals;
+    Obj::ResetCounters();
+    {
+        SmallVector<Obj, N> v;
+        assert(v.IsInline() && v.Capacity() == N);
+        for (size_t i = 0; i < N; ++i) {
+            v.EmplaceBack(static_cast<int>(i));
+        }
+        assert(v.IsInline());
+        v.Emplace(v.begin(), ID, "Ivan"s);
+        assert(!v.IsInline());
+        assert(v.Capacity() == N * 2);
+        assert(v.Size() == N + 1);
+        assert(v[0].id == ID && v[0].name == "Ivan"s);
+        assert(v[N].id == static_cast<int>(N - 1));
+        v.Erase(v.begin());
+        assert(v[0].id == 0);
+
+        SmallVector<Obj, N> small(2);
+        SmallVector<Obj, N> other_small(3);
+        small.Swap(v);
+        assert(small.Size() == N && !small.IsInline());
+        assert(v.Size() == 2 && v.IsInline());
+        v.Swap(other_small);
+        assert(v.Size() == 3 && other_small.Size() == 2);
+
+        SmallVector<Obj, N> copy(small);
+        assert(copy.Size() == N && copy[N - 1].id == static_cast<int>(N - 1));
+        copy = v;
+        assert(copy.Size() == 3);
+        SmallVector<Obj, N> moved(std::move(small));
+        assert(moved.Size() == N && small.Size() == 0);
+        moved.Resize(1);
+        moved.PopBack();
+        assert(moved.Size() == 0);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        SmallVector<TestObj, 1> v(1);
+        v.PushBack(v[0]);
+        assert(v[0].IsAlive());
+        assert(v[1].IsAlive());
+    }
+    {
+        Obj::ResetCounters();
+        SmallVector<Obj, N> v(N);
+        try {
+            v[N / 2].throw_on_copy = true;
+            SmallVector<Obj, N> v_copy(v);
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(Obj::GetAliveObjectCount() == N);
+    }
+}
+
+void Test11() {
+    const int ID = 42;
+    {
+        Vector<int> v{1, 2, 3};
+        assert(v.Size() == 3 && v.Capacity() == 3);
+        const int extra[] = {4, 5, 6, 7};
+        v.Append(std::begin(extra), std::end(extra));
+        assert(v.Size() == 7 && v.Capacity() == 7);
+        v.Insert(v.begin() + 1, {10, 11});
+        v.Insert(v.end(), 2, ID);
+        v.Insert(v.begin(), 3, v[0]);
+        const int expected[] = {1, 1, 1, 1, 10, 11, 2, 3, 4, 5, 6, 7, ID, ID};
+        assert(v.Size() == std::size(expected));
+        assert(std::equal(v.begin(), v.end(), std::begin(expected)));
+    }
+    {
+        std::istringstream input("1 2 3");
+        Vector<int> v(std::istream_iterator<int>{input}, std::istream_iterator<int>{});
+        assert(v.Size() == 3 && v[2] == 3);
+        std::istringstream more("7 8");
+        v.Insert(v.begin() + 1, std::istream_iterator<int>{more}, std::istream_iterator<int>{});
+        const int expected[] = {1, 7, 8, 2, 3};
+        assert(std::equal(v.begin(), v.end(), std::begin(expected)));
+    }
+    {
+        const size_t SIZE = 10;
+        Obj::ResetCounters();
+        Vector<Obj> objs(SIZE);
+        objs.Reserve(SIZE * 2);
+        Vector<Obj> v(SIZE);
+        v.Reserve(SIZE * 2);
+        const int moves_before = Obj::num_moved;
+        v.Insert(v.begin() + SIZE / 2, objs.begin(), objs.end());
+        assert(v.Size() == SIZE * 2 && v.Capacity() == SIZE * 2);
+        assert(Obj::num_moved - moves_before == static_cast<int>(SIZE / 2));
+        assert(Obj::num_copied == static_cast<int>(SIZE));
+
+        objs[SIZE / 2].throw_on_copy = true;
+        try {
+            v.Insert(v.begin(), objs.begin(), objs.end());
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == SIZE * 2);
+        assert(Obj::GetAliveObjectCount() == static_cast<int>(SIZE * 3));
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+void Test12() {
+    {
+        Vector<int> v{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+        auto it = v.Erase(v.begin() + 2, v.begin() + 5);
+        assert(it == v.begin() + 2 && *it == 5);
+        assert(EraseIf(v, [](int x) { return x % 2 == 1; }) == 4);
+        const int expected[] = {0, 6, 8};
+        assert(v.Size() == std::size(expected));
+        assert(std::equal(v.begin(), v.end(), std::begin(expected)));
+        assert(v.Erase(v.begin(), v.end()) == v.end() && v.Size() == 0);
+    }
+    {
+        Vector<std::unique_ptr<int>> v;
+        for (int i = 0; i < 10; ++i) {
+            v.EmplaceBack(std::make_unique<int>(i));
+        }
+        assert(EraseIf(v, [](const auto& p) { return *p < 2 || *p % 3 == 0; }) == 5);
+        const int expected[] = {2, 4, 5, 7, 8};
+        for (size_t i = 0; i < v.Size(); ++i) {
+            assert(*v[i] == expected[i]);
+        }
+        int calls = 0;
+        try {
+            EraseIf(v, [&calls](const auto& p) {
+                if (++calls == 6) {
+                    throw std::runtime_error("Oops");
+                }
+                return *p == 4;
+            });
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == 4 && *v[1] == 5 && *v[3] == 8);
+    }
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(10);
+        for (size_t i = 0; i < v.Size(); ++i) {
+            v[i].id = static_cast<int>(i);
+        }
+        v.Erase(v.begin() + 1, v.begin() + 3);
+        assert(EraseIf(v, [](const Obj& obj) { return obj.id > 7; }) == 2);
+        assert(v.Size() == 6 && v[1].id == 3);
+        assert(Obj::GetAliveObjectCount() == 6);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+void Test13() {
+    const size_t SIZE = 100;
+    using Alloc = PatternAllocator<unsigned char>;
+    {
+        Vector<unsigned char, Alloc> v(SIZE, default_init);
+        assert(v.Size() == SIZE);
+        assert(std::all_of(v.begin(), v.end(), [](unsigned char c) { return c == Alloc::PATTERN; }));
+        v.Resize(SIZE * 2);
+        assert(std::all_of(v.begin() + SIZE, v.end(), [](unsigned char c) { return c == 0; }));
+        v.Reserve(SIZE * 4);
+        v.ResizeDefaultInit(SIZE * 4);
+        assert(std::all_of(v.begin() + SIZE * 2, v.end(), [](unsigned char c) { return c == Alloc::PATTERN; }));
+        v.ResizeDefaultInit(1);
+        assert(v.Size() == 1);
+    }
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(SIZE, default_init);
+        v.ResizeDefaultInit(SIZE * 2);
+        assert(Obj::num_default_constructed == SIZE * 2);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+void Test14() {
+    const size_t SIZE = 100;
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(SIZE);
+        v.Reserve(SIZE * 4);
+        assert(v.ShrinkTo(SIZE * 8) == 0);
+        assert(v.ShrinkTo(SIZE * 2) == SIZE * 2 * sizeof(Obj));
+        assert(v.Capacity() == SIZE * 2);
+        assert(v.ShrinkTo(0) == SIZE * sizeof(Obj));
+        assert(v.Capacity() == SIZE && v.Size() == SIZE);
+        assert(Obj::GetAliveObjectCount() == SIZE);
+        v.Resize(SIZE / 2);
+        assert(v.ShrinkToFit() == SIZE / 2 * sizeof(Obj));
+        assert(v.Capacity() == SIZE / 2);
+        v.Clear();
+        assert(v.Size() == 0 && v.Capacity() == SIZE / 2);
+        assert(Obj::GetAliveObjectCount() == 0);
+        assert(v.ShrinkToFit() == SIZE / 2 * sizeof(Obj));
+        assert(v.Capacity() == 0 && v.begin() == nullptr);
+    }
+    {
+        Vector<int, MallocAllocator<int>> v(SIZE);
+        v[SIZE - 1] = 42;
+        v.Reserve(SIZE * 4);
+        assert(v.ShrinkToFit() == SIZE * 3 * sizeof(int));
+        assert(v.Capacity() == SIZE && v[SIZE - 1] == 42);
+    }
+}
+
+// Счётчики собираются только при сборке с -DVECTOR_ENABLE_STATS
+void Test15() {
+    ResetVectorStats();
+    {
+        Vector<Obj> v;
+        v.SetStatsTag("objects");
+        for (int i = 0; i < 4; ++i) {
+            v.EmplaceBack(i);
+        }
+        Vector<std::unique_ptr<int>> ptrs;
+        VECTOR_STATS_TAG_HERE(ptrs);
+        ptrs.Reserve(2);
+        ptrs.EmplaceBack(nullptr);
+        ptrs.EmplaceBack(nullptr);
+        ptrs.EmplaceBack(nullptr);
+        Vector<Obj> v_copy(v);
+        // Учитывается ёмкость, выданная аллокатором, а не запрошенная
+        Vector<float, AlignedAllocator<float, 64>> aligned;
+        aligned.SetStatsTag("aligned");
+        for (int i = 0; i < 20; ++i) {
+            aligned.PushBack(static_cast<float>(i));
+        }
+        assert(aligned.Capacity() == 32);
+    }
+    const auto snapshot = GetVectorStatsSnapshot();
+#ifdef VECTOR_ENABLE_STATS
+    const VectorStats& objects = snapshot.at("objects");
+    assert(objects.allocations == 4);
+    assert(objects.reallocations == 2);
+    assert(objects.relocated_by_move == 1 + 2);
+    assert(objects.relocated_by_copy == 0);
+    assert(objects.bytes_allocated == (1 + 2 + 4 + 4) * sizeof(Obj));
+    assert(objects.peak_capacity_bytes == 4 * sizeof(Obj));
+    const auto ptrs_stats = std::find_if(snapshot.begin(), snapshot.end(), [](const auto& item) {
+        return item.first.find("main.cpp:") != std::string::npos;
+    });
+    assert(ptrs_stats != snapshot.end());
+    assert(ptrs_stats->second.relocated_bitwise == 2);
+    assert(ptrs_stats->second.relocated_by_move == 0);
+    const VectorStats& aligned = snapshot.at("aligned");
+    assert(aligned.peak_capacity_bytes == 32 * sizeof(float));
+    assert(aligned.bytes_allocated % 64 == 0);
+#else
+    assert(snapshot.empty());
+#endif
+}
+
+void Test16() {
+    constexpr size_t ALIGNMENT = 64;
+    const auto is_aligned = [](const void* p) {
+        return reinterpret_cast<uintptr_t>(p) % ALIGNMENT == 0;
+    };
+    {
+        Vector<float, AlignedAllocator<float, ALIGNMENT>> v(3);
+        assert(is_aligned(v.begin()));
+        assert(v.Size() == 3 && v.Capacity() == 16);
+        for (int i = 0; i < 17; ++i) {
+            v.PushBack(static_cast<float>(i));
+        }
+        assert(is_aligned(v.begin()));
+        assert(v.Capacity() == 32);
+        v.Reserve(33);
+        assert(v.Capacity() == 48 && is_aligned(v.begin()));
+        assert(v[3] == 0.0f && v[19] == 16.0f);
+    }
+    {
+        Vector<double, AlignedAllocator<double, ALIGNMENT, false>> v(3);
+        assert(is_aligned(v.begin()));
+        assert(v.Capacity() == 3);
+    }
+    {
+        Vector<Obj, AlignedAllocator<Obj, ALIGNMENT>> v(2);
+        assert(is_aligned(v.begin()));
+        assert(v.Capacity() == 2);
+    }
+    {
+        // Без дополнения до блока размер в байтах ещё помещается в size_t, с ним переполняется
+        AlignedAllocator<float, ALIGNMENT> alloc;
+        for (size_t n : {SIZE_MAX / sizeof(float) - 2, SIZE_MAX / sizeof(float) + 2}) {
+            bool thrown = false;
+            try {
+                alloc.allocate(n);
+            } catch (const std::bad_array_new_length&) {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+    }
+}
+
+void Test17() {
+    const int SIZE = 1'000'000;
+    {
+        using Alloc = MmapAllocator<int>;
+        const size_t page_ints = static_cast<size_t>(sysconf(_SC_PAGESIZE)) / sizeof(int);
+        Vector<int, Alloc> v(Alloc{SIZE * sizeof(int) * 2});
+        v.PushBack(0);
+        assert(v.Capacity() == page_ints);
+        const int* const first = v.begin();
+        for (int i = 1; i < SIZE; ++i) {
+            v.PushBack(i);
+        }
+        assert(v.begin() == first);
+        v.Reserve(SIZE * 2);
+        assert(v.begin() == first);
+        assert(v[SIZE - 1] == SIZE - 1);
+        v.Reserve(SIZE * 4);
+        assert(v.begin() != first);
+        assert(v[SIZE - 1] == SIZE - 1);
+    }
+    {
+        Obj::ResetCounters();
+        Vector<Obj, MmapAllocator<Obj>> v;
+        const Obj* const first = &v.EmplaceBack(1);
+        for (int i = 0; i < 1000; ++i) {
+            v.EmplaceBack(i);
+        }
+        assert(&v[0] == first);
+        assert(Obj::num_moved == 0 && Obj::num_copied == 0);
+        Vector<Obj, MmapAllocator<Obj>> v_copy(v);
+        assert(v_copy.Size() == v.Size());
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+void Test18() {
+    struct Point {
+        int x;
+        double y;
+    };
+    const std::string path = "/tmp/mapped_vector_test_" + std::to_string(getpid());
+    const int SIZE = 100'000;
+    unlink(path.c_str());
+    {
+        auto v = MappedVector<Point>::OpenReadWrite(path);
+        assert(v.Size() == 0 && !v.IsReadOnly());
+        for (int i = 0; i < SIZE; ++i) {
+            v.PushBack(Point{i, i * 0.5});
+        }
+        v.Flush();
+    }
+    {
+        // Файл открывается без разбора: элементы читаются прямо из отображения
+        const auto v = MappedVector<Point>::OpenReadOnly(path);
+        assert(v.IsReadOnly());
+        assert(v.Size() == SIZE && v.Capacity() >= SIZE);
+        assert(v[SIZE - 1].x == SIZE - 1 && v[SIZE - 1].y == (SIZE - 1) * 0.5);
+    }
+    {
+        auto v = MappedVector<Point>::OpenReadWrite(path);
+        v.Resize(SIZE * 3);
+        assert(v[SIZE - 1].x == SIZE - 1);
+        assert(v[SIZE * 3 - 1].x == 0);
+        v.PopBack();
+        assert(v.Size() == SIZE * 3 - 1);
+    }
+    {
+        bool thrown = false;
+        try {
+            auto v = MappedVector<int>::OpenReadOnly(path);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    {
+        // Ёмкость в заголовке, при которой размер файла переполняет size_t
+        static_assert(sizeof(Point) == 16);
+        const uint64_t capacity = uint64_t{1} << 60;
+        const size_t CAPACITY_OFFSET = 32;
+        const int fd = open(path.c_str(), O_WRONLY);
+        assert(pwrite(fd, &capacity, sizeof(capacity), CAPACITY_OFFSET) == sizeof(capacity));
+        close(fd);
+        bool thrown = false;
+        try {
+            auto v = MappedVector<Point>::OpenReadOnly(path);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    unlink(path.c_str());
+}
+
+void Test19() {
+    struct Pair {
+        int key;
+        float value;
+    };
+    {
+        Vector<Pair> v;
+        for (int i = 0; i < 1000; ++i) {
+            v.PushBack(Pair{i, i * 2.0f});
+        }
+        Vector<unsigned char> buffer;
+        VectorWriter writer(buffer);
+        Serialize(writer, v);
+        assert(buffer.Size() == sizeof(SerializedHeader) + v.Size() * sizeof(Pair));
+
+        BufferReader reader(buffer.begin(), buffer.Size());
+        Vector<Pair> restored;
+        Deserialize(reader, restored);
+        assert(reader.Remaining() == 0);
+        assert(restored.Size() == v.Size() && restored.Capacity() == v.Size());
+        assert(std::memcmp(restored.begin(), v.begin(), v.Size() * sizeof(Pair)) == 0);
+
+        // Тип элементов не совпадает
+        BufferReader wrong_reader(buffer.begin(), buffer.Size());
+        Vector<int> wrong;
+        bool thrown = false;
+        try {
+            Deserialize(wrong_reader, wrong);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    {
+        // Через файл: запись одним writev, чтение одним read
+        const std::string path = "/tmp/serialization_test_" + std::to_string(getpid());
+        Vector<int> v(100'000);
+        for (size_t i = 0; i < v.Size(); ++i) {
+            v[i] = static_cast<int>(i);
+        }
+        Vector<Vector<std::string>> nested;
+        nested.EmplaceBack(Vector<std::string>{"a", "bc", std::string(100, 'x')});
+        nested.EmplaceBack();
+        {
+            const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            FdWriter writer(fd);
+            Serialize(writer, v);
+            Serialize(writer, nested);
+            close(fd);
+        }
+        const int fd = open(path.c_str(), O_RDONLY);
+        FdReader reader(fd);
+        Vector<int> restored;
+        Deserialize(reader, restored);
+        Vector<Vector<std::string>> restored_nested;
+        Deserialize(reader, restored_nested);
+        close(fd);
+        unlink(path.c_str());
+        assert(restored.Size() == v.Size() && restored[99'999] == 99'999);
+        assert(restored_nested.Size() == 2 && restored_nested[1].Size() == 0);
+        assert(restored_nested[0][2] == std::string(100, 'x'));
+    }
+    {
+        // Обрыв данных оставляет вектор пустым
+        Vector<std::string> v{"first", "second"};
+        Vector<unsigned char> buffer;
+        VectorWriter writer(buffer);
+        Serialize(writer, v);
+        BufferReader reader(buffer.begin(), buffer.Size() - 1);
+        Vector<std::string> restored{"old"};
+        bool thrown = false;
+        try {
+            Deserialize(reader, restored);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && restored.Size() == 0);
+    }
+    {
+        // Испорченный счётчик отклоняется до выделения памяти
+        Vector<unsigned char> buffer;
+        VectorWriter writer(buffer);
+        Serialize(writer, Vector<int>{1, 2, 3});
+        SerializedHeader header;
+        std::memcpy(&header, buffer.begin(), sizeof(header));
+        for (uint64_t count : {uint64_t{4}, uint64_t{1} << 40, ~uint64_t{0}}) {
+            header.count = count;
+            std::memcpy(buffer.begin(), &header, sizeof(header));
+            BufferReader reader(buffer.begin(), buffer.Size());
+            Vector<int> restored{7};
+            bool thrown = false;
+            try {
+                Deserialize(reader, restored);
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown && restored.Size() == 0 && restored.Capacity() <= 1);
+        }
+
+        Vector<unsigned char> strings;
+        VectorWriter strings_writer(strings);
+        Serialize(strings_writer, Vector<std::string>{"a"});
+        std::memcpy(&header, strings.begin(), sizeof(header));
+        header.count = uint64_t{1} << 40;
+        std::memcpy(strings.begin(), &header, sizeof(header));
+        BufferReader reader(strings.begin(), strings.Size());
+        Vector<std::string> restored;
+        bool thrown = false;
+        try {
+            Deserialize(reader, restored);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && restored.Capacity() == 0);
+    }
+    {
+        // Испорченная длина строки: отказ без попытки выделить память под неё
+        Vector<unsigned char> buffer;
+        VectorWriter writer(buffer);
+        Serialize(writer, Vector<std::string>{"abc"});
+        const uint64_t length = uint64_t{1} << 40;
+        std::memcpy(buffer.begin() + sizeof(SerializedHeader), &length, sizeof(length));
+        BufferReader reader(buffer.begin(), buffer.Size());
+        Vector<std::string> restored;
+        bool thrown = false;
+        try {
+            Deserialize(reader, restored);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && restored.Size() == 0);
+
+        // Из файла длина заранее неизвестна: строка растёт по мере чтения
+        const std::string path = "/tmp/serialization_length_test_" + std::to_string(getpid());
+        const int out = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        assert(write(out, buffer.begin(), buffer.Size()) == static_cast<ssize_t>(buffer.Size()));
+        close(out);
+        const int fd = open(path.c_str(), O_RDONLY);
+        FdReader file_reader(fd);
+        thrown = false;
+        try {
+            Deserialize(file_reader, restored);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        close(fd);
+        unlink(path.c_str());
+        assert(thrown && restored.Size() == 0);
+    }
+    {
+        // Ошибка в заголовке тоже оставляет вектор пустым
+        const unsigned char garbage[sizeof(SerializedHeader)] = {};
+        BufferReader reader(garbage, sizeof(garbage));
+        Vector<int> restored{1, 2, 3};
+        bool thrown = false;
+        try {
+            Deserialize(reader, restored);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && restored.Size() == 0);
+    }
+}
+
+void Test20() {
+    {
+        // Буфер из C API: владение переходит к вектору без копирования
+        const size_t CAPACITY = 16;
+        int* raw = static_cast<int*>(std::malloc(CAPACITY * sizeof(int)));
+        for (int i = 0; i < 10; ++i) {
+            raw[i] = i;
+        }
+        int freed = 0;
+        {
+            Vector<int> v;
+            v.Adopt(raw, 10, CAPACITY, [&freed](int* p, size_t capacity) {
+                assert(capacity == 16);
+                std::free(p);
+                ++freed;
+            });
+            assert(v.begin() == raw && v.Size() == 10 && v.Capacity() == CAPACITY);
+            v.PushBack(10);
+            assert(v.begin() == raw);
+            v.Reserve(CAPACITY * 2);
+            assert(freed == 1);
+            assert(v.begin() != raw && v[10] == 10);
+        }
+        assert(freed == 1);
+    }
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(5);
+        const Obj* const data = v.begin();
+        ReleasedBuffer<Obj> released = v.Release();
+        assert(v.Size() == 0 && v.Capacity() == 0 && v.begin() == nullptr);
+        assert(released.data == data && released.size == 5 && released.capacity == 5);
+        assert(Obj::GetAliveObjectCount() == 5);
+
+        Vector<Obj> other;
+        other.Adopt(released.data, released.size, released.capacity, std::move(released.deleter));
+        assert(other.begin() == data && other.Size() == 5);
+        assert(Obj::num_copied == 0 && Obj::num_moved == 0);
+        Vector<Obj> moved(std::move(other));
+        assert(moved.begin() == data);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+void Test21() {
+    const size_t SIZE = 100'000;
+    const ParallelPolicy policy{4, 1000};
+    {
+        Vector<SharedObj> v(SIZE, policy);
+        assert(v.Size() == SIZE && SharedObj::alive == static_cast<int>(SIZE));
+        for (size_t i = 0; i < SIZE; ++i) {
+            v[i].id = static_cast<int>(i);
+        }
+        Vector<SharedObj> copy(v, policy);
+        assert(copy.Size() == SIZE && copy[SIZE - 1].id == static_cast<int>(SIZE - 1));
+
+        // Присваивание поверх существующих элементов и в новый буфер
+        Vector<SharedObj> small(10);
+        small.Assign(v, policy);
+        assert(small.Size() == SIZE && small[12'345].id == 12'345);
+        copy.Resize(SIZE / 2);
+        copy.Assign(v, policy);
+        assert(copy.Size() == SIZE && copy[SIZE - 1].id == static_cast<int>(SIZE - 1));
+        Vector<SharedObj> shorter(SIZE / 4, policy);
+        copy.Assign(shorter, policy);
+        assert(copy.Size() == SIZE / 4 && copy[0].id == 0);
+
+        // Исключение в одной из частей: созданные в других частях объекты уничтожаются
+        v[SIZE * 3 / 4].id = SharedObj::THROW_ON_COPY_ID;
+        const int alive = SharedObj::alive;
+        bool thrown = false;
+        try {
+            Vector<SharedObj> failed(v, policy);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && SharedObj::alive == alive);
+
+        Vector<SharedObj> target(Vector<SharedObj>(5));
+        thrown = false;
+        try {
+            target.Assign(v, policy);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && target.Size() == 5 && SharedObj::alive == alive + 5);
+
+        v.Clear(policy);
+        assert(v.Size() == 0 && v.Capacity() == SIZE);
+    }
+    assert(SharedObj::alive == 0);
+    {
+        // Меньше порога: всё делается в вызывающем потоке
+        Vector<int> v(100, ParallelPolicy{});
+        assert(v.Size() == 100 && v[99] == 0);
+    }
+}
+
+void Test22() {
+    using Growth = ParallelRelocation<DoublingGrowth, 1000, 4>;
+    const int SIZE = 100'000;
+    {
+        Vector<std::string, std::allocator<std::string>, Growth> v;
+        for (int i = 0; i < SIZE; ++i) {
+            v.PushBack(std::to_string(i) + std::string(20, 'x'));
+        }
+        v.Reserve(SIZE * 3);
+        assert(v.Capacity() == SIZE * 3);
+        for (int i = 0; i < SIZE; i += 997) {
+            assert(v[i] == std::to_string(i) + std::string(20, 'x'));
+        }
+        v.ShrinkToFit();
+        v.Emplace(v.begin() + SIZE / 2, "middle");
+        assert(v[SIZE / 2] == "middle" && v[SIZE] == std::to_string(SIZE - 1) + std::string(20, 'x'));
+    }
+    {
+        // Перемещение может выбросить исключение: остаётся обычное копирование
+        Vector<SharedObj, std::allocator<SharedObj>, Growth> v(SIZE);
+        v.Reserve(SIZE * 2);
+        assert(v.Size() == SIZE && SharedObj::alive == SIZE);
+    }
+    assert(SharedObj::alive == 0);
+}
+
+void Test23() {
+    const int SIZE = 10'000;
+    {
+        IncrementalVector<std::string> v;
+        size_t max_capacity_jump = 0;
+        for (int i = 0; i < SIZE; ++i) {
+            const size_t capacity = v.Capacity();
+            v.PushBack(std::to_string(i));
+            max_capacity_jump = std::max(max_capacity_jump, v.Capacity() - capacity);
+            // Все элементы доступны во время переноса
+            assert(v[i] == std::to_string(i));
+            assert(v[i / 2] == std::to_string(i / 2));
+        }
+        assert(v.Size() == SIZE);
+        int index = 0;
+        for (const std::string& s : v) {
+            assert(s == std::to_string(index++));
+        }
+        IncrementalVector<std::string> copy(v);
+        assert(copy.Size() == SIZE && !copy.IsMigrating() && copy[SIZE - 1] == std::to_string(SIZE - 1));
+        v.FinishMigration();
+        assert(!v.IsMigrating() && v.Data()[SIZE - 1] == std::to_string(SIZE - 1));
+    }
+    {
+        // Перенос идёт не больше нескольких элементов за вставку
+        Obj::ResetCounters();
+        IncrementalVector<Obj> v;
+        for (int i = 0; i < 1024; ++i) {
+            v.EmplaceBack(i);
+        }
+        assert(!v.IsMigrating());
+        const int moved = Obj::num_moved;
+        v.EmplaceBack(1024);
+        assert(v.IsMigrating() && Obj::num_moved - moved == 2);
+        v.EmplaceBack(1025);
+        assert(Obj::num_moved - moved == 4);
+        // Удаление элементов, ещё оставшихся в старом буфере
+        for (int i = 0; i < 1000; ++i) {
+            v.PopBack();
+        }
+        assert(v.Size() == 26 && v[25].id == 25 && v[0].id == 0);
+        IncrementalVector<Obj> moved_to(std::move(v));
+        assert(moved_to.Size() == 26 && moved_to[3].id == 3);
+        moved_to.Reserve(5000);
+        assert(!moved_to.IsMigrating() && moved_to[25].id == 25);
+        moved_to.Clear();
+        assert(moved_to.Size() == 0);
+    }
+    {
+        // Вставка и удаление в середине во время переноса
+        IncrementalVector<std::string> v{"a", "b", "c"};
+        assert(v.Size() == 3 && v[2] == "c");
+        for (int i = 0; v.Size() < 1025; ++i) {
+            v.EmplaceBack(std::to_string(i));
+        }
+        assert(v.IsMigrating());
+        auto it = v.Insert(v.begin() + 1, v[0]);
+        assert(!v.IsMigrating() && it == v.begin() + 1 && *it == "a" && v[2] == "b");
+        v.Insert(v.begin(), {"x", "y"});
+        assert(v.Size() == 1028 && v[0] == "x" && v[1] == "y" && v[2] == "a");
+        v.Insert(v.end(), 2, std::string("z"));
+        assert(v.Size() == 1030 && v[1029] == "z");
+        it = v.Erase(v.begin(), v.begin() + 2);
+        assert(*it == "a" && v.Size() == 1028);
+        v.Erase(v.begin() + 1);
+        assert(v[1] == "b" && v[2] == "c");
+        v.Resize(3);
+        assert(v.Size() == 3 && v[2] == "c");
+        v.Resize(5);
+        assert(v.Size() == 5 && v[4].empty());
+
+        const Vector<std::string> source{"p", "q"};
+        IncrementalVector<std::string> from_range(source.begin(), source.end());
+        assert(from_range.Size() == 2 && from_range[1] == "q");
+        IncrementalVector<int> sized(10);
+        assert(sized.Size() == 10 && sized[9] == 0);
+    }
+    {
+        // Исключение при вставке оставляет вектор прежним
+        IncrementalVector<Obj> v;
+        for (int i = 0; i < 8; ++i) {
+            v.EmplaceBack(i);
+        }
+        v.Reserve(16);
+        // Копирование второго элемента выбрасывает: и со сдвигом на месте, и с новым блоком
+        for (size_t count : {size_t{2}, size_t{20}}) {
+            Vector<Obj> source(count);
+            source[1].throw_on_copy = true;
+            bool thrown = false;
+            try {
+                v.Insert(v.begin() + 3, source.begin(), source.end());
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown && v.Size() == 8);
+            for (int i = 0; i < 8; ++i) {
+                assert(v[i].id == i);
+            }
+        }
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+void Test24() {
+    const int THREADS = 4;
+    const int PER_THREAD = 20'000;
+    {
+        ConcurrentVector<std::string> v;
+        const std::string* first = &v.EmplaceBack("first");
+        std::thread threads[THREADS];
+        for (int t = 0; t < THREADS; ++t) {
+            threads[t] = std::thread([&v, t] {
+                for (int i = 0; i < PER_THREAD; ++i) {
+                    v.PushBack(std::to_string(t * PER_THREAD + i));
+                }
+            });
+        }
+        // Читать можно одновременно со вставкой
+        for (size_t i = 0; i < 1000; ++i) {
+            const size_t size = v.Size();
+            if (size > 0 && v.IsReady(size - 1)) {
+                assert(!v[size - 1].empty());
+            }
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        // Адреса элементов не меняются
+        assert(&v[0] == first && *first == "first");
+        assert(v.Size() == THREADS * PER_THREAD + 1);
+
+        Vector<std::string> frozen = v.Freeze();
+        assert(v.Size() == 0);
+        assert(frozen.Size() == THREADS * PER_THREAD + 1 && frozen[0] == "first");
+        Vector<bool> seen(THREADS * PER_THREAD);
+        for (size_t i = 1; i < frozen.Size(); ++i) {
+            const int value = std::stoi(frozen[i]);
+            assert(!seen[value]);
+            seen[value] = true;
+        }
+    }
+    {
+        ConcurrentVector<SharedObj> v;
+        v.Reserve(1000);
+        SharedObj throwing;
+        throwing.id = SharedObj::THROW_ON_COPY_ID;
+        v.EmplaceBack();
+        try {
+            v.PushBack(throwing);
+        } catch (const std::runtime_error&) {
+        }
+        v.EmplaceBack();
+        assert(v.Size() == 3 && !v.IsReady(1) && v.IsReady(2));
+        assert(v.Freeze().Size() == 2);
+    }
+    assert(SharedObj::alive == 0);
+}
+
+template <typename T>
+void CheckAlgorithms(const T* data, size_t count) {
+    // Эталон: простые циклы
+    size_t find_index = count;
+    size_t zeros = 0;
+    SumType<T> sum = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (find_index == count && data[i] == T(7)) {
+            find_index = i;
+        }
+        zeros += data[i] == T(0);
+        sum += data[i];
+    }
+    assert(Find(data, count, T(7)) == find_index);
+    assert(Count(data, count, T(0)) == zeros);
+    // Для float слагаемые кратны 0.5, поэтому сумма точная при любом порядке
+    assert(Sum(data, count) == sum);
+    if (count > 0) {
+        const auto [min, max] = MinMax(data, count);
+        assert(min == *std::min_element(data, data + count));
+        assert(max == *std::max_element(data, data + count));
+    }
+}
+
+void Test25() {
+    const SimdLevel best = GetSimdLevel();
+    for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        SetSimdLevel(level);
+        // Разные длины и смещения проверяют невыровненное начало и хвост
+        Vector<int32_t, AlignedAllocator<int32_t, 64>> ints(1000);
+        Vector<float> floats(1000);
+        for (size_t i = 0; i < ints.Size(); ++i) {
+            ints[i] = static_cast<int32_t>((i * 7919) % 101) - 50;
+            floats[i] = static_cast<float>(ints[i]) * 0.5f;
+        }
+        ints[500] = std::numeric_limits<int32_t>::max();
+        ints[501] = std::numeric_limits<int32_t>::max();
+        for (size_t offset : {0, 1, 3}) {
+            for (size_t count : {0, 1, 5, 16, 17, 63, 64, 65, 999 - 3}) {
+                CheckAlgorithms(ints.begin() + offset, count);
+                CheckAlgorithms(floats.begin() + offset, count);
+            }
+        }
+        Vector<int32_t, AlignedAllocator<int32_t, 64>> copy(ints);
+        assert(Equal(ints, copy) && Compare(ints, copy) == 0);
+        copy[700] = 1000;
+        assert(!Equal(ints, copy) && Compare(ints, copy) < 0 && Compare(copy, ints) > 0);
+        copy.PopBack();
+        assert(Mismatch(ints.begin(), copy.begin(), copy.Size()) == 700);
+
+        Fill(copy, 3);
+        assert(Count(copy, 3) == copy.Size());
+        Vector<int32_t, AlignedAllocator<int32_t, 64>> out;
+        Transform(ints, copy, out, ElementwiseOp::MIN);
+        assert(out.Size() == copy.Size() && out[0] == std::min(ints[0], 3) && out[998] == std::min(ints[998], 3));
+        Transform(out, copy, out, ElementwiseOp::ADD);
+        assert(out[10] == std::min(ints[10], 3) + 3);
+        Vector<float> fout;
+        Transform(floats, floats, fout, ElementwiseOp::MULTIPLY);
+        assert(fout[999] == floats[999] * floats[999]);
+        assert(*Find(floats, floats[123]) == floats[123]);
+    }
+    SetSimdLevel(best);
+    assert(GetSimdLevel() == best);
+
+    // Сравнение векторов
+    Vector<std::string> a{"a", "b"};
+    Vector<std::string> b{"a", "c"};
+    assert(a == a && a != b && a < b && b > a && a <= a && b >= a);
+    assert((Vector<int>{1, 2} < Vector<int>{1, 2, 3}));
+}
+
+void Test26() {
+    {
+        SoAVector<int, double, std::string> v;
+        for (int i = 0; i < 100; ++i) {
+            v.EmplaceBack(i, i * 0.5, std::to_string(i));
+        }
+        assert(v.Size() == 100 && v.Capacity() == 128);
+        auto [id, weight, name] = v[42];
+        assert(id == 42 && weight == 21.0 && name == "42");
+        // Ссылки ведут прямо в столбцы
+        name = "changed";
+        assert(std::get<2>(v[42]) == "changed");
+        v[43] = std::tuple<int, double, std::string>{-1, -1.0, "minus"};
+        assert(std::get<0>(v[43]) == -1 && std::get<2>(v[43]) == "minus");
+
+        // Столбец лежит непрерывно
+        const auto ids = v.Column<0>();
+        assert(ids.Size() == 100 && ids[10] == 10 && ids.Data() + 1 == &ids[1]);
+        double total = 0;
+        for (double w : v.Column<1>()) {
+            total += w;
+        }
+        assert(total == 0.5 * (99 * 100 / 2) - 21.5 - 1.0);
+
+        v.Erase(0, 10);
+        assert(v.Size() == 90 && std::get<0>(v[0]) == 10 && std::get<2>(v[89]) == "99");
+        v.Erase(5);
+        assert(std::get<0>(v[5]) == 16);
+        v.Resize(200);
+        assert(std::get<0>(v[199]) == 0 && std::get<2>(v[199]).empty());
+        v.Resize(3);
+        v.PopBack();
+        assert(v.Size() == 2);
+
+        SoAVector<int, double, std::string> copy(v);
+        assert(copy.Size() == 2 && std::get<2>(copy[1]) == "11");
+        // Вставка элемента этого же вектора при реаллокации
+        copy.Reserve(2);
+        copy.EmplaceBack(std::get<0>(copy[0]), std::get<1>(copy[0]), std::get<2>(copy[0]));
+        assert(std::get<2>(copy[2]) == "10");
+    }
+    {
+        // Исключение при копировании одного из полей оставляет вектор без изменений
+        Obj::ResetCounters();
+        {
+            SoAVector<std::string, Obj> v;
+            Obj throwing(1);
+            throwing.throw_on_copy = true;
+            v.EmplaceBack("a", Obj(0));
+            bool thrown = false;
+            try {
+                v.EmplaceBack("b", throwing);
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown && v.Size() == 1 && std::get<0>(v[0]) == "a");
+            // Поле Obj перемещается без исключений, поэтому реаллокация тоже перемещает
+            const int copied = Obj::num_copied;
+            v.Reserve(100);
+            assert(Obj::num_copied == copied && std::get<1>(v[0]).id == 0);
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+    {
+        // Поле с выбрасывающим перемещающим присваиванием сдвигается копированием
+        struct Field {
+            explicit Field(int id)
+                : id(id)  //
+            {
+            }
+            Field(const Field&) = default;
+            Field(Field&&) = default;
+            Field& operator=(const Field&) = default;
+            Field& operator=(Field&&) noexcept(false) {
+                throw std::runtime_error("Oops");
+            }
+
+            int id;
+        };
+        SoAVector<std::string, Field> v;
+        for (int i = 0; i < 5; ++i) {
+            v.EmplaceBack(std::to_string(i), Field(i));
+        }
+        v.Erase(1, 3);
+        assert(v.Size() == 3);
+        for (size_t i = 0; i < v.Size(); ++i) {
+            const int id = i == 0 ? 0 : static_cast<int>(i) + 2;
+            assert(std::get<0>(v[i]) == std::to_string(id) && std::get<1>(v[i]).id == id);
+        }
+    }
+}
+
+void Test27() {
+    {
+        ChunkedVector<std::string, 16> v;
+        v.EmplaceBack("first");
+        const std::string* first = &v[0];
+        for (int i = 1; i < 1000; ++i) {
+            v.PushBack(std::to_string(i));
+        }
+        // Рост не перемещает элементы
+        assert(&v[0] == first && *first == "first");
+        assert(v.Size() == 1000 && v.ChunkCount() == 63 && v.Capacity() == 1008);
+        assert(v[999] == "999" && *(v.begin() + 500) == "500" && v.end() - v.begin() == 1000);
+        // Вставка элемента этого же вектора на границе чанка
+        while (v.Size() != v.Capacity()) {
+            v.EmplaceBack("x");
+        }
+        v.PopBack();
+        v.EmplaceBack("x");
+        v.EmplaceBack(v[0]);
+        assert(v.Size() == 1009 && v[1008] == "first" && v.ChunkCount() == 64);
+
+        std::sort(v.begin() + 1, v.end() - 1);
+        assert(std::is_sorted(v.begin() + 1, v.end() - 1));
+
+        ChunkedVector<std::string, 16> copy(v);
+        assert(copy.Size() == v.Size() && std::equal(copy.begin(), copy.end(), v.cbegin()));
+
+        const Vector<std::string> flat = v.Flatten();
+        assert(flat.Size() == 1009 && flat[1008] == "first" && v.Size() == 1009);
+        const Vector<std::string> moved = std::move(copy).Flatten();
+        assert(moved.Size() == 1009 && copy.Size() == 0 && copy.ChunkCount() == 0);
+        assert(moved[0] == "first");
+    }
+    {
+        ChunkedVector<int, 256> v;
+        v.Reserve(10000);
+        assert(v.ChunkCount() == 40);
+        for (int i = 0; i < 10000; ++i) {
+            v.EmplaceBack(i);
+        }
+        assert(v.ChunkCount() == 40);
+        // Чанки обрабатываются параллельно
+        std::atomic<long long> sum = 0;
+        std::atomic<size_t> elements = 0;
+        v.ForEachChunk(ParallelPolicy{4, 1}, [&](int* first, size_t count) {
+            long long local = 0;
+            for (size_t i = 0; i < count; ++i) {
+                first[i] *= 2;
+                local += first[i];
+            }
+            sum += local;
+            elements += count;
+        });
+        assert(elements == 10000 && sum == 2LL * 9999 * 10000 / 2);
+        const ChunkedVector<int, 256>& cv = v;
+        size_t chunks = 0;
+        cv.ForEachChunk([&](const int* first, size_t count) {
+            assert(first[0] == static_cast<int>(chunks * 512) && count <= 256);
+            ++chunks;
+        });
+        assert(chunks == 40);
+        v.Clear();
+        assert(v.Size() == 0 && v.Capacity() == 10240);
+    }
+    {
+        // Копирование, которое бросает исключение, не оставляет живых объектов
+        Obj::ResetCounters();
+        {
+            ChunkedVector<Obj, 4> v;
+            for (int i = 0; i < 10; ++i) {
+                v.EmplaceBack(i);
+            }
+            v[7].throw_on_copy = true;
+            bool thrown = false;
+            try {
+                ChunkedVector<Obj, 4> copy(v);
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown && Obj::GetAliveObjectCount() == 10);
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+}
+
+void Test28() {
+    {
+        // Очередь: вставка в конец и удаление из начала без роста ёмкости
+        Devector<int> q;
+        for (int i = 0; i < 64; ++i) {
+            q.EmplaceBack(i);
+        }
+        size_t capacity = 0;
+        for (int i = 64; i < 100000; ++i) {
+            if (i == 1000) {
+                capacity = q.Capacity();
+            }
+            q.PopFront();
+            q.PushBack(i);
+        }
+        assert(q.Size() == 64 && q.Capacity() == capacity && capacity <= 128);
+        assert(q[0] == 100000 - 64 && q[63] == 99999 && q.end() - q.begin() == 64);
+    }
+    {
+        Devector<std::string> v;
+        for (int i = 0; i < 100; ++i) {
+            v.EmplaceFront(std::to_string(i));
+        }
+        assert(v.Size() == 100 && v[0] == "99" && v[99] == "0");
+        // Вставка элемента этого же вектора при реаллокации в начале и в конце
+        while (v.FrontCapacity() != 0) {
+            v.EmplaceFront("x");
+        }
+        v.EmplaceFront(v[v.Size() - 1]);
+        assert(v[0] == "0");
+        while (v.BackCapacity() != 0) {
+            v.EmplaceBack("y");
+        }
+        v.EmplaceBack(v[0]);
+        assert(v[v.Size() - 1] == "0");
+
+        // Вставка и удаление в середине сдвигают более короткую сторону
+        Devector<std::string> w{"a", "b", "c", "d", "e", "f"};
+        w.Reserve(20);
+        w.Insert(w.begin() + 1, w[4]);
+        assert(w.Size() == 7 && w[1] == "e" && w[2] == "b" && w[6] == "f");
+        w.Erase(w.begin() + 1);
+        w.Erase(w.begin() + 4, w.end() - 1);
+        assert(w.Size() == 5 && w[0] == "a" && w[3] == "d" && w[4] == "f");
+        w.Erase(w.begin(), w.begin() + 2);
+        assert(w.Size() == 3 && w[0] == "c" && w.FrontCapacity() >= 2);
+        w.Resize(10);
+        assert(w.Size() == 10 && w[9].empty() && w[2] == "f");
+
+        Devector<std::string> copy(w);
+        assert(copy.Size() == 10 && std::equal(copy.begin(), copy.end(), w.cbegin()));
+        copy.Clear();
+        assert(copy.Size() == 0 && copy.FrontCapacity() == copy.Capacity() / 2);
+    }
+    {
+        // Сдвиг внутри блока: каждый элемент остаётся на своём месте
+        Devector<int> v;
+        v.Reserve(64);
+        for (int i = 0; i < 10; ++i) {
+            v.EmplaceBack(i);
+        }
+        for (int i = 0; i < 50; ++i) {
+            v.Emplace(v.begin() + v.Size() / 3, -i);
+            v.Emplace(v.begin() + 2 * v.Size() / 3, 1000 + i);
+            if (i % 3 == 0) {
+                v.Erase(v.begin() + v.Size() / 2);
+            }
+        }
+        Vector<int> expected;
+        for (int i = 0; i < 10; ++i) {
+            expected.EmplaceBack(i);
+        }
+        for (int i = 0; i < 50; ++i) {
+            expected.Emplace(expected.begin() + expected.Size() / 3, -i);
+            expected.Emplace(expected.begin() + 2 * expected.Size() / 3, 1000 + i);
+            if (i % 3 == 0) {
+                expected.Erase(expected.begin() + expected.Size() / 2);
+            }
+        }
+        assert(v.Size() == expected.Size() && std::equal(v.begin(), v.end(), expected.begin()));
+    }
+    {
+        // Исключение при вставке оставляет вектор без изменений
+        Obj::ResetCounters();
+        {
+            Devector<Obj> v;
+            for (int i = 0; i < 8; ++i) {
+                v.EmplaceBack(i);
+            }
+            Obj throwing(100);
+            throwing.throw_on_copy = true;
+            for (size_t pos : {size_t{0}, size_t{3}, size_t{8}}) {
+                bool thrown = false;
+                try {
+                    v.Insert(v.begin() + pos, throwing);
+                } catch (const std::runtime_error&) {
+                    thrown = true;
+                }
+                assert(thrown && v.Size() == 8 && v[0].id == 0 && v[7].id == 7);
+            }
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+}
+
+void Test29() {
+    {
+        SharedVector<std::string> table{"a", "b", "c"};
+        assert(table.UseCount() == 1);
+        // Снимок не копирует элементы
+        SharedVector<std::string> snapshot = table;
+        assert(table.UseCount() == 2 && snapshot.cbegin() == table.cbegin());
+        const SharedVector<std::string>& view = snapshot;
+        assert(view[1] == "b" && view.Size() == 3 && snapshot.IsShared());
+
+        // Первое изменение отделяет копию, снимок не меняется
+        table[0] = "changed";
+        assert(!table.IsShared() && snapshot.UseCount() == 1);
+        assert(table.cbegin() != snapshot.cbegin());
+        assert(table.Get()[0] == "changed" && view[0] == "a");
+        table.EmplaceBack("d");
+        table[1] = "x";
+        assert(table.Size() == 4 && table.Get()[1] == "x" && view[1] == "b");
+
+        // Вставка элемента общего вектора в этот же вектор
+        SharedVector<std::string> other = snapshot;
+        other.EmplaceBack(other.Get()[0]);
+        other.Insert(other.cbegin(), view[2]);
+        other.Erase(other.cbegin() + 1);
+        assert(other.Size() == 4 && other.Get()[0] == "c" && other.Get()[1] == "b" && other.Get()[3] == "a");
+        assert(view.Size() == 3 && view[0] == "a");
+
+        SharedVector<std::string> cleared = snapshot;
+        cleared.Clear();
+        assert(cleared.Size() == 0 && cleared.UseCount() == 0 && view.Size() == 3);
+        cleared.PushBack("new");
+        assert(cleared.Size() == 1 && !cleared.IsShared());
+
+        Vector<int> source{1, 2, 3};
+        const int* source_data = source.begin();
+        SharedVector<int> adopted(std::move(source));
+        assert(adopted.cbegin() == source_data && adopted.Size() == 3);
+        adopted.Mutable().Resize(10);
+        assert(adopted.Size() == 10 && adopted.Get()[9] == 0 && adopted.Get()[2] == 3);
+    }
+    {
+        // Читатели берут снимки одновременно, каждый меняет свой
+        SharedVector<int> master(1000);
+        for (int i = 0; i < 1000; ++i) {
+            master[i] = i;
+        }
+        const SharedVector<int>& shared = master;
+        std::atomic<int> failures = 0;
+        Vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t) {
+            readers.EmplaceBack([&shared, &failures, t] {
+                for (int round = 0; round < 100; ++round) {
+                    const SharedVector<int> snapshot = shared;
+                    long long sum = 0;
+                    for (int value : snapshot) {
+                        sum += value;
+                    }
+                    SharedVector<int> own = snapshot;
+                    own[0] = t + 1;
+                    if (sum != 999 * 1000 / 2 || own.Get()[0] != t + 1 || snapshot[0] != 0) {
+                        ++failures;
+                    }
+                }
+            });
+        }
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+        assert(failures == 0 && master.UseCount() == 1 && master.Get()[0] == 0);
+    }
+    {
+        // Исключение при отделении копии оставляет оба вектора прежними
+        Obj::ResetCounters();
+        {
+            Vector<Obj> objs(5);
+            objs[3].throw_on_copy = true;
+            SharedVector<Obj> a(std::move(objs));
+            SharedVector<Obj> b = a;
+            bool thrown = false;
+            try {
+                b.PopBack();
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown && a.UseCount() == 2 && b.Size() == 5);
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+}
+
+void Test30() {
+    using CachedInts = Vector<int, CachingAllocator<int>>;
+    TrimBlockCache();
+    {
+        // Ёмкость округляется до класса размера
+        CachedInts v;
+        v.Reserve(5);
+        assert(v.Capacity() == 8);
+        v.Reserve(1000);
+        assert(v.Capacity() == 1024);
+    }
+    const BlockCacheStats before = GetBlockCacheStats();
+    assert(before.cached_blocks == 2 && before.cached_bytes == 32 + 4096);
+    {
+        // В установившемся режиме буферы берутся из кэша
+        for (int i = 0; i < 1000; ++i) {
+            CachedInts v;
+            for (int j = 0; j < 1000; ++j) {
+                v.PushBack(j);
+            }
+            Vector<std::string, CachingAllocator<std::string>> names{"a", "b", "c"};
+            assert(v[999] == 999 && names[2] == "c");
+        }
+        const BlockCacheStats after = GetBlockCacheStats();
+        assert(after.misses - before.misses <= 10);
+        // 9 блоков на рост вектора чисел и один на строки за итерацию
+        assert(after.hits + after.misses - before.hits - before.misses == 1000 * 10);
+        assert(after.hits - before.hits >= 999 * 10);
+        assert(after.released == before.released);
+
+        // Буфер, освобождённый в другом потоке, попадает в кэш этого потока
+        CachedInts outer;
+        std::thread([&outer] {
+            CachedInts v(100);
+            v[0] = 42;
+            outer = std::move(v);
+        }).join();
+        assert(outer[0] == 42);
+        outer = CachedInts{};
+        assert(GetBlockCacheStats().recycled == after.recycled + 1);
+    }
+    {
+        // Объём кэша ограничен
+        SetBlockCacheLimit(1024);
+        assert(GetBlockCacheStats().cached_bytes <= 1024);
+        const size_t released = GetBlockCacheStats().released;
+        {
+            CachedInts v(1000);
+        }
+        assert(GetBlockCacheStats().released == released + 1);
+        {
+            CachedInts v(10);
+        }
+        const BlockCacheStats stats = GetBlockCacheStats();
+        assert(stats.cached_bytes <= 1024 && stats.cached_blocks > 0);
+        TrimBlockCache();
+        assert(GetBlockCacheStats().cached_bytes == 0 && GetBlockCacheStats().cached_blocks == 0);
+        SetBlockCacheLimit(detail::BlockCache::kDefaultLimitBytes);
+
+        // Слишком большие блоки не кэшируются
+        CachedInts huge(1 << 20);
+        assert(huge.Capacity() == 1 << 20);
+    }
+}
+
+void Test31() {
+    {
+        // Поиск совпадает с std::lower_bound на всех позициях
+        Vector<int> keys;
+        for (int n = 0; n < 40; ++n) {
+            for (int key = -1; key <= 2 * n + 1; ++key) {
+                const size_t expected = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+                assert(detail::FlatLowerBound(keys.begin(), keys.Size(), key, std::less<int>{}) == expected);
+            }
+            keys.PushBack(2 * n);
+        }
+    }
+    {
+        FlatSet<std::string> set{"pear", "apple", "fig", "apple"};
+        assert(set.Size() == 3 && *set.begin() == "apple" && set.Keys()[2] == "pear");
+        assert(set.Contains("fig") && !set.Contains("kiwi") && set.IndexOf("kiwi") == 3);
+        assert(set.Insert("kiwi") == std::make_pair(size_t{2}, true));
+        assert(set.Insert(std::string("fig")) == std::make_pair(size_t{1}, false));
+        // Слияние за один проход, повторы пропускаются
+        const Vector<std::string> sorted{"banana", "fig", "grape", "grape", "zucchini"};
+        set.InsertSorted(sorted.begin(), sorted.end());
+        const Vector<std::string> expected{"apple", "banana", "fig", "grape", "kiwi", "pear", "zucchini"};
+        assert(set.Keys() == expected);
+        // Диапазон целиком после последнего ключа добавляется в конец
+        const Vector<std::string> tail{"zz1", "zz1", "zz2"};
+        set.InsertSorted(tail.begin(), tail.end());
+        assert(set.Size() == 9 && set.Keys()[8] == "zz2");
+        const Vector<std::string> unsorted{"cherry", "apple", "cherry", "date"};
+        set.InsertUnsorted(unsorted.begin(), unsorted.end());
+        assert(set.Size() == 11 && set.Keys()[2] == "cherry" && set.Keys()[3] == "date");
+        assert(set.Erase("cherry") && !set.Erase("cherry") && set.Size() == 10);
+        assert(std::is_sorted(set.begin(), set.end()));
+    }
+    {
+        FlatMap<int, std::string> map{{3, "three"}, {1, "one"}, {2, "two"}, {1, "uno"}};
+        assert(map.Size() == 3 && map.At(1) == "one" && map.Keys()[0] == 1 && map.Values()[2] == "three");
+        assert(map.Find(4) == nullptr && *map.Find(2) == "two");
+        map[4] = "four";
+        map[1] += "!";
+        assert(map.Size() == 4 && map.At(4) == "four" && map.At(1) == "one!");
+        assert(map.Emplace(0, 3, 'z') == std::make_pair(size_t{0}, true) && map.At(0) == "zzz");
+        assert(!map.Emplace(0, "other").second && map.At(0) == "zzz");
+        assert(!map.InsertOrAssign(0, "zero").second && map.At(0) == "zero");
+        bool thrown = false;
+        try {
+            map.At(42);
+        } catch (const std::out_of_range&) {
+            thrown = true;
+        }
+        assert(thrown);
+
+        const Vector<std::pair<int, std::string>> sorted{{-1, "minus"}, {2, "dup"}, {5, "five"}, {5, "again"}};
+        map.InsertSorted(sorted.begin(), sorted.end());
+        assert(map.Size() == 7 && map.Keys()[0] == -1 && map.At(2) == "two" && map.At(5) == "five");
+        const Vector<std::pair<int, std::string>> unsorted{{9, "nine"}, {7, "seven"}, {9, "nueve"}, {3, "dup"}};
+        map.InsertUnsorted(unsorted.begin(), unsorted.end());
+        assert(map.Size() == 9 && map.At(9) == "nine" && map.At(3) == "three" && map.Keys()[8] == 9);
+        assert(map.Erase(4) && !map.Contains(4) && map.Size() == 8);
+        assert(std::is_sorted(map.Keys().begin(), map.Keys().end()));
+
+        // Сначала набрать данные без порядка, затем отсортировать один раз
+        Vector<int> keys;
+        Vector<int> values;
+        for (int i = 0; i < 1000; ++i) {
+            keys.PushBack((i * 7919) % 1000);
+            values.PushBack(i);
+        }
+        keys.PushBack(0);
+        values.PushBack(-1);
+        FlatMap<int, int> bulk(std::move(keys), std::move(values));
+        assert(bulk.Size() == 1000 && bulk.At(0) == 0 && bulk.At(919) == 1);
+        for (int i = 0; i < 1000; ++i) {
+            assert(bulk.Keys()[i] == i);
+        }
+    }
+    {
+        // Исключение при слиянии оставляет контейнер без изменений
+        Obj::ResetCounters();
+        {
+            FlatMap<int, Obj> map;
+            for (int i = 0; i < 10; ++i) {
+                map.Emplace(i * 2, i);
+            }
+            Vector<std::pair<int, Obj>> sorted;
+            for (int i = 0; i < 5; ++i) {
+                sorted.EmplaceBack(i * 2 + 1, Obj(100 + i));
+            }
+            sorted[3].second.throw_on_copy = true;
+            bool thrown = false;
+            try {
+                map.InsertSorted(sorted.begin(), sorted.end());
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown && map.Size() == 10);
+            for (int i = 0; i < 10; ++i) {
+                assert(map.At(i * 2).id == i);
+            }
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+    {
+        // Ключи перемещаются без исключений, а значения копируются: сбой
+        // копирования старого значения не должен оставить пустые ключи
+        FlatMap<std::string, ThrowingMoveObj> map;
+        for (int i = 0; i < 10; ++i) {
+            map.Emplace(std::to_string(i * 2 + 10), i);
+        }
+        map.Values()[5].throw_on_copy = true;
+        const Vector<std::pair<std::string, ThrowingMoveObj>> sorted{
+            {"11", ThrowingMoveObj(100)}, {"15", ThrowingMoveObj(101)}, {"27", ThrowingMoveObj(102)}};
+        bool thrown = false;
+        try {
+            map.InsertSorted(sorted.begin(), sorted.end());
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && map.Size() == 10);
+        for (int i = 0; i < 10; ++i) {
+            assert(map.At(std::to_string(i * 2 + 10)).id == i);
+        }
+    }
+    {
+        // И наоборот: ключи копируются, значения перемещаются
+        FlatMap<ThrowingMoveObj, std::string> map;
+        for (int i = 0; i < 10; ++i) {
+            map.Emplace(ThrowingMoveObj(i * 2), std::to_string(i));
+        }
+        const_cast<ThrowingMoveObj&>(map.Keys()[5]).throw_on_copy = true;
+        const Vector<std::pair<ThrowingMoveObj, std::string>> sorted{
+            {ThrowingMoveObj(1), "a"}, {ThrowingMoveObj(7), "b"}, {ThrowingMoveObj(15), "c"}};
+        bool thrown = false;
+        try {
+            map.InsertSorted(sorted.begin(), sorted.end());
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && map.Size() == 10);
+        for (int i = 0; i < 10; ++i) {
+            assert(map.At(ThrowingMoveObj(i * 2)) == std::to_string(i));
+        }
+    }
+}
+
+// Таблица квадратов, построенная во время компиляции
+constexpr StaticVector<int, 16> MakeSquares() {
+    StaticVector<int, 16> squares;
+    for (int i = 0; i < 10; ++i) {
+        squares.EmplaceBack(i * i);
+    }
+    squares.Emplace(squares.begin(), -1);
+    squares.Erase(squares.begin() + 1);
+    squares.Resize(12);
+    return squares;
+}
+
+void Test32() {
+    {
+        constexpr StaticVector<int, 16> squares = MakeSquares();
+        static_assert(squares.Size() == 12 && squares.Capacity() == 16);
+        static_assert(squares[0] == -1 && squares[1] == 1 && squares[9] == 81 && squares[11] == 0);
+        constexpr StaticVector<int, 4> small{1, 2, 3};
+        static_assert(small.Size() == 3 && small[2] == 3 && small != StaticVector<int, 4>{1, 2});
+    }
+    {
+        StaticVector<std::string, 4> v{"b", "d"};
+        v.Insert(v.begin(), "a");
+        v.Emplace(v.begin() + 2, 1, 'c');
+        assert(v.Size() == 4 && v[0] == "a" && v[1] == "b" && v[2] == "c" && v[3] == "d");
+        v.Erase(v.begin() + 1, v.begin() + 3);
+        assert(v.Size() == 2 && v[0] == "a" && v[1] == "d");
+        // Аргумент ссылается на элемент, который сдвигается вставкой
+        v.Emplace(v.begin(), v[1]);
+        assert(v.Size() == 3 && v[0] == "d" && v[1] == "a" && v[2] == "d");
+        StaticVector<std::string, 4> copy = v;
+        v.PopBack();
+        copy = v;
+        assert(copy == v && copy.Size() == 2);
+        StaticVector<std::string, 4> moved = std::move(copy);
+        assert(moved == v);
+    }
+    {
+        StaticVector<int, 2, ThrowOnOverflow> v;
+        v.PushBack(1);
+        v.PushBack(2);
+        bool thrown = false;
+        try {
+            v.PushBack(3);
+        } catch (const std::length_error&) {
+            thrown = true;
+        }
+        assert(thrown && v.Size() == 2);
+        thrown = false;
+        try {
+            v.Resize(3);
+        } catch (const std::length_error&) {
+            thrown = true;
+        }
+        assert(thrown && v.Size() == 2);
+    }
+    {
+        StaticVector<std::string, 2, ReturnFalseOnOverflow> v;
+        assert(v.EmplaceBack("x") && v.Insert(v.begin(), std::string("w")));
+        assert(!v.EmplaceBack("y") && !v.Emplace(v.begin(), "v") && !v.Resize(3));
+        assert(v.Size() == 2 && v[0] == "w" && v[1] == "x");
+        assert(v.Resize(1) && v.Size() == 1 && v.PushBack("z") && v[1] == "z");
+    }
+    {
+        {
+            StaticVector<Obj, 8> v(3);
+            v.EmplaceBack(5);
+            v.Emplace(v.begin() + 1, 7);
+            assert(v.Size() == 5 && v[1].id == 7 && v[4].id == 5);
+            v.Erase(v.begin());
+            v.Resize(2);
+            assert(Obj::GetAliveObjectCount() == 2);
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+}
+
+void Test33() {
+    {
+        Vector<std::string> strings(100'000);
+        for (size_t i = 0; i < strings.Size(); ++i) {
+            strings[i] = std::string(32, 'a' + i % 26);
+        }
+        DeferDestroy(std::move(strings));
+        assert(strings.Size() == 0 && strings.Capacity() == 0);
+        // Перемещённый вектор можно использовать дальше
+        strings.PushBack("alive");
+        Reclaimer::Default().Drain();
+        assert(Reclaimer::Default().Pending() == 0 && strings[0] == "alive");
+    }
+    {
+        {
+            // Счётчики Obj не атомарные, поэтому объекты создаются заранее,
+            // а поток освобождения получает их только перемещением векторов
+            Vector<Vector<Obj>> batches(50);
+            Vector<ChunkedVector<Obj, 16>> chunked(50);
+            for (size_t batch = 0; batch < batches.Size(); ++batch) {
+                for (int i = 0; i < 100; ++i) {
+                    batches[batch].EmplaceBack(i);
+                }
+                chunked[batch].EmplaceBack(static_cast<int>(batch));
+            }
+            Reclaimer reclaimer;
+            for (size_t batch = 0; batch < batches.Size(); ++batch) {
+                reclaimer.Defer(std::move(batches[batch]));
+                reclaimer.Defer(std::move(chunked[batch]));
+            }
+            reclaimer.Drain();
+            assert(reclaimer.Pending() == 0 && Obj::GetAliveObjectCount() == 0);
+            // Деструктор дожидается всего, что ещё стоит в очереди
+            Vector<Obj> last(10);
+            reclaimer.Defer(std::move(last));
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+    {
+        // Несколько потоков отдают векторы одному потоку освобождения
+        Reclaimer reclaimer;
+        Vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.EmplaceBack([&reclaimer] {
+                for (int i = 0; i < 200; ++i) {
+                    Vector<std::string> strings(10);
+                    strings[i % 10] = "x";
+                    reclaimer.Defer(std::move(strings));
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        reclaimer.Drain();
+        assert(reclaimer.Pending() == 0);
+    }
+}
+
+void Test34() {
+    // Вставка в середину без реаллокации: значение строится до сдвига
+    Obj::ResetCounters();
+    {
+        Vector<Obj> v;
+        v.Reserve(8);
+        for (int i = 0; i < 4; ++i) {
+            v.EmplaceBack(i + 1);
+        }
+        Obj failing(10);
+        failing.throw_on_copy = true;
+        bool thrown = false;
+        try {
+            v.Insert(v.begin() + 1, failing);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && v.Size() == 4 && v[3].id == 4);
+        assert(Obj::GetAliveObjectCount() == 5);
+        // Аргумент ссылается на последний элемент, который сдвигается первым
+        v.Insert(v.begin(), v[3]);
+        assert(v.Size() == 5 && v[0].id == 4 && v[4].id == 4);
+
+        SmallVector<Obj, 8> small;
+        for (int i = 0; i < 4; ++i) {
+            small.EmplaceBack(i + 1);
+        }
+        thrown = false;
+        try {
+            small.Insert(small.begin() + 1, failing);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown && small.Size() == 4 && small[3].id == 4);
+        small.Insert(small.begin(), small[3]);
+        assert(small.Size() == 5 && small[0].id == 4 && small[4].id == 4);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+void Test35() {
+    // Перемещение, выбрасывающее исключение, доходит до вызывающего кода,
+    // и все элементы остаются живыми
+    const int SIZE = 8;
+    const auto check = [](const auto& v) {
+        assert(v.Size() == SIZE);
+        for (int i = 0; i < SIZE; ++i) {
+            assert(v[i].id == i);
+        }
+    };
+    const auto expect_throw = [](auto&& f) {
+        // Третье перемещение выбрасывает: первая часть уже перенесена
+        ThrowingMoveOnly::move_throw_countdown = 3;
+        bool thrown = false;
+        try {
+            f();
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        ThrowingMoveOnly::move_throw_countdown = 0;
+        assert(thrown);
+    };
+    {
+        Vector<ThrowingMoveOnly> v;
+        v.Reserve(SIZE);
+        for (int i = 0; i < SIZE; ++i) {
+            v.EmplaceBack(i);
+        }
+        expect_throw([&] { v.Emplace(v.begin() + 1, 100); });
+        check(v);
+        expect_throw([&] { v.EmplaceBack(100); });
+        check(v);
+        expect_throw([&] { v.Reserve(SIZE * 2); });
+        check(v);
+    }
+    {
+        SmallVector<ThrowingMoveOnly, 4> v;
+        for (int i = 0; i < SIZE; ++i) {
+            v.EmplaceBack(i);
+        }
+        v.Reserve(SIZE);
+        expect_throw([&] { v.Emplace(v.begin() + 1, 100); });
+        check(v);
+    }
+    {
+        Devector<ThrowingMoveOnly> v;
+        for (int i = 0; i < SIZE; ++i) {
+            v.EmplaceBack(i);
+        }
+        expect_throw([&] { v.Emplace(v.begin() + 1, 100); });
+        check(v);
+    }
+    {
+        SoAVector<int, ThrowingMoveOnly> v;
+        v.Reserve(SIZE);
+        for (int i = 0; i < SIZE; ++i) {
+            v.EmplaceBack(i, ThrowingMoveOnly(i));
+        }
+        expect_throw([&] { v.EmplaceBack(100, ThrowingMoveOnly(100)); });
+        assert(v.Size() == SIZE);
+        for (int i = 0; i < SIZE; ++i) {
+            assert(v.Column<0>()[i] == i && v.Column<1>()[i].id == i);
+        }
+    }
+    assert(ThrowingMoveOnly::alive == 0);
+}
+
 int main() {
     try {
         Test1();
@@ -387,6 +2473,36 @@ int main() {
         Test3();
         Test4();
         Test5();
+        Test6();
+        Test7();
+        Test8();
+        Test9();
+        Test10();
+        Test11();
+        Test12();
+        Test13();
+        Test14();
+        Test15();
+        Test16();
+        Test17();
+        Test18();
+        Test19();
+        Test20();
+        Test21();
+        Test22();
+        Test23();
+        Test24();
+        Test25();
+        Test26();
+        Test27();
+        Test28();
+        Test29();
+        Test30();
+        Test31();
+        Test32();
+        Test33();
+        Test34();
+        Test35();
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
@@ -0,0 +1,459 @@
+#pragma once
+
+#include "vector.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Vector of trivially copyable elements whose buffer is a memory-mapped
+// file. Opening an existing file costs page faults instead of parsing:
+// the elements are used in place. The file starts with a small header
+// (format version, size, capacity and a hash of T) checked on open.
+// A read-write vector grows the file with ftruncate and remaps it
+template <typename T>
+class MappedVector
+{
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using growth_policy = DoublingGrowth;
+
+    static_assert(std::is_trivially_copyable_v<T>, "elements are stored as raw bytes");
+
+    static constexpr uint32_t kFormatVersion = 1;
+
+    // Maps an existing file for reading. Mutating calls are not allowed
+    static MappedVector OpenReadOnly(const std::string& path);
+    // Maps a file for reading and writing, creating an empty vector if the file does not exist
+    static MappedVector OpenReadWrite(const std::string& path);
+
+    MappedVector(const MappedVector&) = delete;
+    MappedVector& operator=(const MappedVector&) = delete;
+    MappedVector(MappedVector&& other) noexcept;
+    MappedVector& operator=(MappedVector&& rhs) noexcept;
+    ~MappedVector();
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+    const_iterator cbegin() const noexcept;
+    const_iterator cend() const noexcept;
+
+    size_t Size() const noexcept;
+    size_t Capacity() const noexcept;
+    bool IsReadOnly() const noexcept;
+    void Reserve(size_t new_capacity);
+    const T& operator[](size_t index) const noexcept;
+    T& operator[](size_t index) noexcept;
+    void Swap(MappedVector& other) noexcept;
+    void Resize(size_t new_size);
+    template<typename F>
+    void PushBack(F&& value);
+    void PopBack() noexcept;
+    template<typename... Ts>
+    T& EmplaceBack(Ts&&... vs);
+    // Writes dirty pages back to the file
+    void Flush();
+
+    static uint64_t TypeHash() noexcept;
+
+private:
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t element_size;
+        uint64_t type_hash;
+        uint64_t size;
+        uint64_t capacity;
+    };
+
+    static constexpr uint64_t kMagic = 0x5243455650414d;  // "MAPVECR"
+    // Elements start at a cache line boundary after the header
+    static constexpr size_t kDataOffset = (sizeof(Header) + 63) / 64 * 64;
+
+    static_assert(alignof(T) <= 64, "elements would be misaligned in the file");
+
+    MappedVector(int fd, bool read_only);
+    static size_t FileBytes(size_t capacity) noexcept;
+    void Map(size_t bytes);
+    void Remap(size_t bytes);
+    void Validate() const;
+    Header* GetHeader() noexcept;
+    const Header* GetHeader() const noexcept;
+    T* Data() noexcept;
+    const T* Data() const noexcept;
+    [[noreturn]] static void ThrowSystemError(const char* what);
+
+    int fd_ = -1;
+    void* map_ = nullptr;
+    size_t map_bytes_ = 0;
+    bool read_only_ = true;
+};
+
+template<typename T>
+MappedVector<T> MappedVector<T>::OpenReadOnly(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        ThrowSystemError("open");
+    }
+    MappedVector result(fd, true);
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ThrowSystemError("fstat");
+    }
+    if (static_cast<size_t>(st.st_size) < kDataOffset)
+    {
+        throw std::runtime_error("MappedVector: " + path + " is too small to be a vector file");
+    }
+    result.Map(st.st_size);
+    result.Validate();
+    return result;
+}
+
+template<typename T>
+MappedVector<T> MappedVector<T>::OpenReadWrite(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        ThrowSystemError("open");
+    }
+    MappedVector result(fd, false);
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ThrowSystemError("fstat");
+    }
+    if (st.st_size == 0)
+    {
+        if (ftruncate(fd, FileBytes(0)) != 0)
+        {
+            ThrowSystemError("ftruncate");
+        }
+        result.Map(FileBytes(0));
+        *result.GetHeader() = Header{kMagic, kFormatVersion, sizeof(T), TypeHash(), 0, 0};
+    }
+    else
+    {
+        if (static_cast<size_t>(st.st_size) < kDataOffset)
+        {
+            throw std::runtime_error("MappedVector: " + path + " is too small to be a vector file");
+        }
+        result.Map(st.st_size);
+        result.Validate();
+    }
+    return result;
+}
+
+template<typename T>
+MappedVector<T>::MappedVector(int fd, bool read_only)
+    : fd_(fd)
+    , read_only_(read_only)
+{
+}
+
+template<typename T>
+MappedVector<T>::MappedVector(MappedVector&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1))
+    , map_(std::exchange(other.map_, nullptr))
+    , map_bytes_(std::exchange(other.map_bytes_, 0))
+    , read_only_(other.read_only_)
+{
+}
+
+template<typename T>
+MappedVector<T>& MappedVector<T>::operator=(MappedVector&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        MappedVector rhs_move(std::move(rhs));
+        Swap(rhs_move);
+    }
+    return *this;
+}
+
+template<typename T>
+MappedVector<T>::~MappedVector()
+{
+    if (map_ != nullptr)
+    {
+        munmap(map_, map_bytes_);
+    }
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+}
+
+template<typename T>
+typename MappedVector<T>::iterator MappedVector<T>::begin() noexcept
+{
+    return Data();
+}
+
+template<typename T>
+typename MappedVector<T>::iterator MappedVector<T>::end() noexcept
+{
+    return Data() + Size();
+}
+
+template<typename T>
+typename MappedVector<T>::const_iterator MappedVector<T>::begin() const noexcept
+{
+    return Data();
+}
+
+template<typename T>
+typename MappedVector<T>::const_iterator MappedVector<T>::end() const noexcept
+{
+    return Data() + Size();
+}
+
+template<typename T>
+typename MappedVector<T>::const_iterator MappedVector<T>::cbegin() const noexcept
+{
+    return begin();
+}
+
+template<typename T>
+typename MappedVector<T>::const_iterator MappedVector<T>::cend() const noexcept
+{
+    return end();
+}
+
+template<typename T>
+size_t MappedVector<T>::Size() const noexcept
+{
+    return map_ != nullptr ? GetHeader()->size : 0;
+}
+
+template<typename T>
+size_t MappedVector<T>::Capacity() const noexcept
+{
+    return map_ != nullptr ? GetHeader()->capacity : 0;
+}
+
+template<typename T>
+bool MappedVector<T>::IsReadOnly() const noexcept
+{
+    return read_only_;
+}
+
+template<typename T>
+void MappedVector<T>::Reserve(size_t new_capacity)
+{
+    assert(!read_only_);
+    if (new_capacity <= Capacity())
+    {
+        return;
+    }
+    const size_t new_bytes = FileBytes(new_capacity);
+    if (ftruncate(fd_, new_bytes) != 0)
+    {
+        ThrowSystemError("ftruncate");
+    }
+    Remap(new_bytes);
+    GetHeader()->capacity = new_capacity;
+}
+
+template<typename T>
+const T& MappedVector<T>::operator[](size_t index) const noexcept
+{
+    return const_cast<MappedVector&>(*this)[index];
+}
+
+template<typename T>
+T& MappedVector<T>::operator[](size_t index) noexcept
+{
+    assert(index < Size());
+    return Data()[index];
+}
+
+template<typename T>
+void MappedVector<T>::Swap(MappedVector& other) noexcept
+{
+    std::swap(fd_, other.fd_);
+    std::swap(map_, other.map_);
+    std::swap(map_bytes_, other.map_bytes_);
+    std::swap(read_only_, other.read_only_);
+}
+
+template<typename T>
+void MappedVector<T>::Resize(size_t new_size)
+{
+    assert(!read_only_);
+    const size_t size = Size();
+    if (new_size > size)
+    {
+        Reserve(new_size);
+        std::uninitialized_value_construct_n(Data() + size, new_size - size);
+    }
+    GetHeader()->size = new_size;
+}
+
+template<typename T>
+template<typename F>
+void MappedVector<T>::PushBack(F&& value)
+{
+    EmplaceBack(std::forward<F>(value));
+}
+
+template<typename T>
+void MappedVector<T>::PopBack() noexcept
+{
+    assert(!read_only_ && Size() > 0);
+    --GetHeader()->size;
+}
+
+template<typename T>
+template<typename... Ts>
+T& MappedVector<T>::EmplaceBack(Ts&&... vs)
+{
+    assert(!read_only_);
+    const size_t size = Size();
+    if (size == Capacity())
+    {
+        // vs may refer to an element that moves with the remap
+        T value(std::forward<Ts>(vs)...);
+        Reserve(growth_policy::NextCapacity(size, sizeof(T)));
+        T* result = new (Data() + size) T(value);
+        ++GetHeader()->size;
+        return *result;
+    }
+    T* result = new (Data() + size) T(std::forward<Ts>(vs)...);
+    ++GetHeader()->size;
+    return *result;
+}
+
+template<typename T>
+void MappedVector<T>::Flush()
+{
+    if (!read_only_ && msync(map_, map_bytes_, MS_SYNC) != 0)
+    {
+        ThrowSystemError("msync");
+    }
+}
+
+template<typename T>
+uint64_t MappedVector<T>::TypeHash() noexcept
+{
+    // FNV-1a of the type name mixed with its layout. The name comes from
+    // typeid, so files are portable between builds of the same compiler
+    uint64_t hash = 0xcbf29ce484222325;
+    const auto mix = [&hash](uint64_t byte) {
+        hash ^= byte;
+        hash *= 0x100000001b3;
+    };
+    for (const char* c = typeid(T).name(); *c != '\0'; ++c)
+    {
+        mix(static_cast<unsigned char>(*c));
+    }
+    mix(sizeof(T));
+    mix(alignof(T));
+    return hash;
+}
+
+template<typename T>
+size_t MappedVector<T>::FileBytes(size_t capacity) noexcept
+{
+    return kDataOffset + capacity * sizeof(T);
+}
+
+template<typename T>
+void MappedVector<T>::Map(size_t bytes)
+{
+    const int protection = read_only_ ? PROT_READ : PROT_READ | PROT_WRITE;
+    void* p = mmap(nullptr, bytes, protection, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED)
+    {
+        ThrowSystemError("mmap");
+    }
+    map_ = p;
+    map_bytes_ = bytes;
+}
+
+template<typename T>
+void MappedVector<T>::Remap(size_t bytes)
+{
+    void* p = mremap(map_, map_bytes_, bytes, MREMAP_MAYMOVE);
+    if (p == MAP_FAILED)
+    {
+        ThrowSystemError("mremap");
+    }
+    map_ = p;
+    map_bytes_ = bytes;
+}
+
+template<typename T>
+void MappedVector<T>::Validate() const
+{
+    const Header& header = *GetHeader();
+    if (header.magic != kMagic)
+    {
+        throw std::runtime_error("MappedVector: not a vector file");
+    }
+    if (header.version != kFormatVersion)
+    {
+        throw std::runtime_error("MappedVector: unsupported format version " + std::to_string(header.version));
+    }
+    if (header.element_size != sizeof(T) || header.type_hash != TypeHash())
+    {
+        throw std::runtime_error("MappedVector: file holds elements of another type");
+    }
+    // Compared by division: a corrupt capacity must not overflow FileBytes
+    if (map_bytes_ < kDataOffset || header.size > header.capacity ||
+        header.capacity > (map_bytes_ - kDataOffset) / sizeof(T))
+    {
+        throw std::runtime_error("MappedVector: file is truncated");
+    }
+}
+
+template<typename T>
+typename MappedVector<T>::Header* MappedVector<T>::GetHeader() noexcept
+{
+    return static_cast<Header*>(map_);
+}
+
+template<typename T>
+const typename MappedVector<T>::Header* MappedVector<T>::GetHeader() const noexcept
+{
+    return static_cast<const Header*>(map_);
+}
+
+template<typename T>
+T* MappedVector<T>::Data() noexcept
+{
+    return reinterpret_cast<T*>(static_cast<char*>(map_) + kDataOffset);
+}
+
+template<typename T>
+const T* MappedVector<T>::Data() const noexcept
+{
+    return const_cast<MappedVector&>(*this).Data();
+}
+
+template<typename T>
+void MappedVector<T>::ThrowSystemError(const char* what)
+{
+    throw std::system_error(errno, std::generic_category(), std::string("MappedVector: ") + what);
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "vector.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Allocator for very large vectors. Every block reserves an address range
+// of at least reserve_bytes up front and commits pages only as the vector
+// grows into it, so growth inside the reservation is an mprotect call
+// without any relocation and element addresses stay stable.
+// With huge_pages the range is marked MADV_HUGEPAGE for transparent huge pages
+template <typename T>
+class MmapAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    static constexpr size_t kDefaultReserveBytes = size_t{1} << 32;
+
+    static_assert(alignof(T) <= 4096, "page alignment is not enough for T");
+
+    explicit MmapAllocator(size_t reserve_bytes = kDefaultReserveBytes, bool huge_pages = true) noexcept;
+    template <typename U>
+    MmapAllocator(const MmapAllocator<U>& other) noexcept;
+
+    T* allocate(size_t n);
+    AllocationResult<T*> allocate_at_least(size_t n);
+    void deallocate(T* p, size_t n) noexcept;
+    // Commits more pages of the reservation of p. Called by RawMemory::TryExpand
+    bool expand(T* p, size_t old_n, size_t new_n) noexcept;
+
+    size_t GetReserveBytes() const noexcept;
+    bool UsesHugePages() const noexcept;
+
+    template <typename U>
+    friend bool operator==(const MmapAllocator& lhs, const MmapAllocator<U>& rhs) noexcept
+    {
+        return lhs.GetReserveBytes() == rhs.GetReserveBytes() && lhs.UsesHugePages() == rhs.UsesHugePages();
+    }
+
+    template <typename U>
+    friend bool operator!=(const MmapAllocator& lhs, const MmapAllocator<U>& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    static size_t PageSize() noexcept;
+    static size_t RoundToPages(size_t bytes) noexcept;
+    // Size of the address range reserved for a block of n elements
+    size_t ReservedBytes(size_t n) const noexcept;
+
+    size_t reserve_bytes_;
+    bool huge_pages_;
+};
+
+template<typename T>
+MmapAllocator<T>::MmapAllocator(size_t reserve_bytes, bool huge_pages) noexcept
+    : reserve_bytes_(RoundToPages(reserve_bytes))
+    , huge_pages_(huge_pages)
+{
+}
+
+template<typename T>
+template<typename U>
+MmapAllocator<T>::MmapAllocator(const MmapAllocator<U>& other) noexcept
+    : reserve_bytes_(other.GetReserveBytes())
+    , huge_pages_(other.UsesHugePages())
+{
+}
+
+template<typename T>
+T* MmapAllocator<T>::allocate(size_t n)
+{
+    const size_t reserved = ReservedBytes(n);
+    void* p = mmap(nullptr, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED)
+    {
+        throw std::bad_alloc();
+    }
+    if (mprotect(p, RoundToPages(n * sizeof(T)), PROT_READ | PROT_WRITE) != 0)
+    {
+        munmap(p, reserved);
+        throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge_pages_)
+    {
+        // Only a hint, the block works with regular pages as well
+        madvise(p, reserved, MADV_HUGEPAGE);
+    }
+#endif
+    return static_cast<T*>(p);
+}
+
+template<typename T>
+AllocationResult<T*> MmapAllocator<T>::allocate_at_least(size_t n)
+{
+    return {allocate(n), RoundToPages(n * sizeof(T)) / sizeof(T)};
+}
+
+template<typename T>
+void MmapAllocator<T>::deallocate(T* p, size_t n) noexcept
+{
+    munmap(static_cast<void*>(p), ReservedBytes(n));
+}
+
+template<typename T>
+bool MmapAllocator<T>::expand(T* p, size_t old_n, size_t new_n) noexcept
+{
+    const size_t new_bytes = RoundToPages(new_n * sizeof(T));
+    if (new_bytes > ReservedBytes(old_n))
+    {
+        return false;
+    }
+    return mprotect(static_cast<void*>(p), new_bytes, PROT_READ | PROT_WRITE) == 0;
+}
+
+template<typename T>
+size_t MmapAllocator<T>::GetReserveBytes() const noexcept
+{
+    return reserve_bytes_;
+}
+
+template<typename T>
+bool MmapAllocator<T>::UsesHugePages() const noexcept
+{
+    return huge_pages_;
+}
+
+template<typename T>
+size_t MmapAllocator<T>::PageSize() noexcept
+{
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return page_size;
+}
+
+template<typename T>
+size_t MmapAllocator<T>::RoundToPages(size_t bytes) noexcept
+{
+    const size_t page_size = PageSize();
+    return (bytes + page_size - 1) / page_size * page_size;
+}
+
+template<typename T>
+size_t MmapAllocator<T>::ReservedBytes(size_t n) const noexcept
+{
+    const size_t bytes = RoundToPages(n * sizeof(T));
+    return bytes > reserve_bytes_ ? bytes : reserve_bytes_;
+}
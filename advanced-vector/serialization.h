@@ -0,0 +1,451 @@
+#pragma once
+
+#include "vector.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Binary format of a serialized Vector: a SerializedHeader followed by the
+// elements. Trivially copyable elements are stored as their raw bytes in
+// native byte order, other types are written by Serializer<T>.
+//
+// A writer provides Write(const void* data, size_t bytes) and optionally
+// WriteV(const iovec* iov, int count) for gather writes.
+// A reader provides Read(void* data, size_t bytes) and throws if fewer
+// bytes are available. A reader that also knows Remaining() bytes lets
+// Deserialize reject an impossible count before allocating anything
+
+struct SerializedHeader {
+    static constexpr uint32_t kMagic = 0x31434556;  // "VEC1"
+
+    uint32_t magic;
+    // sizeof(T) for the raw encoding, 0 for elements written by Serializer<T>
+    uint32_t element_size;
+    uint64_t count;
+};
+
+// Customization point for element types that are not trivially copyable:
+//     static void Write(Writer& writer, const T& value);
+//     static T Read(Reader& reader);
+//     static constexpr size_t kMinBytes;  // optional, fewest bytes Write emits
+// The primary template covers trivially copyable types
+template <typename T, typename = void>
+struct Serializer {
+    static_assert(std::is_trivially_copyable_v<T>, "specialize Serializer<T> for this type");
+
+    template <typename Writer>
+    static void Write(Writer& writer, const T& value)
+    {
+        writer.Write(&value, sizeof(T));
+    }
+
+    template <typename Reader>
+    static T Read(Reader& reader)
+    {
+        T value;
+        reader.Read(&value, sizeof(T));
+        return value;
+    }
+};
+
+template <typename Writer, typename T, typename Alloc, typename Growth>
+void Serialize(Writer& writer, const Vector<T, Alloc, Growth>& v);
+
+template <typename Reader, typename T, typename Alloc, typename Growth>
+void Deserialize(Reader& reader, Vector<T, Alloc, Growth>& v);
+
+template <>
+struct Serializer<std::string> {
+    static constexpr size_t kMinBytes = sizeof(uint64_t);
+
+    template <typename Writer>
+    static void Write(Writer& writer, const std::string& value)
+    {
+        const uint64_t size = value.size();
+        writer.Write(&size, sizeof(size));
+        writer.Write(value.data(), value.size());
+    }
+
+    // Checks the length the same way Deserialize checks the count
+    template <typename Reader>
+    static std::string Read(Reader& reader);
+};
+
+template <typename T, typename Alloc, typename Growth>
+struct Serializer<Vector<T, Alloc, Growth>> {
+    static constexpr size_t kMinBytes = sizeof(SerializedHeader);
+
+    template <typename Writer>
+    static void Write(Writer& writer, const Vector<T, Alloc, Growth>& value)
+    {
+        Serialize(writer, value);
+    }
+
+    template <typename Reader>
+    static Vector<T, Alloc, Growth> Read(Reader& reader)
+    {
+        Vector<T, Alloc, Growth> value;
+        Deserialize(reader, value);
+        return value;
+    }
+};
+
+// Unbuffered writer to a file descriptor. Every Write is a system call,
+// so elements with a Serializer are better written to a VectorWriter first
+class FdWriter
+{
+public:
+    explicit FdWriter(int fd) noexcept;
+
+    void Write(const void* data, size_t bytes);
+    void WriteV(const iovec* iov, int count);
+
+private:
+    int fd_;
+};
+
+class FdReader
+{
+public:
+    explicit FdReader(int fd) noexcept;
+
+    void Read(void* data, size_t bytes);
+
+private:
+    int fd_;
+};
+
+// Appends to a byte Vector, e.g. to build a send buffer
+class VectorWriter
+{
+public:
+    explicit VectorWriter(Vector<unsigned char>& buffer) noexcept;
+
+    void Write(const void* data, size_t bytes);
+
+private:
+    Vector<unsigned char>* buffer_;
+};
+
+// Reads from a contiguous block of bytes that outlives the reader
+class BufferReader
+{
+public:
+    BufferReader(const void* data, size_t bytes) noexcept;
+
+    void Read(void* data, size_t bytes);
+    size_t Remaining() const noexcept;
+
+private:
+    const unsigned char* data_;
+    size_t remaining_;
+};
+
+namespace detail {
+
+template <typename Writer, typename = void>
+struct HasWriteV : std::false_type {};
+
+template <typename Writer>
+struct HasWriteV<Writer, std::void_t<decltype(std::declval<Writer&>().WriteV(
+    std::declval<const iovec*>(), int{}))>> : std::true_type {};
+
+template <typename T>
+constexpr uint32_t SerializedElementSize() noexcept
+{
+    return std::is_trivially_copyable_v<T> ? static_cast<uint32_t>(sizeof(T)) : 0;
+}
+
+template <typename Reader, typename = void>
+struct HasRemaining : std::false_type {};
+
+template <typename Reader>
+struct HasRemaining<Reader, std::void_t<decltype(std::declval<const Reader&>().Remaining())>> : std::true_type {};
+
+template <typename S, typename = void>
+struct SerializerMinBytes : std::integral_constant<size_t, 0> {};
+
+template <typename S>
+struct SerializerMinBytes<S, std::void_t<decltype(S::kMinBytes)>> : std::integral_constant<size_t, S::kMinBytes> {};
+
+// Fewest bytes one serialized element takes, 0 if unknown
+template <typename T>
+constexpr size_t MinSerializedBytes() noexcept
+{
+    if constexpr (std::is_trivially_copyable_v<T>)
+    {
+        return sizeof(T);
+    }
+    else
+    {
+        return SerializerMinBytes<Serializer<T>>::value;
+    }
+}
+
+// Without a bound from the reader, memory is committed in steps of at
+// most this many bytes ahead of the data actually read
+inline constexpr size_t kDeserializeStepBytes = size_t{1} << 16;
+
+[[noreturn]] inline void ThrowSerializationError(const char* what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+}  // namespace detail
+
+template <typename Reader>
+std::string Serializer<std::string>::Read(Reader& reader)
+{
+    uint64_t size;
+    reader.Read(&size, sizeof(size));
+    if (size > std::string().max_size())
+    {
+        throw std::runtime_error("Deserialize: string length is too large");
+    }
+    std::string value;
+    if constexpr (detail::HasRemaining<Reader>::value)
+    {
+        if (size > reader.Remaining())
+        {
+            throw std::runtime_error("Deserialize: string length exceeds the input");
+        }
+        value.resize(size);
+        reader.Read(value.data(), size);
+    }
+    else
+    {
+        size_t done = 0;
+        while (done < size)
+        {
+            const size_t next = std::min<size_t>(size, std::max(2 * done, detail::kDeserializeStepBytes));
+            value.resize(next);
+            reader.Read(value.data() + done, next - done);
+            done = next;
+        }
+    }
+    return value;
+}
+
+template <typename Writer, typename T, typename Alloc, typename Growth>
+void Serialize(Writer& writer, const Vector<T, Alloc, Growth>& v)
+{
+    const SerializedHeader header{SerializedHeader::kMagic, detail::SerializedElementSize<T>(), v.Size()};
+    if constexpr (std::is_trivially_copyable_v<T>)
+    {
+        const size_t bytes = v.Size() * sizeof(T);
+        if constexpr (detail::HasWriteV<Writer>::value)
+        {
+            const iovec iov[2] = {
+                {const_cast<SerializedHeader*>(&header), sizeof(header)},
+                {const_cast<T*>(v.begin()), bytes},
+            };
+            writer.WriteV(iov, 2);
+        }
+        else
+        {
+            writer.Write(&header, sizeof(header));
+            writer.Write(v.begin(), bytes);
+        }
+    }
+    else
+    {
+        writer.Write(&header, sizeof(header));
+        for (const T& value : v)
+        {
+            Serializer<T>::Write(writer, value);
+        }
+    }
+}
+
+// Replaces the contents of v. On failure v is left empty
+template <typename Reader, typename T, typename Alloc, typename Growth>
+void Deserialize(Reader& reader, Vector<T, Alloc, Growth>& v)
+{
+    v.Clear();
+    SerializedHeader header;
+    reader.Read(&header, sizeof(header));
+    if (header.magic != SerializedHeader::kMagic)
+    {
+        throw std::runtime_error("Deserialize: not a serialized vector");
+    }
+    if (header.element_size != detail::SerializedElementSize<T>())
+    {
+        throw std::runtime_error("Deserialize: element type does not match");
+    }
+    // The count comes from the input, so it is checked before it sizes
+    // an allocation or a read
+    if (header.count > SIZE_MAX / sizeof(T))
+    {
+        throw std::runtime_error("Deserialize: element count is too large");
+    }
+    const size_t count = static_cast<size_t>(header.count);
+    constexpr size_t kMinBytes = detail::MinSerializedBytes<T>();
+    bool bounded = false;
+    if constexpr (detail::HasRemaining<Reader>::value && kMinBytes != 0)
+    {
+        if (count > reader.Remaining() / kMinBytes)
+        {
+            throw std::runtime_error("Deserialize: element count exceeds the input");
+        }
+        bounded = true;
+    }
+    constexpr size_t kStep = std::max<size_t>(1, detail::kDeserializeStepBytes / sizeof(T));
+    try
+    {
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            // One allocation and one read straight into the buffer when the
+            // count is known to fit the input, otherwise geometric steps
+            size_t done = 0;
+            while (done < count)
+            {
+                const size_t next = bounded ? count : std::min(count, std::max(2 * done, kStep));
+                v.ResizeDefaultInit(next);
+                reader.Read(v.begin() + done, (next - done) * sizeof(T));
+                done = next;
+            }
+        }
+        else
+        {
+            // EmplaceBack grows the rest as elements actually arrive
+            v.Reserve(bounded ? count : std::min(count, kStep));
+            for (size_t i = 0; i < count; ++i)
+            {
+                v.EmplaceBack(Serializer<T>::Read(reader));
+            }
+        }
+    }
+    catch (...)
+    {
+        v.Clear();
+        throw;
+    }
+}
+
+inline FdWriter::FdWriter(int fd) noexcept
+    : fd_(fd)
+{
+}
+
+inline void FdWriter::Write(const void* data, size_t bytes)
+{
+    const char* in = static_cast<const char*>(data);
+    while (bytes > 0)
+    {
+        const ssize_t written = write(fd_, in, bytes);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            detail::ThrowSerializationError("FdWriter");
+        }
+        in += written;
+        bytes -= written;
+    }
+}
+
+inline void FdWriter::WriteV(const iovec* iov, int count)
+{
+    // writev may stop early, so continue from the first unwritten byte
+    Vector<iovec> pending(iov, iov + count);
+    iovec* current = pending.begin();
+    while (current != pending.end())
+    {
+        const ssize_t written = writev(fd_, current, static_cast<int>(pending.end() - current));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            detail::ThrowSerializationError("FdWriter");
+        }
+        size_t left = static_cast<size_t>(written);
+        while (current != pending.end() && left >= current->iov_len)
+        {
+            left -= current->iov_len;
+            ++current;
+        }
+        if (current != pending.end())
+        {
+            current->iov_base = static_cast<char*>(current->iov_base) + left;
+            current->iov_len -= left;
+        }
+    }
+}
+
+inline FdReader::FdReader(int fd) noexcept
+    : fd_(fd)
+{
+}
+
+inline void FdReader::Read(void* data, size_t bytes)
+{
+    char* out = static_cast<char*>(data);
+    while (bytes > 0)
+    {
+        const ssize_t n = read(fd_, out, bytes);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            detail::ThrowSerializationError("FdReader");
+        }
+        if (n == 0)
+        {
+            throw std::runtime_error("FdReader: unexpected end of file");
+        }
+        out += n;
+        bytes -= n;
+    }
+}
+
+inline VectorWriter::VectorWriter(Vector<unsigned char>& buffer) noexcept
+    : buffer_(&buffer)
+{
+}
+
+inline void VectorWriter::Write(const void* data, size_t bytes)
+{
+    const auto* first = static_cast<const unsigned char*>(data);
+    buffer_->Append(first, first + bytes);
+}
+
+inline BufferReader::BufferReader(const void* data, size_t bytes) noexcept
+    : data_(static_cast<const unsigned char*>(data))
+    , remaining_(bytes)
+{
+}
+
+inline void BufferReader::Read(void* data, size_t bytes)
+{
+    if (bytes > remaining_)
+    {
+        throw std::runtime_error("BufferReader: unexpected end of buffer");
+    }
+    if (bytes > 0)
+    {
+        std::memcpy(data, data_, bytes);
+    }
+    data_ += bytes;
+    remaining_ -= bytes;
+}
+
+inline size_t BufferReader::Remaining() const noexcept
+{
+    return remaining_;
+}
@@ -0,0 +1,436 @@
+#pragma once
+
+#include "vector.h"
+
+#include <atomic>
+#include <cassert>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Copy-on-write Vector. Copies share one block with an atomic reference
+// count, so taking a snapshot is O(1) and allocates nothing. The first
+// mutating call on a shared copy duplicates the elements. Non-const
+// begin(), end() and operator[] count as mutating; read through a const
+// reference or cbegin() to keep sharing. Copies may be made and used on
+// different threads, but one SharedVector object is not thread-safe
+template <typename T, typename Alloc = std::allocator<T>, typename Growth = DoublingGrowth>
+class SharedVector
+{
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using allocator_type = Alloc;
+    using vector_type = Vector<T, Alloc, Growth>;
+
+    SharedVector() = default;
+    explicit SharedVector(const Alloc& alloc) noexcept;
+    explicit SharedVector(size_t size, const Alloc& alloc = Alloc());
+    SharedVector(std::initializer_list<T> init, const Alloc& alloc = Alloc());
+    // Takes the elements over without copying them
+    explicit SharedVector(vector_type&& elements);
+    SharedVector(const SharedVector& other) noexcept;
+    SharedVector& operator=(const SharedVector& rhs) noexcept;
+    SharedVector(SharedVector&& other) noexcept;
+    SharedVector& operator=(SharedVector&& rhs) noexcept;
+    ~SharedVector();
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+    const_iterator cbegin() const noexcept;
+    const_iterator cend() const noexcept;
+
+    size_t Size() const noexcept;
+    size_t Capacity() const noexcept;
+    allocator_type GetAllocator() const noexcept;
+    // Number of SharedVector objects sharing the elements, 0 for an empty one
+    // that never allocated
+    size_t UseCount() const noexcept;
+    bool IsShared() const noexcept;
+    // Read-only view of the elements as a plain Vector
+    const vector_type& Get() const noexcept;
+    // Unshares the elements and returns them for any number of edits. Edits
+    // through the reference must stop once this SharedVector is copied
+    vector_type& Mutable();
+
+    const T& operator[](size_t index) const noexcept;
+    T& operator[](size_t index);
+    void Swap(SharedVector& other) noexcept;
+    void Reserve(size_t new_capacity);
+    void Resize(size_t new_size);
+    // Drops the reference to shared elements instead of copying them
+    void Clear() noexcept;
+    template<typename F>
+    void PushBack(F&& value);
+    void PopBack();
+    template<typename... Ts>
+    T& EmplaceBack(Ts&&... vs);
+    template <typename... Ts>
+    iterator Emplace(const_iterator pos, Ts&&... vs);
+    template<typename F>
+    iterator Insert(const_iterator pos, F&& value);
+    iterator Erase(const_iterator pos);
+    iterator Erase(const_iterator first, const_iterator last);
+
+private:
+    struct Block {
+        template <typename... Args>
+        explicit Block(Args&&... args)
+            : elements(std::forward<Args>(args)...)
+        {
+        }
+
+        std::atomic<size_t> refs = 1;
+        vector_type elements;
+    };
+
+    using BlockAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Block>;
+    using BlockAllocTraits = std::allocator_traits<BlockAlloc>;
+
+    template <typename... Args>
+    Block* NewBlock(Args&&... args);
+    void Unref(Block* block) noexcept;
+    // Makes block_ a block owned only by this object and returns the block
+    // it replaced, still referenced, or nullptr. Keeping the old block until
+    // an insert is done keeps alive the elements its arguments may refer to
+    Block* Unshare();
+    vector_type& Detach();
+
+    // Allocator for the blocks of this object; the elements use the one
+    // of their Vector
+    Alloc alloc_;
+    Block* block_ = nullptr;
+};
+
+template<typename T, typename Alloc, typename Growth>
+SharedVector<T, Alloc, Growth>::SharedVector(const Alloc& alloc) noexcept
+    : alloc_(alloc)
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+SharedVector<T, Alloc, Growth>::SharedVector(size_t size, const Alloc& alloc)
+    : alloc_(alloc)
+    , block_(NewBlock(size, alloc))
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+SharedVector<T, Alloc, Growth>::SharedVector(std::initializer_list<T> init, const Alloc& alloc)
+    : alloc_(alloc)
+    , block_(NewBlock(init, alloc))
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+SharedVector<T, Alloc, Growth>::SharedVector(vector_type&& elements)
+    : alloc_(elements.GetAllocator())
+    , block_(NewBlock(std::move(elements)))
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+SharedVector<T, Alloc, Growth>::SharedVector(const SharedVector& other) noexcept
+    : alloc_(other.alloc_)
+    , block_(other.block_)
+{
+    if (block_ != nullptr)
+    {
+        // A new reference comes from an existing one, nothing to order
+        block_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+SharedVector<T, Alloc, Growth>& SharedVector<T, Alloc, Growth>::operator=(const SharedVector& rhs) noexcept
+{
+    if (block_ != rhs.block_)
+    {
+        SharedVector rhs_copy(rhs);
+        Swap(rhs_copy);
+    }
+    return *this;
+}
+
+template<typename T, typename Alloc, typename Growth>
+SharedVector<T, Alloc, Growth>::SharedVector(SharedVector&& other) noexcept
+    : alloc_(other.alloc_)
+    , block_(std::exchange(other.block_, nullptr))
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+SharedVector<T, Alloc, Growth>& SharedVector<T, Alloc, Growth>::operator=(SharedVector&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        SharedVector rhs_move(std::move(rhs));
+        Swap(rhs_move);
+    }
+    return *this;
+}
+
+template<typename T, typename Alloc, typename Growth>
+SharedVector<T, Alloc, Growth>::~SharedVector()
+{
+    Unref(block_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::iterator SharedVector<T, Alloc, Growth>::begin()
+{
+    return Detach().begin();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::iterator SharedVector<T, Alloc, Growth>::end()
+{
+    return Detach().end();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::const_iterator SharedVector<T, Alloc, Growth>::begin() const noexcept
+{
+    return Get().begin();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::const_iterator SharedVector<T, Alloc, Growth>::end() const noexcept
+{
+    return Get().end();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::const_iterator SharedVector<T, Alloc, Growth>::cbegin() const noexcept
+{
+    return begin();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::const_iterator SharedVector<T, Alloc, Growth>::cend() const noexcept
+{
+    return end();
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t SharedVector<T, Alloc, Growth>::Size() const noexcept
+{
+    return Get().Size();
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t SharedVector<T, Alloc, Growth>::Capacity() const noexcept
+{
+    return Get().Capacity();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::allocator_type SharedVector<T, Alloc, Growth>::GetAllocator() const noexcept
+{
+    return alloc_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t SharedVector<T, Alloc, Growth>::UseCount() const noexcept
+{
+    return block_ == nullptr ? 0 : block_->refs.load(std::memory_order_acquire);
+}
+
+template<typename T, typename Alloc, typename Growth>
+bool SharedVector<T, Alloc, Growth>::IsShared() const noexcept
+{
+    return UseCount() > 1;
+}
+
+template<typename T, typename Alloc, typename Growth>
+const typename SharedVector<T, Alloc, Growth>::vector_type& SharedVector<T, Alloc, Growth>::Get() const noexcept
+{
+    static const vector_type empty;
+    return block_ == nullptr ? empty : block_->elements;
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::vector_type& SharedVector<T, Alloc, Growth>::Mutable()
+{
+    return Detach();
+}
+
+template<typename T, typename Alloc, typename Growth>
+const T& SharedVector<T, Alloc, Growth>::operator[](size_t index) const noexcept
+{
+    assert(index < Size());
+    return block_->elements[index];
+}
+
+template<typename T, typename Alloc, typename Growth>
+T& SharedVector<T, Alloc, Growth>::operator[](size_t index)
+{
+    assert(index < Size());
+    return Detach()[index];
+}
+
+template<typename T, typename Alloc, typename Growth>
+void SharedVector<T, Alloc, Growth>::Swap(SharedVector& other) noexcept
+{
+    using std::swap;
+    swap(alloc_, other.alloc_);
+    swap(block_, other.block_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+void SharedVector<T, Alloc, Growth>::Reserve(size_t new_capacity)
+{
+    if (new_capacity > Capacity() || IsShared())
+    {
+        Detach().Reserve(new_capacity);
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+void SharedVector<T, Alloc, Growth>::Resize(size_t new_size)
+{
+    Detach().Resize(new_size);
+}
+
+template<typename T, typename Alloc, typename Growth>
+void SharedVector<T, Alloc, Growth>::Clear() noexcept
+{
+    if (IsShared())
+    {
+        Unref(std::exchange(block_, nullptr));
+    }
+    else if (block_ != nullptr)
+    {
+        block_->elements.Clear();
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename F>
+void SharedVector<T, Alloc, Growth>::PushBack(F&& value)
+{
+    EmplaceBack(std::forward<F>(value));
+}
+
+template<typename T, typename Alloc, typename Growth>
+void SharedVector<T, Alloc, Growth>::PopBack()
+{
+    assert(Size() > 0);
+    Detach().PopBack();
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename... Ts>
+T& SharedVector<T, Alloc, Growth>::EmplaceBack(Ts&&... vs)
+{
+    Block* old = Unshare();
+    try
+    {
+        T& result = block_->elements.EmplaceBack(std::forward<Ts>(vs)...);
+        Unref(old);
+        return result;
+    }
+    catch (...)
+    {
+        Unref(old);
+        throw;
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename... Ts>
+typename SharedVector<T, Alloc, Growth>::iterator SharedVector<T, Alloc, Growth>::Emplace(const_iterator pos, Ts&&... vs)
+{
+    const size_t index = pos - cbegin();
+    Block* old = Unshare();
+    try
+    {
+        const iterator result = block_->elements.Emplace(block_->elements.begin() + index, std::forward<Ts>(vs)...);
+        Unref(old);
+        return result;
+    }
+    catch (...)
+    {
+        Unref(old);
+        throw;
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename F>
+typename SharedVector<T, Alloc, Growth>::iterator SharedVector<T, Alloc, Growth>::Insert(const_iterator pos, F&& value)
+{
+    return Emplace(pos, std::forward<F>(value));
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::iterator SharedVector<T, Alloc, Growth>::Erase(const_iterator pos)
+{
+    assert(pos >= cbegin() && pos < cend());
+    return Erase(pos, pos + 1);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::iterator SharedVector<T, Alloc, Growth>::Erase(const_iterator first, const_iterator last)
+{
+    assert(first >= cbegin() && first <= last && last <= cend());
+    const size_t index = first - cbegin();
+    const size_t count = last - first;
+    const iterator from = Detach().begin() + index;
+    return block_->elements.Erase(from, from + count);
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename... Args>
+typename SharedVector<T, Alloc, Growth>::Block* SharedVector<T, Alloc, Growth>::NewBlock(Args&&... args)
+{
+    BlockAlloc block_alloc(alloc_);
+    Block* block = BlockAllocTraits::allocate(block_alloc, 1);
+    try
+    {
+        BlockAllocTraits::construct(block_alloc, block, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        BlockAllocTraits::deallocate(block_alloc, block, 1);
+        throw;
+    }
+    return block;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void SharedVector<T, Alloc, Growth>::Unref(Block* block) noexcept
+{
+    // The last owner has to see every write made through the other ones
+    if (block != nullptr && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        BlockAlloc block_alloc(alloc_);
+        BlockAllocTraits::destroy(block_alloc, block);
+        BlockAllocTraits::deallocate(block_alloc, block, 1);
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::Block* SharedVector<T, Alloc, Growth>::Unshare()
+{
+    if (block_ == nullptr)
+    {
+        block_ = NewBlock(alloc_);
+    }
+    else if (block_->refs.load(std::memory_order_acquire) != 1)
+    {
+        return std::exchange(block_, NewBlock(block_->elements));
+    }
+    return nullptr;
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename SharedVector<T, Alloc, Growth>::vector_type& SharedVector<T, Alloc, Growth>::Detach()
+{
+    Unref(Unshare());
+    return block_->elements;
+}
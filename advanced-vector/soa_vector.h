@@ -0,0 +1,471 @@
+#pragma once
+
+#include "vector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Contiguous view of one column of a SoAVector. Invalidated like pointers
+// into a Vector
+template <typename T>
+class ColumnSpan
+{
+public:
+    ColumnSpan(T* data, size_t size) noexcept
+        : data_(data)
+        , size_(size)
+    {
+    }
+
+    T* begin() const noexcept { return data_; }
+    T* end() const noexcept { return data_ + size_; }
+    T* Data() const noexcept { return data_; }
+    size_t Size() const noexcept { return size_; }
+
+    T& operator[](size_t index) const noexcept
+    {
+        assert(index < size_);
+        return data_[index];
+    }
+
+private:
+    T* data_;
+    size_t size_;
+};
+
+// Vector of records stored as one RawMemory column per field, so a scan
+// over one field reads only that field's bytes. operator[] returns a tuple
+// of references to the fields of a record, which supports std::get,
+// structured bindings and assignment from a std::tuple<Fields...>.
+// Growth, insertion and erasure give the same guarantees as Vector
+template <typename... Fields>
+class SoAVector
+{
+public:
+    using value_type = std::tuple<Fields...>;
+    using reference = std::tuple<Fields&...>;
+    using const_reference = std::tuple<const Fields&...>;
+    using growth_policy = DoublingGrowth;
+
+    template <size_t I>
+    using FieldType = std::tuple_element_t<I, value_type>;
+
+    static_assert(sizeof...(Fields) > 0, "a record needs at least one field");
+
+    SoAVector() = default;
+    explicit SoAVector(size_t size);
+    SoAVector(const SoAVector& other);
+    SoAVector& operator=(const SoAVector& rhs);
+    SoAVector(SoAVector&& other) noexcept;
+    SoAVector& operator=(SoAVector&& rhs) noexcept;
+    ~SoAVector();
+
+    size_t Size() const noexcept;
+    size_t Capacity() const noexcept;
+    void Reserve(size_t new_capacity);
+    void Resize(size_t new_size);
+    void Clear() noexcept;
+    void Swap(SoAVector& other) noexcept;
+
+    reference operator[](size_t index) noexcept;
+    const_reference operator[](size_t index) const noexcept;
+    template <size_t I>
+    ColumnSpan<FieldType<I>> Column() noexcept;
+    template <size_t I>
+    ColumnSpan<const FieldType<I>> Column() const noexcept;
+
+    // Takes one value per field
+    template <typename... Ts>
+    reference EmplaceBack(Ts&&... values);
+    void PopBack() noexcept;
+    void Erase(size_t index) noexcept(kNothrowMoveAssign);
+    // Removes the records [first, last). Fields whose move assignment may
+    // throw are shifted by copy assignment, so none is left moved-from
+    void Erase(size_t first, size_t last) noexcept(kNothrowMoveAssign);
+
+private:
+    using Columns = std::tuple<RawMemory<Fields>...>;
+    using Indices = std::index_sequence_for<Fields...>;
+
+    static constexpr bool kNothrowRelocate = (detail::kNothrowRelocate<Fields> && ...);
+    static constexpr bool kNothrowMoveAssign = (std::is_nothrow_move_assignable_v<Fields> && ...);
+
+    // Calls f(std::integral_constant<size_t, I>) for every column in order
+    template <typename F>
+    static void ForEachColumn(F&& f);
+    template <typename F, size_t... Is>
+    static void ForEachColumn(F& f, std::index_sequence<Is...>);
+
+    static Columns Allocate(size_t capacity);
+    // Copies count records into the uninitialized columns to, moving the
+    // move-only fields when from is not const. If one throws, nothing is
+    // left constructed in to
+    template <typename From>
+    static void CopyColumns(From& from, Columns& to, size_t count);
+    // Moves the records to new_columns. If that throws the vector keeps all its records
+    void RelocateTo(Columns& new_columns) noexcept(kNothrowRelocate);
+    // Constructs the record at index from one value per field, all or nothing
+    template <typename... Ts>
+    static void ConstructAt(Columns& columns, size_t index, Ts&&... values);
+    template <size_t... Is, typename... Ts>
+    static void ConstructFields(Columns& columns, size_t index, size_t& constructed,
+        std::index_sequence<Is...>, Ts&&... values);
+    template <size_t... Is>
+    reference MakeReference(size_t index, std::index_sequence<Is...>) noexcept;
+    template <size_t... Is>
+    const_reference MakeReference(size_t index, std::index_sequence<Is...>) const noexcept;
+    void DestroyRange(size_t first, size_t last) noexcept;
+
+    Columns columns_;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+template<typename... Fields>
+SoAVector<Fields...>::SoAVector(size_t size)
+    : columns_(Allocate(size))
+    , capacity_(size)
+{
+    Resize(size);
+}
+
+template<typename... Fields>
+SoAVector<Fields...>::SoAVector(const SoAVector& other)
+    : columns_(Allocate(other.size_))
+    , capacity_(other.size_)
+{
+    CopyColumns(other.columns_, columns_, other.size_);
+    size_ = other.size_;
+}
+
+template<typename... Fields>
+SoAVector<Fields...>& SoAVector<Fields...>::operator=(const SoAVector& rhs)
+{
+    if (this != &rhs)
+    {
+        SoAVector rhs_copy(rhs);
+        Swap(rhs_copy);
+    }
+    return *this;
+}
+
+template<typename... Fields>
+SoAVector<Fields...>::SoAVector(SoAVector&& other) noexcept
+    : columns_(std::move(other.columns_))
+    , size_(std::exchange(other.size_, 0))
+    , capacity_(std::exchange(other.capacity_, 0))
+{
+}
+
+template<typename... Fields>
+SoAVector<Fields...>& SoAVector<Fields...>::operator=(SoAVector&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        SoAVector rhs_move(std::move(rhs));
+        Swap(rhs_move);
+    }
+    return *this;
+}
+
+template<typename... Fields>
+SoAVector<Fields...>::~SoAVector()
+{
+    DestroyRange(0, size_);
+}
+
+template<typename... Fields>
+size_t SoAVector<Fields...>::Size() const noexcept
+{
+    return size_;
+}
+
+template<typename... Fields>
+size_t SoAVector<Fields...>::Capacity() const noexcept
+{
+    return capacity_;
+}
+
+template<typename... Fields>
+void SoAVector<Fields...>::Reserve(size_t new_capacity)
+{
+    if (new_capacity <= capacity_)
+    {
+        return;
+    }
+    Columns new_columns = Allocate(new_capacity);
+    RelocateTo(new_columns);
+    columns_.swap(new_columns);
+    capacity_ = new_capacity;
+}
+
+template<typename... Fields>
+void SoAVector<Fields...>::Resize(size_t new_size)
+{
+    if (new_size <= size_)
+    {
+        DestroyRange(new_size, size_);
+        size_ = new_size;
+        return;
+    }
+    Reserve(new_size);
+    size_t constructed = 0;
+    try
+    {
+        ForEachColumn([&](auto i) {
+            std::uninitialized_value_construct_n(std::get<i>(columns_) + size_, new_size - size_);
+            ++constructed;
+        });
+    }
+    catch (...)
+    {
+        ForEachColumn([&](auto i) {
+            if (i < constructed)
+            {
+                std::destroy_n(std::get<i>(columns_) + size_, new_size - size_);
+            }
+        });
+        throw;
+    }
+    size_ = new_size;
+}
+
+template<typename... Fields>
+void SoAVector<Fields...>::Clear() noexcept
+{
+    DestroyRange(0, size_);
+    size_ = 0;
+}
+
+template<typename... Fields>
+void SoAVector<Fields...>::Swap(SoAVector& other) noexcept
+{
+    columns_.swap(other.columns_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+}
+
+template<typename... Fields>
+typename SoAVector<Fields...>::reference SoAVector<Fields...>::operator[](size_t index) noexcept
+{
+    assert(index < size_);
+    return MakeReference(index, Indices{});
+}
+
+template<typename... Fields>
+typename SoAVector<Fields...>::const_reference SoAVector<Fields...>::operator[](size_t index) const noexcept
+{
+    assert(index < size_);
+    return MakeReference(index, Indices{});
+}
+
+template<typename... Fields>
+template<size_t I>
+ColumnSpan<typename SoAVector<Fields...>::template FieldType<I>> SoAVector<Fields...>::Column() noexcept
+{
+    return {std::get<I>(columns_).GetAddress(), size_};
+}
+
+template<typename... Fields>
+template<size_t I>
+ColumnSpan<const typename SoAVector<Fields...>::template FieldType<I>> SoAVector<Fields...>::Column() const noexcept
+{
+    return {std::get<I>(columns_).GetAddress(), size_};
+}
+
+template<typename... Fields>
+template<typename... Ts>
+typename SoAVector<Fields...>::reference SoAVector<Fields...>::EmplaceBack(Ts&&... values)
+{
+    static_assert(sizeof...(Ts) == sizeof...(Fields), "EmplaceBack takes one value per field");
+    if (size_ == capacity_)
+    {
+        const size_t new_capacity = growth_policy::NextCapacity(size_, (sizeof(Fields) + ...));
+        Columns new_columns = Allocate(new_capacity);
+        // values may refer to fields of this vector, so construct before relocating
+        ConstructAt(new_columns, size_, std::forward<Ts>(values)...);
+        try
+        {
+            RelocateTo(new_columns);
+        }
+        catch (...)
+        {
+            ForEachColumn([&](auto i) {
+                std::destroy_at(std::get<i>(new_columns) + size_);
+            });
+            throw;
+        }
+        columns_.swap(new_columns);
+        capacity_ = new_capacity;
+    }
+    else
+    {
+        ConstructAt(columns_, size_, std::forward<Ts>(values)...);
+    }
+    ++size_;
+    return (*this)[size_ - 1];
+}
+
+template<typename... Fields>
+void SoAVector<Fields...>::PopBack() noexcept
+{
+    assert(size_ > 0);
+    DestroyRange(size_ - 1, size_);
+    --size_;
+}
+
+template<typename... Fields>
+void SoAVector<Fields...>::Erase(size_t index) noexcept(kNothrowMoveAssign)
+{
+    Erase(index, index + 1);
+}
+
+template<typename... Fields>
+void SoAVector<Fields...>::Erase(size_t first, size_t last) noexcept(kNothrowMoveAssign)
+{
+    assert(first <= last && last <= size_);
+    if (first == last)
+    {
+        return;
+    }
+    ForEachColumn([&](auto i) {
+        auto* data = std::get<i>(columns_).GetAddress();
+        using Field = std::remove_pointer_t<decltype(data)>;
+        if constexpr (std::is_nothrow_move_assignable_v<Field> || !std::is_copy_assignable_v<Field>)
+        {
+            std::move(data + last, data + size_, data + first);
+        }
+        else
+        {
+            std::copy(data + last, data + size_, data + first);
+        }
+    });
+    const size_t new_size = size_ - (last - first);
+    DestroyRange(new_size, size_);
+    size_ = new_size;
+}
+
+template<typename... Fields>
+template<typename F>
+void SoAVector<Fields...>::ForEachColumn(F&& f)
+{
+    ForEachColumn(f, Indices{});
+}
+
+template<typename... Fields>
+template<typename F, size_t... Is>
+void SoAVector<Fields...>::ForEachColumn(F& f, std::index_sequence<Is...>)
+{
+    (f(std::integral_constant<size_t, Is>{}), ...);
+}
+
+template<typename... Fields>
+typename SoAVector<Fields...>::Columns SoAVector<Fields...>::Allocate(size_t capacity)
+{
+    return Columns(RawMemory<Fields>(capacity)...);
+}
+
+template<typename... Fields>
+template<typename From>
+void SoAVector<Fields...>::CopyColumns(From& from, Columns& to, size_t count)
+{
+    size_t copied = 0;
+    try
+    {
+        ForEachColumn([&](auto i) {
+            if constexpr (std::is_const_v<From>)
+            {
+                std::uninitialized_copy_n(std::get<i>(from).GetAddress(), count, std::get<i>(to).GetAddress());
+            }
+            else
+            {
+                detail::UninitializedCopyOrMoveN(std::get<i>(from).GetAddress(), count, std::get<i>(to).GetAddress());
+            }
+            ++copied;
+        });
+    }
+    catch (...)
+    {
+        ForEachColumn([&](auto i) {
+            if (i < copied)
+            {
+                std::destroy_n(std::get<i>(to).GetAddress(), count);
+            }
+        });
+        throw;
+    }
+}
+
+template<typename... Fields>
+void SoAVector<Fields...>::RelocateTo(Columns& new_columns) noexcept(kNothrowRelocate)
+{
+    if constexpr (kNothrowRelocate)
+    {
+        ForEachColumn([&](auto i) {
+            detail::Relocate(std::get<i>(columns_).GetAddress(), size_, std::get<i>(new_columns).GetAddress());
+        });
+    }
+    else
+    {
+        // Build every column before destroying any original, so a throw in
+        // a later column leaves this vector with all its records
+        CopyColumns(columns_, new_columns, size_);
+        DestroyRange(0, size_);
+    }
+}
+
+template<typename... Fields>
+template<typename... Ts>
+void SoAVector<Fields...>::ConstructAt(Columns& columns, size_t index, Ts&&... values)
+{
+    size_t constructed = 0;
+    try
+    {
+        ConstructFields(columns, index, constructed, Indices{}, std::forward<Ts>(values)...);
+    }
+    catch (...)
+    {
+        ForEachColumn([&](auto i) {
+            if (i < constructed)
+            {
+                std::destroy_at(std::get<i>(columns) + index);
+            }
+        });
+        throw;
+    }
+}
+
+template<typename... Fields>
+template<size_t... Is, typename... Ts>
+void SoAVector<Fields...>::ConstructFields(Columns& columns, size_t index, size_t& constructed,
+    std::index_sequence<Is...>, Ts&&... values)
+{
+    ((new (std::get<Is>(columns) + index) FieldType<Is>(std::forward<Ts>(values)), ++constructed), ...);
+}
+
+template<typename... Fields>
+template<size_t... Is>
+typename SoAVector<Fields...>::reference SoAVector<Fields...>::MakeReference(size_t index, std::index_sequence<Is...>) noexcept
+{
+    return reference(std::get<Is>(columns_)[index]...);
+}
+
+template<typename... Fields>
+template<size_t... Is>
+typename SoAVector<Fields...>::const_reference SoAVector<Fields...>::MakeReference(size_t index, std::index_sequence<Is...>) const noexcept
+{
+    return const_reference(std::get<Is>(columns_)[index]...);
+}
+
+template<typename... Fields>
+void SoAVector<Fields...>::DestroyRange(size_t first, size_t last) noexcept
+{
+    ForEachColumn([&](auto i) {
+        std::destroy_n(std::get<i>(columns_) + first, last - first);
+    });
+}
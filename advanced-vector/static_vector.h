@@ -0,0 +1,522 @@
+#pragma once
+
+#include "vector.h"
+
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Overflow policies of StaticVector: what an operation does when it needs
+// more than N elements.
+// Checks only in debug builds, so release builds pay nothing for them.
+// Overflow is never constexpr, so an overflow during constant evaluation
+// fails to compile under every policy
+struct AssertOnOverflow {
+    static constexpr bool kReturnsFalse = false;
+    static void Overflow() noexcept
+    {
+        assert(!"StaticVector: capacity exceeded");
+    }
+};
+
+struct ThrowOnOverflow {
+    static constexpr bool kReturnsFalse = false;
+    [[noreturn]] static void Overflow()
+    {
+        throw std::length_error("StaticVector: capacity exceeded");
+    }
+};
+
+// Growing operations return bool and leave the vector untouched when full.
+// Constructors cannot return false, so they assert like AssertOnOverflow
+struct ReturnFalseOnOverflow {
+    static constexpr bool kReturnsFalse = true;
+    static void Overflow() noexcept
+    {
+        assert(!"StaticVector: capacity exceeded");
+    }
+};
+
+namespace detail {
+
+// Trivial elements live in a plain array, which keeps StaticVector a
+// literal type. C++17 constant evaluation needs every element initialized,
+// so a new vector zeroes its N slots
+template <typename T, size_t N, bool = std::is_trivial_v<T>>
+struct StaticStorage {
+    constexpr T* Data() noexcept { return elements; }
+    constexpr const T* Data() const noexcept { return elements; }
+
+    T elements[N] = {};
+    size_t size = 0;
+};
+
+// Other elements are constructed in raw bytes on demand
+template <typename T, size_t N>
+struct StaticStorage<T, N, false> {
+    StaticStorage() = default;
+    StaticStorage(const StaticStorage& other);
+    StaticStorage& operator=(const StaticStorage& rhs);
+    StaticStorage(StaticStorage&& other) noexcept(std::is_nothrow_move_constructible_v<T>);
+    StaticStorage& operator=(StaticStorage&& rhs) noexcept(std::is_nothrow_move_constructible_v<T> &&
+        std::is_nothrow_move_assignable_v<T>);
+    ~StaticStorage();
+
+    T* Data() noexcept { return std::launder(reinterpret_cast<T*>(bytes)); }
+    const T* Data() const noexcept { return std::launder(reinterpret_cast<const T*>(bytes)); }
+
+    alignas(T) unsigned char bytes[N * sizeof(T)];
+    size_t size = 0;
+};
+
+}  // namespace detail
+
+// Vector of at most N elements kept inline, without any allocation. For
+// trivial T every operation is constexpr, so tables may be built at compile
+// time. What happens on overflow is chosen by OverflowPolicy
+template <typename T, size_t N, typename OverflowPolicy = AssertOnOverflow>
+class StaticVector
+{
+    // Growing operations return bool under ReturnFalseOnOverflow
+    template <typename R>
+    using Result = std::conditional_t<OverflowPolicy::kReturnsFalse, bool, R>;
+
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using overflow_policy = OverflowPolicy;
+
+    static_assert(N > 0, "StaticVector needs room for at least one element");
+
+    constexpr StaticVector() = default;
+    constexpr explicit StaticVector(size_t size);
+    constexpr StaticVector(std::initializer_list<T> init);
+
+    constexpr iterator begin() noexcept;
+    constexpr iterator end() noexcept;
+    constexpr const_iterator begin() const noexcept;
+    constexpr const_iterator end() const noexcept;
+    constexpr const_iterator cbegin() const noexcept;
+    constexpr const_iterator cend() const noexcept;
+
+    constexpr size_t Size() const noexcept;
+    static constexpr size_t Capacity() noexcept;
+    constexpr const T& operator[](size_t index) const noexcept;
+    constexpr T& operator[](size_t index) noexcept;
+    constexpr void Clear() noexcept;
+    constexpr Result<void> Resize(size_t new_size);
+    template<typename F>
+    constexpr Result<void> PushBack(F&& value);
+    constexpr void PopBack() noexcept;
+    template<typename... Ts>
+    constexpr Result<T&> EmplaceBack(Ts&&... vs);
+    template <typename... Ts>
+    constexpr Result<iterator> Emplace(const_iterator pos, Ts&&... vs);
+    template<typename F>
+    constexpr Result<iterator> Insert(const_iterator pos, F&& value);
+    constexpr iterator Erase(const_iterator pos) noexcept(std::is_nothrow_move_assignable_v<T>);
+    constexpr iterator Erase(const_iterator first, const_iterator last) noexcept(
+        std::is_nothrow_move_assignable_v<T>);
+
+private:
+    static constexpr bool kTrivial = std::is_trivial_v<T>;
+
+    // Starts the lifetime of the element at index, a plain assignment for trivial T
+    template <typename... Ts>
+    constexpr void ConstructAt(size_t index, Ts&&... vs);
+    constexpr void DestroyFrom(size_t index) noexcept;
+
+    detail::StaticStorage<T, N> storage_;
+};
+
+template <typename T, size_t N, typename OverflowPolicy>
+constexpr bool operator==(const StaticVector<T, N, OverflowPolicy>& lhs, const StaticVector<T, N, OverflowPolicy>& rhs);
+template <typename T, size_t N, typename OverflowPolicy>
+constexpr bool operator!=(const StaticVector<T, N, OverflowPolicy>& lhs, const StaticVector<T, N, OverflowPolicy>& rhs);
+
+namespace detail {
+
+template<typename T, size_t N>
+StaticStorage<T, N, false>::StaticStorage(const StaticStorage& other)
+{
+    std::uninitialized_copy_n(other.Data(), other.size, Data());
+    size = other.size;
+}
+
+template<typename T, size_t N>
+StaticStorage<T, N, false>& StaticStorage<T, N, false>::operator=(const StaticStorage& rhs)
+{
+    if (this != &rhs)
+    {
+        if (rhs.size < size)
+        {
+            std::copy_n(rhs.Data(), rhs.size, Data());
+            std::destroy_n(Data() + rhs.size, size - rhs.size);
+        }
+        else
+        {
+            std::copy_n(rhs.Data(), size, Data());
+            std::uninitialized_copy_n(rhs.Data() + size, rhs.size - size, Data() + size);
+        }
+        size = rhs.size;
+    }
+    return *this;
+}
+
+template<typename T, size_t N>
+StaticStorage<T, N, false>::StaticStorage(StaticStorage&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+{
+    std::uninitialized_move_n(other.Data(), other.size, Data());
+    size = other.size;
+}
+
+template<typename T, size_t N>
+StaticStorage<T, N, false>& StaticStorage<T, N, false>::operator=(StaticStorage&& rhs) noexcept(
+    std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>)
+{
+    if (this != &rhs)
+    {
+        if (rhs.size < size)
+        {
+            std::move(rhs.Data(), rhs.Data() + rhs.size, Data());
+            std::destroy_n(Data() + rhs.size, size - rhs.size);
+        }
+        else
+        {
+            std::move(rhs.Data(), rhs.Data() + size, Data());
+            std::uninitialized_move_n(rhs.Data() + size, rhs.size - size, Data() + size);
+        }
+        size = rhs.size;
+    }
+    return *this;
+}
+
+template<typename T, size_t N>
+StaticStorage<T, N, false>::~StaticStorage()
+{
+    std::destroy_n(Data(), size);
+}
+
+}  // namespace detail
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr StaticVector<T, N, OverflowPolicy>::StaticVector(size_t size)
+{
+    if (size > N)
+    {
+        OverflowPolicy::Overflow();
+    }
+    if constexpr (kTrivial)
+    {
+        storage_.size = size;
+    }
+    else
+    {
+        std::uninitialized_value_construct_n(storage_.Data(), size);
+        storage_.size = size;
+    }
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr StaticVector<T, N, OverflowPolicy>::StaticVector(std::initializer_list<T> init)
+{
+    if (init.size() > N)
+    {
+        OverflowPolicy::Overflow();
+    }
+    if constexpr (kTrivial)
+    {
+        for (const T& value : init)
+        {
+            storage_.elements[storage_.size++] = value;
+        }
+    }
+    else
+    {
+        std::uninitialized_copy(init.begin(), init.end(), storage_.Data());
+        storage_.size = init.size();
+    }
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr typename StaticVector<T, N, OverflowPolicy>::iterator StaticVector<T, N, OverflowPolicy>::begin() noexcept
+{
+    return storage_.Data();
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr typename StaticVector<T, N, OverflowPolicy>::iterator StaticVector<T, N, OverflowPolicy>::end() noexcept
+{
+    return storage_.Data() + storage_.size;
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr typename StaticVector<T, N, OverflowPolicy>::const_iterator StaticVector<T, N, OverflowPolicy>::begin() const noexcept
+{
+    return storage_.Data();
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr typename StaticVector<T, N, OverflowPolicy>::const_iterator StaticVector<T, N, OverflowPolicy>::end() const noexcept
+{
+    return storage_.Data() + storage_.size;
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr typename StaticVector<T, N, OverflowPolicy>::const_iterator StaticVector<T, N, OverflowPolicy>::cbegin() const noexcept
+{
+    return begin();
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr typename StaticVector<T, N, OverflowPolicy>::const_iterator StaticVector<T, N, OverflowPolicy>::cend() const noexcept
+{
+    return end();
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr size_t StaticVector<T, N, OverflowPolicy>::Size() const noexcept
+{
+    return storage_.size;
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr size_t StaticVector<T, N, OverflowPolicy>::Capacity() noexcept
+{
+    return N;
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr const T& StaticVector<T, N, OverflowPolicy>::operator[](size_t index) const noexcept
+{
+    assert(index < storage_.size);
+    return storage_.Data()[index];
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr T& StaticVector<T, N, OverflowPolicy>::operator[](size_t index) noexcept
+{
+    assert(index < storage_.size);
+    return storage_.Data()[index];
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr void StaticVector<T, N, OverflowPolicy>::Clear() noexcept
+{
+    DestroyFrom(0);
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr auto StaticVector<T, N, OverflowPolicy>::Resize(size_t new_size) -> Result<void>
+{
+    if (new_size > N)
+    {
+        if constexpr (OverflowPolicy::kReturnsFalse)
+        {
+            return false;
+        }
+        else
+        {
+            OverflowPolicy::Overflow();
+        }
+    }
+    if (new_size < storage_.size)
+    {
+        DestroyFrom(new_size);
+    }
+    else if constexpr (kTrivial)
+    {
+        for (; storage_.size < new_size; ++storage_.size)
+        {
+            storage_.elements[storage_.size] = T();
+        }
+    }
+    else
+    {
+        std::uninitialized_value_construct_n(end(), new_size - storage_.size);
+        storage_.size = new_size;
+    }
+    if constexpr (OverflowPolicy::kReturnsFalse)
+    {
+        return true;
+    }
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+template<typename F>
+constexpr auto StaticVector<T, N, OverflowPolicy>::PushBack(F&& value) -> Result<void>
+{
+    if constexpr (OverflowPolicy::kReturnsFalse)
+    {
+        return EmplaceBack(std::forward<F>(value));
+    }
+    else
+    {
+        EmplaceBack(std::forward<F>(value));
+    }
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr void StaticVector<T, N, OverflowPolicy>::PopBack() noexcept
+{
+    assert(storage_.size > 0);
+    DestroyFrom(storage_.size - 1);
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+template<typename ...Ts>
+constexpr auto StaticVector<T, N, OverflowPolicy>::EmplaceBack(Ts&&... vs) -> Result<T&>
+{
+    if (storage_.size == N)
+    {
+        if constexpr (OverflowPolicy::kReturnsFalse)
+        {
+            return false;
+        }
+        else
+        {
+            OverflowPolicy::Overflow();
+        }
+    }
+    ConstructAt(storage_.size, std::forward<Ts>(vs)...);
+    ++storage_.size;
+    if constexpr (OverflowPolicy::kReturnsFalse)
+    {
+        return true;
+    }
+    else
+    {
+        return storage_.Data()[storage_.size - 1];
+    }
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+template<typename... Ts>
+constexpr auto StaticVector<T, N, OverflowPolicy>::Emplace(const_iterator pos, Ts&&... vs) -> Result<iterator>
+{
+    assert(pos >= begin() && pos <= end());
+    const size_t index = pos - begin();
+    if (index == storage_.size)
+    {
+        if constexpr (OverflowPolicy::kReturnsFalse)
+        {
+            return EmplaceBack(std::forward<Ts>(vs)...);
+        }
+        else
+        {
+            return &EmplaceBack(std::forward<Ts>(vs)...);
+        }
+    }
+    if (storage_.size == N)
+    {
+        if constexpr (OverflowPolicy::kReturnsFalse)
+        {
+            return false;
+        }
+        else
+        {
+            OverflowPolicy::Overflow();
+        }
+    }
+    // vs may refer to an element that is about to be shifted
+    T value(std::forward<Ts>(vs)...);
+    T* data = storage_.Data();
+    ConstructAt(storage_.size, std::move(data[storage_.size - 1]));
+    ++storage_.size;
+    for (size_t i = storage_.size - 2; i > index; --i)
+    {
+        data[i] = std::move(data[i - 1]);
+    }
+    data[index] = std::move(value);
+    if constexpr (OverflowPolicy::kReturnsFalse)
+    {
+        return true;
+    }
+    else
+    {
+        return data + index;
+    }
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+template<typename F>
+constexpr auto StaticVector<T, N, OverflowPolicy>::Insert(const_iterator pos, F&& value) -> Result<iterator>
+{
+    return Emplace(pos, std::forward<F>(value));
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr typename StaticVector<T, N, OverflowPolicy>::iterator StaticVector<T, N, OverflowPolicy>::Erase(
+    const_iterator pos) noexcept(std::is_nothrow_move_assignable_v<T>)
+{
+    return Erase(pos, pos + 1);
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr typename StaticVector<T, N, OverflowPolicy>::iterator StaticVector<T, N, OverflowPolicy>::Erase(
+    const_iterator first, const_iterator last) noexcept(std::is_nothrow_move_assignable_v<T>)
+{
+    assert(first >= begin() && first <= last && last <= end());
+    T* data = storage_.Data();
+    const size_t index = first - data;
+    const size_t count = last - first;
+    for (size_t i = index; i + count < storage_.size; ++i)
+    {
+        data[i] = std::move(data[i + count]);
+    }
+    DestroyFrom(storage_.size - count);
+    return data + index;
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+template<typename... Ts>
+constexpr void StaticVector<T, N, OverflowPolicy>::ConstructAt(size_t index, Ts&&... vs)
+{
+    if constexpr (kTrivial)
+    {
+        storage_.elements[index] = T(std::forward<Ts>(vs)...);
+    }
+    else
+    {
+        new (storage_.Data() + index) T(std::forward<Ts>(vs)...);
+    }
+}
+
+template<typename T, size_t N, typename OverflowPolicy>
+constexpr void StaticVector<T, N, OverflowPolicy>::DestroyFrom(size_t index) noexcept
+{
+    if constexpr (!kTrivial)
+    {
+        std::destroy_n(storage_.Data() + index, storage_.size - index);
+    }
+    storage_.size = index;
+}
+
+template <typename T, size_t N, typename OverflowPolicy>
+constexpr bool operator==(const StaticVector<T, N, OverflowPolicy>& lhs, const StaticVector<T, N, OverflowPolicy>& rhs)
+{
+    if (lhs.Size() != rhs.Size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.Size(); ++i)
+    {
+        if (!(lhs[i] == rhs[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T, size_t N, typename OverflowPolicy>
+constexpr bool operator!=(const StaticVector<T, N, OverflowPolicy>& lhs, const StaticVector<T, N, OverflowPolicy>& rhs)
+{
+    return !(lhs == rhs);
+}
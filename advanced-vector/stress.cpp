@@ -0,0 +1,717 @@
+// Случайное дифференциальное тестирование Vector против std::vector с
+// внедрением исключений и проверка числа копирований и перемещений на
+// вставленный элемент.
+// Сборка: g++ -std=c++17 -O1 -g -fsanitize=address,undefined stress.cpp -o stress
+// Запуск: ./stress [шагов на прогон] [seed]. С seed повторяется один прогон
+#include "vector.h"
+#include "block_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+inline const uint32_t ALIVE_COOKIE = 0xdeadbeef;
+// Значение перемещённого объекта, чтобы он не совпал ни с одним из модели
+inline const int MOVED_FROM = -1;
+
+// Где находится прогон, чтобы сообщение об ошибке позволяло его повторить
+struct Context {
+    const char* config = "";
+    uint64_t seed = 0;
+    size_t step = 0;
+    const char* op = "";
+};
+
+Context context;
+
+[[noreturn]] void Fail(const std::string& what) {
+    std::cerr << "stress: " << context.config << " seed=" << context.seed << " step=" << context.step
+              << " op=" << context.op << ": " << what << std::endl;
+    std::abort();
+}
+
+void Check(bool condition, const char* what) {
+    if (!condition) {
+        Fail(what);
+    }
+}
+
+struct InjectedFailure : std::runtime_error {
+    InjectedFailure()
+        : std::runtime_error("injected failure")  //
+    {
+    }
+};
+
+// Счётчики всех Tracked. Копирующий конструктор и конструктор по умолчанию
+// выбрасывают исключение, когда их обратный отсчёт доходит до нуля
+struct Counters {
+    static void Reset() {
+        copy_throw_countdown = 0;
+        default_throw_countdown = 0;
+        constructed = 0;
+        destroyed = 0;
+        copies = 0;
+        moves = 0;
+        copy_assignments = 0;
+        move_assignments = 0;
+    }
+
+    static int64_t Alive() {
+        return constructed - destroyed;
+    }
+
+    // Все операции, которые переносят значение элемента с места на место
+    static int64_t Transfers() {
+        return copies + moves + copy_assignments + move_assignments;
+    }
+
+    static void MaybeThrow(int& countdown) {
+        if (countdown > 0 && --countdown == 0) {
+            throw InjectedFailure();
+        }
+    }
+
+    static inline int copy_throw_countdown = 0;
+    static inline int default_throw_countdown = 0;
+    static inline int64_t constructed = 0;
+    static inline int64_t destroyed = 0;
+    static inline int64_t copies = 0;
+    static inline int64_t moves = 0;
+    static inline int64_t copy_assignments = 0;
+    static inline int64_t move_assignments = 0;
+};
+
+enum class MoveKind {
+    // Перемещение не бросает, вектор перемещает элементы
+    NOTHROW,
+    // Перемещение объявлено бросающим, вектор копирует элементы при реаллокации
+    THROWING,
+    // Тривиально перемещаемый тип, вектор переносит байты через memcpy
+    RELOCATABLE,
+};
+
+template <MoveKind kind>
+struct Tracked {
+    static constexpr bool kNothrowMove = kind != MoveKind::THROWING;
+
+    Tracked() {
+        Counters::MaybeThrow(Counters::default_throw_countdown);
+        ++Counters::constructed;
+    }
+
+    explicit Tracked(int value)
+        : value(value)  //
+    {
+        ++Counters::constructed;
+    }
+
+    Tracked(const Tracked& other)
+        : value(other.value)  //
+    {
+        other.CheckAlive();
+        Counters::MaybeThrow(Counters::copy_throw_countdown);
+        ++Counters::copies;
+        ++Counters::constructed;
+    }
+
+    Tracked(Tracked&& other) noexcept(kNothrowMove)
+        : value(std::exchange(other.value, MOVED_FROM))  //
+    {
+        other.CheckAlive();
+        ++Counters::moves;
+        ++Counters::constructed;
+    }
+
+    Tracked& operator=(const Tracked& other) {
+        CheckAlive();
+        other.CheckAlive();
+        value = other.value;
+        ++Counters::copy_assignments;
+        return *this;
+    }
+
+    Tracked& operator=(Tracked&& other) noexcept(kNothrowMove) {
+        CheckAlive();
+        other.CheckAlive();
+        value = std::exchange(other.value, MOVED_FROM);
+        ++Counters::move_assignments;
+        return *this;
+    }
+
+    ~Tracked() {
+        CheckAlive();
+        cookie = 0;
+        ++Counters::destroyed;
+    }
+
+    void CheckAlive() const {
+        Check(cookie == ALIVE_COOKIE, "use of a destroyed element");
+    }
+
+    int value = 0;
+    uint32_t cookie = ALIVE_COOKIE;
+};
+
+}  // namespace
+
+template <>
+struct IsTriviallyRelocatable<Tracked<MoveKind::RELOCATABLE>> : std::true_type {};
+
+namespace {
+
+enum class Op {
+    PUSH_BACK_COPY,
+    PUSH_BACK_MOVE,
+    EMPLACE_BACK,
+    EMPLACE,
+    INSERT_COPY,
+    INSERT_COUNT,
+    INSERT_RANGE,
+    INSERT_INPUT_RANGE,
+    APPEND,
+    ERASE,
+    ERASE_RANGE,
+    ERASE_IF,
+    POP_BACK,
+    RESIZE,
+    RESERVE,
+    SHRINK_TO_FIT,
+    CLEAR,
+    COPY_ASSIGN,
+    COPY_CONSTRUCT,
+    MOVE_ASSIGN,
+    SWAP,
+    COUNT,
+};
+
+const char* const OP_NAMES[] = {
+    "PushBack(const T&)", "PushBack(T&&)", "EmplaceBack", "Emplace", "Insert(pos, const T&)",
+    "Insert(pos, count, value)", "Insert(pos, first, last)", "Insert(pos, input range)", "Append",
+    "Erase", "Erase(first, last)", "EraseIf", "PopBack", "Resize", "Reserve", "ShrinkToFit", "Clear",
+    "operator=(const Vector&)", "Vector(const Vector&)", "operator=(Vector&&)", "Swap",
+};
+
+static_assert(std::size(OP_NAMES) == static_cast<size_t>(Op::COUNT));
+
+// Сколько раз выполнялась операция и сколько переносов элементов она сделала
+struct OpStats {
+    int64_t calls = 0;
+    int64_t transfers = 0;
+};
+
+OpStats op_stats[static_cast<size_t>(Op::COUNT)];
+
+// Один прогон случайной последовательности операций над Vector и моделью
+// std::vector<int> из значений его элементов
+template <typename V>
+class Fuzzer {
+public:
+    using T = typename V::value_type;
+
+    explicit Fuzzer(uint64_t seed)
+        : rng_(seed)  //
+    {
+    }
+
+    size_t Failures() const {
+        return failures_;
+    }
+
+    void Run(size_t steps) {
+        for (context.step = 0; context.step < steps; ++context.step) {
+            Step();
+        }
+        v_.Clear();
+        Check(Counters::Alive() == 0, "elements leaked");
+    }
+
+private:
+    void Step() {
+        const Op op = static_cast<Op>(Random(static_cast<size_t>(Op::COUNT)));
+        context.op = OP_NAMES[static_cast<size_t>(op)];
+        if (Random(4) == 0) {
+            Counters::copy_throw_countdown = 1 + static_cast<int>(Random(3));
+            Counters::default_throw_countdown = 1 + static_cast<int>(Random(3));
+        }
+        expected_ = model_;
+        strong_ = true;
+        StartMeasure();
+        bool thrown = false;
+        try {
+            Apply(op);
+        } catch (const InjectedFailure&) {
+            thrown = true;
+            ++failures_;
+        }
+        Counters::copy_throw_countdown = 0;
+        Counters::default_throw_countdown = 0;
+        OpStats& stats = op_stats[static_cast<size_t>(op)];
+        ++stats.calls;
+        stats.transfers += Counters::Transfers() - measure_from_;
+
+        if (!thrown) {
+            model_.swap(expected_);
+        } else if (!strong_) {
+            // Базовая гарантия: вектор цел, но его содержимое может быть любым
+            model_.clear();
+            for (const T& element : v_) {
+                Check(element.value != MOVED_FROM, "moved-from element left after a failure");
+                model_.push_back(element.value);
+            }
+        }
+        CheckState();
+    }
+
+    void CheckState() {
+        Check(v_.Size() == model_.size(), "size differs from std::vector");
+        Check(v_.Capacity() >= v_.Size(), "capacity is less than size");
+        Check(Counters::Alive() == static_cast<int64_t>(v_.Size()), "alive elements differ from size");
+        for (size_t i = 0; i < model_.size(); ++i) {
+            v_[i].CheckAlive();
+            if (v_[i].value != model_[i]) {
+                Fail("element " + std::to_string(i) + " is " + std::to_string(v_[i].value) + ", expected "
+                     + std::to_string(model_[i]));
+            }
+        }
+    }
+
+    void Apply(Op op) {
+        switch (op) {
+            case Op::PUSH_BACK_COPY: {
+                const T local(NextValue());
+                const T& value = PickValue(local);
+                expected_.push_back(value.value);
+                v_.PushBack(value);
+                break;
+            }
+            case Op::PUSH_BACK_MOVE:
+                expected_.push_back(next_value_);
+                v_.PushBack(T(NextValue()));
+                break;
+            case Op::EMPLACE_BACK:
+                expected_.push_back(next_value_);
+                v_.EmplaceBack(NextValue());
+                break;
+            case Op::EMPLACE: {
+                const size_t pos = RandomPosition();
+                expected_.insert(expected_.begin() + pos, next_value_);
+                v_.Emplace(v_.begin() + pos, NextValue());
+                break;
+            }
+            case Op::INSERT_COPY: {
+                const T local(NextValue());
+                const T& value = PickValue(local);
+                const size_t pos = RandomPosition();
+                expected_.insert(expected_.begin() + pos, value.value);
+                v_.Insert(v_.begin() + pos, value);
+                break;
+            }
+            case Op::INSERT_COUNT: {
+                const T local(NextValue());
+                const T& value = PickValue(local);
+                const size_t pos = RandomPosition();
+                const size_t count = Random(6);
+                expected_.insert(expected_.begin() + pos, count, value.value);
+                v_.Insert(v_.begin() + pos, count, value);
+                break;
+            }
+            case Op::INSERT_RANGE: {
+                const std::vector<T> source = MakeSource(Random(9));
+                const size_t pos = RandomPosition();
+                const std::vector<int> values = Values(source);
+                expected_.insert(expected_.begin() + pos, values.begin(), values.end());
+                StartMeasure();
+                v_.Insert(v_.begin() + pos, source.begin(), source.end());
+                break;
+            }
+            case Op::INSERT_INPUT_RANGE: {
+                // Входные итераторы проходятся один раз, вставка идёт через
+                // EmplaceBack, поэтому гарантия только базовая
+                strong_ = false;
+                std::stringstream input;
+                const size_t count = Random(9);
+                const size_t pos = RandomPosition();
+                for (size_t i = 0; i < count; ++i) {
+                    expected_.insert(expected_.begin() + pos + i, next_value_);
+                    input << NextValue() << ' ';
+                }
+                v_.Insert(v_.begin() + pos, std::istream_iterator<int>(input), std::istream_iterator<int>());
+                break;
+            }
+            case Op::APPEND: {
+                const std::vector<T> source = MakeSource(Random(9));
+                for (const T& element : source) {
+                    expected_.push_back(element.value);
+                }
+                StartMeasure();
+                v_.Append(source.begin(), source.end());
+                break;
+            }
+            case Op::ERASE:
+                if (v_.Size() != 0) {
+                    const size_t pos = Random(v_.Size());
+                    expected_.erase(expected_.begin() + pos);
+                    v_.Erase(v_.begin() + pos);
+                }
+                break;
+            case Op::ERASE_RANGE: {
+                const size_t first = RandomPosition();
+                const size_t last = first + Random(v_.Size() - first + 1);
+                expected_.erase(expected_.begin() + first, expected_.begin() + last);
+                v_.Erase(v_.begin() + first, v_.begin() + last);
+                break;
+            }
+            case Op::ERASE_IF: {
+                const int divisor = 2 + static_cast<int>(Random(5));
+                const auto pred = [divisor](const auto& element) {
+                    return Value(element) % divisor == 0;
+                };
+                const size_t expected_count = expected_.size();
+                expected_.erase(std::remove_if(expected_.begin(), expected_.end(), pred), expected_.end());
+                Check(v_.EraseIf(pred) == expected_count - expected_.size(), "EraseIf returned a wrong count");
+                break;
+            }
+            case Op::POP_BACK:
+                if (v_.Size() != 0) {
+                    expected_.pop_back();
+                    v_.PopBack();
+                }
+                break;
+            case Op::RESIZE: {
+                // Изредка большой рост, чтобы реаллокация копировала много элементов
+                const size_t new_size = Random(8) == 0 ? Random(300) : Random(v_.Size() + 8);
+                expected_.resize(new_size);
+                v_.Resize(new_size);
+                break;
+            }
+            case Op::RESERVE:
+                v_.Reserve(Random(v_.Size() + 32));
+                break;
+            case Op::SHRINK_TO_FIT:
+                v_.ShrinkToFit();
+                // allocate_at_least может округлить ёмкость вверх
+                if constexpr (!detail::HasAllocateAtLeast<typename V::allocator_type>::value) {
+                    Check(v_.Capacity() == v_.Size(), "ShrinkToFit kept extra capacity");
+                }
+                break;
+            case Op::CLEAR:
+                if (Random(4) == 0) {
+                    expected_.clear();
+                    v_.Clear();
+                }
+                break;
+            case Op::COPY_ASSIGN: {
+                // Присваивание поверх живых элементов даёт только базовую гарантию
+                strong_ = false;
+                if (Random(8) == 0) {
+                    const V& self = v_;
+                    v_ = self;
+                } else {
+                    const V other = MakeVector(Random(v_.Size() + 8));
+                    expected_ = Values(other);
+                    StartMeasure();
+                    v_ = other;
+                }
+                break;
+            }
+            case Op::COPY_CONSTRUCT: {
+                V copy(v_);
+                Check(Values(copy) == Values(v_), "copy differs from the original");
+                v_ = std::move(copy);
+                break;
+            }
+            case Op::MOVE_ASSIGN: {
+                V other = MakeVector(Random(v_.Size() + 8));
+                expected_ = Values(other);
+                StartMeasure();
+                v_ = std::move(other);
+                Check(other.Size() == 0 || Values(other) == model_, "moved-from vector holds foreign elements");
+                break;
+            }
+            case Op::SWAP: {
+                V other = MakeVector(Random(v_.Size() + 8));
+                expected_ = Values(other);
+                StartMeasure();
+                v_.Swap(other);
+                Check(Values(other) == model_, "Swap lost elements");
+                break;
+            }
+            case Op::COUNT:
+                break;
+        }
+    }
+
+    // Переносы при подготовке аргументов не относятся к операции
+    void StartMeasure() {
+        measure_from_ = Counters::Transfers();
+    }
+
+    size_t Random(size_t bound) {
+        return bound == 0 ? 0 : rng_() % bound;
+    }
+
+    size_t RandomPosition() {
+        return Random(v_.Size() + 1);
+    }
+
+    int NextValue() {
+        return next_value_++;
+    }
+
+    // Элемент самого вектора или local, чтобы проверить вставку ссылки на свой элемент
+    const T& PickValue(const T& local) {
+        return v_.Size() != 0 && Random(3) == 0 ? v_[Random(v_.Size())] : local;
+    }
+
+    std::vector<T> MakeSource(size_t count) {
+        std::vector<T> source;
+        source.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            source.emplace_back(NextValue());
+        }
+        return source;
+    }
+
+    V MakeVector(size_t count) {
+        V result;
+        for (size_t i = 0; i < count; ++i) {
+            result.EmplaceBack(NextValue());
+        }
+        return result;
+    }
+
+    static int Value(int value) {
+        return value;
+    }
+
+    static int Value(const T& element) {
+        return element.value;
+    }
+
+    template <typename Container>
+    static std::vector<int> Values(const Container& container) {
+        std::vector<int> values;
+        for (const T& element : container) {
+            values.push_back(element.value);
+        }
+        return values;
+    }
+
+    std::mt19937_64 rng_;
+    V v_;
+    std::vector<int> model_;
+    // Модель после операции, если она не выбросит исключение
+    std::vector<int> expected_;
+    // Неудавшаяся операция должна оставить вектор как был
+    bool strong_ = true;
+    int64_t measure_from_ = 0;
+    size_t failures_ = 0;
+    // Значения 0 даёт конструктор по умолчанию, остальные уникальны
+    int next_value_ = 1;
+};
+
+template <typename V>
+void Fuzz(const char* config, uint64_t first_seed, size_t seeds, size_t steps) {
+    context.config = config;
+    size_t failures = 0;
+    for (uint64_t seed = first_seed; seed < first_seed + seeds; ++seed) {
+        context.seed = seed;
+        Counters::Reset();
+        Fuzzer<V> fuzzer(seed);
+        fuzzer.Run(steps);
+        failures += fuzzer.Failures();
+    }
+    std::cout << config << ": " << seeds << " x " << steps << " steps, " << failures << " injected failures"
+              << std::endl;
+}
+
+// Сколько элементов перенесёт вектор с политикой роста Growth при n
+// вставках в конец, если каждый раз переносит их ровно один раз
+template <typename Growth, typename T>
+int64_t GrowthRelocations(size_t n) {
+    int64_t relocations = 0;
+    size_t capacity = 0;
+    for (size_t size = 0; size < n; ++size) {
+        if (size == capacity) {
+            relocations += size;
+            capacity = Growth::NextCapacity(size, sizeof(T));
+        }
+    }
+    return relocations;
+}
+
+// Переносы элементов на одну вставку не должны превышать бюджет, который
+// выводится из числа реаллокаций и сдвигов. Рост отношения означает, что
+// оптимизация перемещения, роста или пакетной вставки перестала работать
+template <typename F>
+void CheckBudget(const char* name, size_t inserted, int64_t budget, F&& run) {
+    context = Context{"budget", 0, 0, name};
+    Counters::Reset();
+    run();
+    const int64_t transfers = Counters::Transfers();
+    std::cout << "  " << name << ": " << static_cast<double>(transfers) / inserted << " transfers per element, budget "
+              << static_cast<double>(budget) / inserted << std::endl;
+    if (transfers > budget) {
+        Fail(std::to_string(transfers) + " transfers for " + std::to_string(inserted) + " elements, budget "
+             + std::to_string(budget));
+    }
+    Check(Counters::Alive() == 0, "elements leaked");
+}
+
+void CheckBudgets() {
+    constexpr size_t N = 100'000;
+    using Nothrow = Tracked<MoveKind::NOTHROW>;
+    using Throwing = Tracked<MoveKind::THROWING>;
+    using Relocatable = Tracked<MoveKind::RELOCATABLE>;
+
+    std::cout << "Transfers per inserted element" << std::endl;
+    CheckBudget("PushBack(T&&), nothrow move", N, N + GrowthRelocations<DoublingGrowth, Nothrow>(N), [] {
+        Vector<Nothrow> v;
+        for (size_t i = 0; i < N; ++i) {
+            v.PushBack(Nothrow(static_cast<int>(i)));
+        }
+    });
+    CheckBudget("PushBack(T&&), throwing move", N, N + GrowthRelocations<DoublingGrowth, Throwing>(N), [] {
+        Vector<Throwing> v;
+        for (size_t i = 0; i < N; ++i) {
+            v.PushBack(Throwing(static_cast<int>(i)));
+        }
+    });
+    // Реаллокация переносит байты и не вызывает конструкторов
+    CheckBudget("PushBack(T&&), trivially relocatable", N, N, [] {
+        Vector<Relocatable> v;
+        for (size_t i = 0; i < N; ++i) {
+            v.PushBack(Relocatable(static_cast<int>(i)));
+        }
+    });
+    CheckBudget("EmplaceBack, OneAndHalfGrowth", N, GrowthRelocations<OneAndHalfGrowth, Nothrow>(N), [] {
+        Vector<Nothrow, std::allocator<Nothrow>, OneAndHalfGrowth> v;
+        for (size_t i = 0; i < N; ++i) {
+            v.EmplaceBack(static_cast<int>(i));
+        }
+    });
+    CheckBudget("EmplaceBack after Reserve", N, 0, [] {
+        Vector<Nothrow> v;
+        v.Reserve(N);
+        for (size_t i = 0; i < N; ++i) {
+            v.EmplaceBack(static_cast<int>(i));
+        }
+    });
+    CheckBudget("EmplaceBack, CachingAllocator", N, GrowthRelocations<DoublingGrowth, Nothrow>(N), [] {
+        Vector<Nothrow, CachingAllocator<Nothrow>> v;
+        for (size_t i = 0; i < N; ++i) {
+            v.EmplaceBack(static_cast<int>(i));
+        }
+    });
+
+    // Пакетная вставка в середину: каждый элемент источника копируется
+    // один раз, а старые элементы переносятся одним проходом
+    constexpr size_t M = 1'000;
+    const auto bulk_insert = [](auto tag, bool reserve) {
+        using T = decltype(tag);
+        Vector<T> v;
+        for (size_t i = 0; i < M; ++i) {
+            v.EmplaceBack(static_cast<int>(i));
+        }
+        if (reserve) {
+            v.Reserve(2 * M);
+        } else {
+            v.ShrinkToFit();
+        }
+        std::vector<T> source;
+        source.reserve(M);
+        for (size_t i = 0; i < M; ++i) {
+            source.emplace_back(static_cast<int>(i));
+        }
+        Counters::Reset();
+        v.Insert(v.begin() + M / 2, source.begin(), source.end());
+        return Counters::Transfers();
+    };
+    // Подготовка векторов не входит в замер, поэтому счётчики сбрасываются
+    // внутри, а сами объекты уничтожаются уже после проверки
+    const auto bulk_budget = [](const char* name, int64_t budget, auto measure) {
+        context.config = "budget";
+        context.op = name;
+        const int64_t transfers = measure();
+        std::cout << "  " << name << ": " << static_cast<double>(transfers) / M << " transfers per element, budget "
+                  << static_cast<double>(budget) / M << std::endl;
+        if (transfers > budget) {
+            Fail(std::to_string(transfers) + " transfers, budget " + std::to_string(budget));
+        }
+    };
+    bulk_budget("Insert(first, last) with reallocation", M + M, [&] {
+        return bulk_insert(Nothrow(), false);
+    });
+    bulk_budget("Insert(first, last) with copying relocation", M + M, [&] {
+        return bulk_insert(Throwing(), false);
+    });
+    bulk_budget("Insert(first, last) in place", M + M / 2, [&] {
+        return bulk_insert(Nothrow(), true);
+    });
+    bulk_budget("Insert(first, last) in place, trivially relocatable", M, [&] {
+        return bulk_insert(Relocatable(), true);
+    });
+
+    // Добавление в конец после Reserve ничего не сдвигает, поэтому даже тип
+    // с бросающим перемещением копирует только новые элементы
+    constexpr size_t APPENDS = 1'000;
+    constexpr size_t CHUNK = 10;
+    CheckBudget("Append after Reserve, throwing move", APPENDS * CHUNK, APPENDS * CHUNK, [] {
+        std::vector<Throwing> source;
+        source.reserve(CHUNK);
+        for (size_t i = 0; i < CHUNK; ++i) {
+            source.emplace_back(static_cast<int>(i));
+        }
+        Vector<Throwing> v;
+        v.Reserve(APPENDS * CHUNK);
+        for (size_t i = 0; i < APPENDS; ++i) {
+            v.Append(source.begin(), source.end());
+        }
+    });
+    CheckBudget("Insert(end(), count, value) after Reserve, throwing move", APPENDS * CHUNK, APPENDS * CHUNK + APPENDS,
+        [] {
+            const Throwing value(1);
+            Vector<Throwing> v;
+            v.Reserve(APPENDS * CHUNK);
+            for (size_t i = 0; i < APPENDS; ++i) {
+                v.Insert(v.end(), CHUNK, value);
+            }
+        });
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t steps = argc > 1 ? std::stoul(argv[1]) : 10'000;
+    const bool single_seed = argc > 2;
+    const uint64_t first_seed = single_seed ? std::stoull(argv[2]) : 1;
+    const size_t seeds = single_seed ? 1 : 8;
+
+    Fuzz<Vector<Tracked<MoveKind::NOTHROW>>>("nothrow move", first_seed, seeds, steps);
+    Fuzz<Vector<Tracked<MoveKind::THROWING>>>("throwing move", first_seed, seeds, steps);
+    Fuzz<Vector<Tracked<MoveKind::RELOCATABLE>>>("trivially relocatable", first_seed, seeds, steps);
+    Fuzz<Vector<Tracked<MoveKind::RELOCATABLE>, MallocAllocator<Tracked<MoveKind::RELOCATABLE>>>>(
+        "realloc", first_seed, seeds, steps);
+    Fuzz<Vector<Tracked<MoveKind::THROWING>, CachingAllocator<Tracked<MoveKind::THROWING>>, OneAndHalfGrowth>>(
+        "caching allocator, 1.5 growth", first_seed, seeds, steps);
+
+    std::cout << "Transfers per call" << std::endl;
+    for (size_t i = 0; i < static_cast<size_t>(Op::COUNT); ++i) {
+        const OpStats& stats = op_stats[i];
+        std::cout << "  " << OP_NAMES[i] << ": "
+                  << (stats.calls == 0 ? 0.0 : static_cast<double>(stats.transfers) / stats.calls) << std::endl;
+    }
+    CheckBudgets();
+    std::cout << "OK" << std::endl;
+}
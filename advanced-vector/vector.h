@@ -1,16 +1,256 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
 #include <new>
+#include <thread>
+#include <type_traits>
 #include <utility>
 #include <memory>
 
+#include <map>
+#include <string>
+#include <system_error>
+
+#ifdef VECTOR_ENABLE_STATS
+#include <atomic>
+#include <mutex>
+#endif
+
+// Types whose objects may be moved to a new address with a plain byte copy,
+// without running the move constructor and the source destructor.
+// Specialize for handle-like types that are not trivially copyable.
+template <typename T>
+struct IsTriviallyRelocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+struct IsTriviallyRelocatable<std::unique_ptr<T>> : std::true_type {};
+
+namespace detail {
+
+template <typename Alloc, typename = void>
+struct HasReallocate : std::false_type {};
+
+template <typename Alloc>
+struct HasReallocate<Alloc, std::void_t<decltype(std::declval<Alloc&>().reallocate(
+    std::declval<typename Alloc::value_type*>(), size_t{}, size_t{}))>> : std::true_type {};
+
+template <typename Alloc, typename = void>
+struct HasExpand : std::false_type {};
+
+template <typename Alloc>
+struct HasExpand<Alloc, std::void_t<decltype(std::declval<Alloc&>().expand(
+    std::declval<typename Alloc::value_type*>(), size_t{}, size_t{}))>> : std::true_type {};
+
+// Relocating objects of T cannot throw: they are byte-copied or moved by a
+// nothrow move constructor
+template <typename T>
+inline constexpr bool kNothrowRelocate = IsTriviallyRelocatable<T>::value ||
+    std::is_nothrow_move_constructible_v<T>;
+
+// Moves count objects from one uninitialized location to another and ends
+// the lifetime of the originals. Same choice as Reserve makes: move if that
+// cannot throw or if T is move-only, copy otherwise. If that throws the
+// originals stay alive, moved-from ones only for a move-only T
+template <typename T>
+void Relocate(T* from, size_t count, T* to) noexcept(kNothrowRelocate<T>)
+{
+    if constexpr (IsTriviallyRelocatable<T>::value)
+    {
+        if (count != 0)
+        {
+            std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
+        }
+        return;
+    }
+    else if constexpr (std::is_nothrow_move_constructible_v<T> ||
+        !std::is_copy_constructible_v<T>)
+    {
+        std::uninitialized_move_n(from, count, to);
+    }
+    else
+    {
+        std::uninitialized_copy_n(from, count, to);
+    }
+    std::destroy_n(from, count);
+}
+
+// Builds count objects at to from the ones at from and leaves the originals
+// alive: moves a move-only T, copies otherwise. The fallback of a relocation
+// that may throw, so the originals are destroyed only once all are built
+template <typename T>
+void UninitializedCopyOrMoveN(T* from, size_t count, T* to)
+{
+    if constexpr (std::is_copy_constructible_v<T>)
+    {
+        std::uninitialized_copy_n(from, count, to);
+    }
+    else
+    {
+        std::uninitialized_move_n(from, count, to);
+    }
+}
+
+// Objects of T can be shifted inside one buffer without any chance to fail halfway
+template <typename T>
+inline constexpr bool kNothrowShift = kNothrowRelocate<T>;
+
+// Relocates count objects to a possibly overlapping location in the same buffer
+template <typename T>
+void RelocateOverlapping(T* from, size_t count, T* to) noexcept
+{
+    static_assert(kNothrowShift<T>);
+    if constexpr (IsTriviallyRelocatable<T>::value)
+    {
+        if (count != 0)
+        {
+            std::memmove(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
+        }
+    }
+    else if (to < from)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            new (to + i) T(std::move(from[i]));
+            std::destroy_at(from + i);
+        }
+    }
+    else
+    {
+        for (size_t i = count; i-- > 0;)
+        {
+            new (to + i) T(std::move(from[i]));
+            std::destroy_at(from + i);
+        }
+    }
+}
+
+template <typename It>
+using IteratorCategory = typename std::iterator_traits<It>::iterator_category;
+
+template <typename It, typename = void>
+struct IsIterator : std::false_type {};
+
+template <typename It>
+struct IsIterator<It, std::void_t<IteratorCategory<It>>> : std::true_type {};
+
+template <typename It>
+inline constexpr bool kIsForwardIterator =
+    std::is_base_of_v<std::forward_iterator_tag, IteratorCategory<It>>;
+
+}  // namespace detail
+
+// Result of allocate_at_least, which allocators may provide instead of
+// allocate to hand out the slack of a block as extra capacity
+template <typename Pointer>
+struct AllocationResult {
+    Pointer ptr;
+    size_t count;
+};
+
+namespace detail {
+
+template <typename Alloc, typename = void>
+struct HasAllocateAtLeast : std::false_type {};
+
+template <typename Alloc>
+struct HasAllocateAtLeast<Alloc, std::void_t<decltype(std::declval<Alloc&>().allocate_at_least(size_t{}))>>
+    : std::true_type {};
+
+}  // namespace detail
+
+// Allocator on top of malloc/realloc. Buffers of trivially relocatable
+// elements are grown with realloc, which can extend the block in place or
+// remap its pages instead of copying the data.
+template <typename T>
+struct MallocAllocator {
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    static_assert(alignof(T) <= alignof(std::max_align_t), "malloc cannot satisfy alignment of T");
+
+    MallocAllocator() = default;
+    template <typename U>
+    MallocAllocator(const MallocAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n);
+    void deallocate(T* p, size_t n) noexcept;
+    T* reallocate(T* p, size_t old_n, size_t new_n);
+
+    friend bool operator==(const MallocAllocator&, const MallocAllocator&) noexcept { return true; }
+    friend bool operator!=(const MallocAllocator&, const MallocAllocator&) noexcept { return false; }
+};
+
+// Over-aligned allocator for buffers fed to SIMD kernels: begin() of a
+// vector is aligned to Alignment bytes. With PadCapacity every capacity is
+// rounded up to a whole number of Alignment-byte blocks, so kernels may
+// process the last partial block without a scalar tail loop
+template <typename T, size_t Alignment, bool PadCapacity = true>
+struct AlignedAllocator {
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0,
+        "Alignment must be a power of two not less than alignof(T)");
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment, PadCapacity>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment, PadCapacity>&) noexcept {}
+
+    T* allocate(size_t n);
+    AllocationResult<T*> allocate_at_least(size_t n);
+    void deallocate(T* p, size_t n) noexcept;
+
+    static constexpr size_t PaddedCount(size_t n) noexcept;
+
+    friend bool operator==(const AlignedAllocator&, const AlignedAllocator&) noexcept { return true; }
+    friend bool operator!=(const AlignedAllocator&, const AlignedAllocator&) noexcept { return false; }
+};
+
+// Frees a buffer of capacity elements that was not allocated by the
+// vector's allocator. The elements are already destroyed when it is called
+template <typename T>
+using BufferDeleter = std::function<void(T* buffer, size_t capacity)>;
+
+// Ownership of a buffer taken out of a Vector by Release(). The first size
+// elements are alive, the new owner destroys them and calls deleter
 template <typename T>
+struct ReleasedBuffer {
+    T* data = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+    BufferDeleter<T> deleter;
+};
+
+template <typename T, typename Alloc = std::allocator<T>>
 class RawMemory {
 public:
+    using allocator_type = Alloc;
+
+    // The allocator can resize a block itself, moving its bytes if needed
+    static constexpr bool kHasReallocate = detail::HasReallocate<Alloc>::value;
+
+    static_assert(std::is_same_v<typename std::allocator_traits<Alloc>::value_type, T>,
+        "Alloc::value_type must be T");
+
     RawMemory() = default;
-    explicit RawMemory(size_t capacity);
+    explicit RawMemory(const Alloc& alloc) noexcept;
+    explicit RawMemory(size_t capacity, const Alloc& alloc = Alloc());
+    // Takes ownership of a buffer that deleter frees
+    RawMemory(T* buffer, size_t capacity, BufferDeleter<T> deleter, const Alloc& alloc = Alloc());
     RawMemory(const RawMemory&) = delete;
     RawMemory& operator=(const RawMemory& rhs) = delete;
     RawMemory(RawMemory&& other) noexcept;
@@ -25,27 +265,357 @@ public:
     const T* GetAddress() const noexcept;
     T* GetAddress() noexcept;
     size_t Capacity() const;
+    const Alloc& GetAllocator() const noexcept;
+    // The buffer came from outside and is freed by its own deleter
+    bool IsAdopted() const noexcept;
+    // Gives up the buffer and returns the deleter that frees it. Leaves the memory empty
+    BufferDeleter<T> Release();
+    // Grows the block without moving it. Returns false if that is not possible
+    bool TryExpand(size_t new_capacity) noexcept;
+    // Grows the block, moving the first used elements bytewise if the allocator has to.
+    // Only for trivially relocatable T
+    void Reallocate(size_t new_capacity, size_t used);
 private:
-    static T* Allocate(size_t n);
-    static void Deallocate(T* buf) noexcept;
+    using AllocTraits = std::allocator_traits<Alloc>;
+
+    // Allocates at least n elements, n receives the real capacity
+    T* Allocate(size_t& n);
+    void Deallocate(T* buf, size_t n) noexcept;
 
+    Alloc alloc_;
     T* buffer_ = nullptr;
     size_t capacity_ = 0;
+    // Set only for adopted buffers, so a regular block pays one pointer
+    std::unique_ptr<BufferDeleter<T>> deleter_;
+};
+
+// Tag for constructors and resizes that default-initialize new elements,
+// leaving trivial types with indeterminate values instead of zeroing them
+struct default_init_t {
+    explicit default_init_t() = default;
 };
 
+inline constexpr default_init_t default_init{};
+
+// Opt-in parallelism for constructing, copying and destroying large ranges.
+// Every chunk runs on its own thread, the calling thread takes the first one
+struct ParallelPolicy {
+    // 0 means std::thread::hardware_concurrency()
+    size_t threads = 0;
+    // Ranges of fewer elements are processed on the calling thread
+    size_t threshold = size_t{1} << 16;
+};
+
+namespace detail {
+
+inline size_t ParallelChunkCount(size_t count, const ParallelPolicy& policy) noexcept
+{
+    if (count < policy.threshold || count < 2)
+    {
+        return 1;
+    }
+    const size_t threads = policy.threads != 0 ? policy.threads : std::thread::hardware_concurrency();
+    return std::clamp<size_t>(threads, 1, count);
+}
+
+// Calls f(first, last) for chunks covering [0, count) concurrently. If some
+// chunks throw, undo(first, last) is called for every chunk that succeeded
+// and the first exception is rethrown
+template <typename F, typename Undo>
+void ParallelFor(size_t count, const ParallelPolicy& policy, F f, Undo undo)
+{
+    const size_t chunks = ParallelChunkCount(count, policy);
+    if (chunks == 1)
+    {
+        f(size_t{0}, count);
+        return;
+    }
+    const size_t chunk_size = (count + chunks - 1) / chunks;
+    const auto bounds = [&](size_t chunk) {
+        return std::pair{std::min(count, chunk * chunk_size), std::min(count, (chunk + 1) * chunk_size)};
+    };
+    auto errors = std::make_unique<std::exception_ptr[]>(chunks);
+    auto threads = std::make_unique<std::thread[]>(chunks - 1);
+    const auto run = [&](size_t chunk) noexcept {
+        try
+        {
+            const auto [first, last] = bounds(chunk);
+            f(first, last);
+        }
+        catch (...)
+        {
+            errors[chunk] = std::current_exception();
+        }
+    };
+    for (size_t chunk = 1; chunk < chunks; ++chunk)
+    {
+        try
+        {
+            threads[chunk - 1] = std::thread(run, chunk);
+        }
+        catch (...)
+        {
+            // Out of threads or of memory for the thread state: do the chunk
+            // here, so no exception leaves while started threads still run
+            run(chunk);
+        }
+    }
+    run(0);
+    for (size_t i = 0; i + 1 < chunks; ++i)
+    {
+        if (threads[i].joinable())
+        {
+            threads[i].join();
+        }
+    }
+    std::exception_ptr error;
+    for (size_t chunk = 0; chunk < chunks; ++chunk)
+    {
+        if (errors[chunk] && !error)
+        {
+            error = errors[chunk];
+        }
+    }
+    if (error)
+    {
+        for (size_t chunk = 0; chunk < chunks; ++chunk)
+        {
+            if (!errors[chunk])
+            {
+                const auto [first, last] = bounds(chunk);
+                undo(first, last);
+            }
+        }
+        std::rethrow_exception(error);
+    }
+}
+
+// Constructs count elements at data with construct(T* first, size_t index, size_t n).
+// Either all of them are alive afterwards or none
+template <typename T, typename Construct>
+void ParallelConstruct(T* data, size_t count, const ParallelPolicy& policy, Construct construct)
+{
+    ParallelFor(count, policy,
+        [data, &construct](size_t first, size_t last) {
+            construct(data + first, first, last - first);
+        },
+        [data](size_t first, size_t last) noexcept {
+            std::destroy_n(data + first, last - first);
+        });
+}
+
+template <typename T>
+void ParallelDestroy(T* data, size_t count, const ParallelPolicy& policy) noexcept
+{
+    if constexpr (!std::is_trivially_destructible_v<T>)
+    {
+        const auto destroy = [data](size_t first, size_t last) noexcept {
+            std::destroy_n(data + first, last - first);
+        };
+        try
+        {
+            ParallelFor(count, policy, destroy, [](size_t, size_t) noexcept {});
+        }
+        catch (...)
+        {
+            // Could not allocate the bookkeeping, nothing is destroyed yet
+            destroy(0, count);
+        }
+    }
+}
+
+// Relocate for nothrow-movable T, each thread moving and destroying its own chunk
 template <typename T>
+void ParallelRelocate(T* from, size_t count, T* to, const ParallelPolicy& policy) noexcept
+{
+    static_assert(std::is_nothrow_move_constructible_v<T>);
+    const auto relocate = [from, to](size_t first, size_t last) noexcept {
+        std::uninitialized_move_n(from + first, last - first, to + first);
+        std::destroy_n(from + first, last - first);
+    };
+    try
+    {
+        ParallelFor(count, policy, relocate, [](size_t, size_t) noexcept {});
+    }
+    catch (...)
+    {
+        // Could not allocate the bookkeeping, nothing is moved yet
+        relocate(0, count);
+    }
+}
+
+template <typename Growth, typename = void>
+struct HasRelocationPolicy : std::false_type {};
+
+template <typename Growth>
+struct HasRelocationPolicy<Growth, std::void_t<decltype(Growth::kRelocationPolicy)>> : std::true_type {};
+
+}  // namespace detail
+
+// Allocation and relocation counters of the vectors sharing one tag.
+// They are collected only when VECTOR_ENABLE_STATS is defined,
+// otherwise every hook compiles to nothing
+struct VectorStats {
+    uint64_t allocations = 0;
+    uint64_t bytes_allocated = 0;
+    // Growth or shrink steps, including the ones done in place
+    uint64_t reallocations = 0;
+    uint64_t relocated_bitwise = 0;
+    uint64_t relocated_by_move = 0;
+    // Elements copied because their move constructor may throw
+    uint64_t relocated_by_copy = 0;
+    uint64_t peak_capacity_bytes = 0;
+};
+
+namespace detail {
+
+#ifdef VECTOR_ENABLE_STATS
+struct VectorStatsCounters {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> bytes_allocated{0};
+    std::atomic<uint64_t> reallocations{0};
+    std::atomic<uint64_t> relocated_bitwise{0};
+    std::atomic<uint64_t> relocated_by_move{0};
+    std::atomic<uint64_t> relocated_by_copy{0};
+    std::atomic<uint64_t> peak_capacity_bytes{0};
+
+    void UpdatePeak(uint64_t bytes) noexcept
+    {
+        uint64_t peak = peak_capacity_bytes.load(std::memory_order_relaxed);
+        while (peak < bytes && !peak_capacity_bytes.compare_exchange_weak(peak, bytes, std::memory_order_relaxed))
+        {
+        }
+    }
+};
+
+struct VectorStatsRegistry {
+    std::mutex mutex;
+    // Counters are never removed, so pointers to them stay valid
+    std::map<std::string, VectorStatsCounters, std::less<>> counters;
+};
+
+inline VectorStatsRegistry& GetVectorStatsRegistry()
+{
+    static VectorStatsRegistry registry;
+    return registry;
+}
+
+inline VectorStatsCounters& GetVectorStatsCounters(const char* tag)
+{
+    VectorStatsRegistry& registry = GetVectorStatsRegistry();
+    std::lock_guard lock(registry.mutex);
+    return registry.counters.try_emplace(tag).first->second;
+}
+
+inline VectorStatsCounters& GetUntaggedVectorStatsCounters()
+{
+    static VectorStatsCounters& counters = GetVectorStatsCounters("untagged");
+    return counters;
+}
+#endif
+
+}  // namespace detail
+
+// Returns the counters of every tag. Empty unless VECTOR_ENABLE_STATS is defined
+inline std::map<std::string, VectorStats> GetVectorStatsSnapshot();
+
+inline void ResetVectorStats();
+
+// Attributes a vector to the place in the code that calls it
+#define VECTOR_STATS_STRINGIFY_IMPL(x) #x
+#define VECTOR_STATS_STRINGIFY(x) VECTOR_STATS_STRINGIFY_IMPL(x)
+#define VECTOR_STATS_TAG_HERE(v) (v).SetStatsTag(__FILE__ ":" VECTOR_STATS_STRINGIFY(__LINE__))
+
+// Growth policies compute the capacity a full vector of size elements
+// grows to. The result must be greater than size.
+struct DoublingGrowth {
+    static constexpr size_t NextCapacity(size_t size, size_t /*element_size*/) noexcept
+    {
+        return size == 0 ? 1 : size * 2;
+    }
+};
+
+struct OneAndHalfGrowth {
+    static constexpr size_t NextCapacity(size_t size, size_t /*element_size*/) noexcept
+    {
+        return size < 2 ? size + 1 : size + size / 2;
+    }
+};
+
+// Starts from a whole cache line worth of elements instead of one
+template <typename Base = DoublingGrowth, size_t LineSize = 64>
+struct CacheLineGrowth {
+    static constexpr size_t NextCapacity(size_t size, size_t element_size) noexcept
+    {
+        const size_t min_capacity = std::max<size_t>(1, LineSize / element_size);
+        return std::max(min_capacity, Base::NextCapacity(size, element_size));
+    }
+};
+
+// Grows like Base and relocates vectors of at least Threshold nothrow-movable
+// elements on Threads threads (0 for all cores) when they move to a new block.
+// Trivially relocatable elements are copied bytewise on one thread as usual
+template <typename Base = DoublingGrowth, size_t Threshold = size_t{1} << 20, size_t Threads = 0>
+struct ParallelRelocation : Base {
+    static constexpr ParallelPolicy kRelocationPolicy{Threads, Threshold};
+};
+
+// Rounds the capacity up so the block fills a whole jemalloc size class:
+// multiples of 16 bytes up to 128, then four classes per power of two
+template <typename Base = DoublingGrowth>
+struct SizeClassGrowth {
+    static constexpr size_t NextCapacity(size_t size, size_t element_size) noexcept
+    {
+        const size_t capacity = Base::NextCapacity(size, element_size);
+        return RoundToSizeClass(capacity * element_size) / element_size;
+    }
+
+    static constexpr size_t RoundToSizeClass(size_t bytes) noexcept
+    {
+        if (bytes <= 8)
+        {
+            return 8;
+        }
+        if (bytes <= 128)
+        {
+            return (bytes + 15) / 16 * 16;
+        }
+        size_t group = 128;
+        while (group * 2 < bytes)
+        {
+            group *= 2;
+        }
+        const size_t step = group / 4;
+        return (bytes + step - 1) / step * step;
+    }
+};
+
+template <typename T, typename Alloc = std::allocator<T>, typename Growth = DoublingGrowth>
 class Vector
 {
 public:
+    using value_type = T;
     using iterator = T*;
     using const_iterator = const T*;
+    using allocator_type = Alloc;
+    using growth_policy = Growth;
 
     Vector() = default;
-    explicit Vector(size_t size);
+    explicit Vector(const Alloc& alloc) noexcept;
+    explicit Vector(size_t size, const Alloc& alloc = Alloc());
+    Vector(size_t size, default_init_t, const Alloc& alloc = Alloc());
+    template <typename InputIt, typename = std::enable_if_t<detail::IsIterator<InputIt>::value>>
+    Vector(InputIt first, InputIt last, const Alloc& alloc = Alloc());
+    Vector(std::initializer_list<T> init, const Alloc& alloc = Alloc());
     Vector(const Vector& other);
+    // Parallel versions for large vectors, see ParallelPolicy
+    Vector(size_t size, const ParallelPolicy& policy, const Alloc& alloc = Alloc());
+    Vector(const Vector& other, const ParallelPolicy& policy);
     Vector& operator=(const Vector& rhs);
     Vector(Vector&& other) noexcept;
-    Vector& operator=(Vector&& rhs) noexcept;
+    Vector& operator=(Vector&& rhs) noexcept(
+        std::allocator_traits<Alloc>::propagate_on_container_move_assignment::value ||
+        std::allocator_traits<Alloc>::is_always_equal::value);
     ~Vector();
 
     iterator begin() noexcept;
@@ -57,11 +627,131 @@ public:
 
     size_t Size() const noexcept;
     size_t Capacity() const noexcept;
+    allocator_type GetAllocator() const noexcept;
     void Reserve(size_t new_capacity);
+    // Reallocate to max(new_capacity, Size()) if that is smaller than the
+    // current capacity. Return the number of bytes given back
+    size_t ShrinkTo(size_t new_capacity);
+    size_t ShrinkToFit();
+    // Destroys all elements but keeps the capacity
+    void Clear() noexcept;
+    void Clear(const ParallelPolicy& policy) noexcept;
+    // Copy assignment with chunks of the copy done in parallel
+    void Assign(const Vector& rhs, const ParallelPolicy& policy);
+    // Replaces the contents with the size alive elements of a buffer of
+    // capacity elements without copying them. deleter frees the buffer once
+    // the vector is done with it, including when it grows into a new block
+    void Adopt(T* data, size_t size, size_t capacity, BufferDeleter<T> deleter);
+    // Hands the buffer and its elements over to the caller and leaves the vector empty
+    ReleasedBuffer<T> Release();
+    // Counts the allocations of this vector under tag, see VectorStats
+    void SetStatsTag(const char* tag);
     const T& operator[](size_t index) const noexcept;
     T& operator[](size_t index) noexcept;
     void Swap(Vector& other) noexcept;
     void Resize(size_t new_size);
+    void ResizeDefaultInit(size_t new_size);
+    template<typename F>
+    void PushBack(F&& value);
+    void PopBack() noexcept;
+    template<typename... Ts>
+    T& EmplaceBack(Ts&&... vs);
+    template <typename... Ts>
+    iterator Emplace(const_iterator pos, Ts&&... vs);
+    template<typename F>
+    iterator Insert(const_iterator pos, F&& value);
+    iterator Insert(const_iterator pos, size_t count, const T& value);
+    template <typename InputIt, typename = std::enable_if_t<detail::IsIterator<InputIt>::value>>
+    iterator Insert(const_iterator pos, InputIt first, InputIt last);
+    iterator Insert(const_iterator pos, std::initializer_list<T> init);
+    template <typename InputIt, typename = std::enable_if_t<detail::IsIterator<InputIt>::value>>
+    void Append(InputIt first, InputIt last);
+    iterator Erase(const_iterator pos) noexcept(std::is_nothrow_move_assignable_v<T>);
+    iterator Erase(const_iterator first, const_iterator last) noexcept(std::is_nothrow_move_assignable_v<T>);
+    // Removes all elements satisfying pred in a single pass and returns their count
+    template <typename Pred>
+    size_t EraseIf(Pred pred);
+
+private:
+    using AllocTraits = std::allocator_traits<Alloc>;
+
+    static constexpr bool kNothrowRelocate = detail::kNothrowRelocate<T>;
+
+    static constexpr bool kReallocate = IsTriviallyRelocatable<T>::value &&
+        RawMemory<T, Alloc>::kHasReallocate;
+
+    static constexpr bool kParallelRelocate = detail::HasRelocationPolicy<Growth>::value &&
+        !IsTriviallyRelocatable<T>::value && std::is_nothrow_move_constructible_v<T>;
+
+    // detail::Relocate, spread over threads if the growth policy asks for it
+    static void Relocate(T* from, size_t count, T* to) noexcept(kNothrowRelocate);
+
+    size_t NextCapacity() const noexcept;
+    bool TryExpand(size_t new_capacity) noexcept;
+    // Moves the elements to a block of exactly new_capacity elements
+    void ReallocateTo(size_t new_capacity);
+    void RecordCapacity(size_t capacity, bool new_block) const noexcept;
+    // Counts a move of count elements out of a block of old_capacity
+    void RecordRelocation(size_t old_capacity, size_t count) const noexcept;
+    template <typename InputIt>
+    void Assign(InputIt first, size_t count);
+    // Makes room for count elements at pos_index with a single tail shift
+    // or reallocation and constructs them with init(T* first_uninitialized)
+    template <typename Init>
+    iterator InsertUninitialized(size_t pos_index, size_t count, Init&& init);
+    // Moves the elements to new_data leaving count uninitialized slots at pos_index.
+    // If that throws the vector keeps all its elements, see detail::Relocate
+    void RelocateAround(RawMemory<T, Alloc>& new_data, size_t pos_index, size_t count) noexcept(kNothrowRelocate);
+
+    RawMemory<T, Alloc> data_;
+    size_t size_ = 0;
+#ifdef VECTOR_ENABLE_STATS
+    detail::VectorStatsCounters* stats_ = &detail::GetUntaggedVectorStatsCounters();
+#endif
+};
+
+// Vector that keeps up to N elements in an inline buffer and moves them to
+// a RawMemory block only when it outgrows it. Once on the heap it stays
+// there, like Vector never shrinks its capacity
+template <typename T, size_t N, typename Alloc = std::allocator<T>, typename Growth = DoublingGrowth>
+class SmallVector
+{
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using allocator_type = Alloc;
+    using growth_policy = Growth;
+
+    static_assert(N > 0, "use Vector for no inline storage");
+
+    SmallVector() = default;
+    explicit SmallVector(const Alloc& alloc) noexcept;
+    explicit SmallVector(size_t size, const Alloc& alloc = Alloc());
+    SmallVector(const SmallVector& other);
+    SmallVector& operator=(const SmallVector& rhs);
+    SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>);
+    SmallVector& operator=(SmallVector&& rhs) noexcept(std::is_nothrow_move_constructible_v<T> &&
+        std::is_nothrow_swappable_v<T>);
+    ~SmallVector();
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+    const_iterator cbegin() const noexcept;
+    const_iterator cend() const noexcept;
+
+    size_t Size() const noexcept;
+    size_t Capacity() const noexcept;
+    bool IsInline() const noexcept;
+    allocator_type GetAllocator() const noexcept;
+    void Reserve(size_t new_capacity);
+    const T& operator[](size_t index) const noexcept;
+    T& operator[](size_t index) noexcept;
+    void Swap(SmallVector& other) noexcept(std::is_nothrow_move_constructible_v<T> &&
+        std::is_nothrow_swappable_v<T>);
+    void Resize(size_t new_size);
     template<typename F>
     void PushBack(F&& value);
     void PopBack() noexcept;
@@ -73,325 +763,1434 @@ public:
     iterator Insert(const_iterator pos, F&& value);
     iterator Erase(const_iterator pos) noexcept(std::is_nothrow_move_assignable_v<T>);
 
-private:
-    RawMemory<T> data_;
-    size_t size_ = 0;
-};
+private:
+    static constexpr bool kNothrowRelocate = detail::kNothrowRelocate<T>;
+
+    T* Data() noexcept;
+    const T* Data() const noexcept;
+    size_t NextCapacity() const noexcept;
+    // Moves the elements of an inline vector into the inline buffer of other,
+    // which must be empty
+    void MoveInlineTo(SmallVector& other) noexcept(std::is_nothrow_move_constructible_v<T>);
+
+    alignas(T) unsigned char inline_[N * sizeof(T)];
+    RawMemory<T, Alloc> heap_;
+    size_t size_ = 0;
+};
+
+template<typename T, typename Alloc>
+RawMemory<T, Alloc>::RawMemory(const Alloc& alloc) noexcept
+    : alloc_(alloc)
+{
+}
+
+template<typename T, typename Alloc>
+RawMemory<T, Alloc>::RawMemory(size_t capacity, const Alloc& alloc)
+    : alloc_(alloc)
+{
+    buffer_ = Allocate(capacity);
+    capacity_ = capacity;
+}
+
+template<typename T, typename Alloc>
+RawMemory<T, Alloc>::RawMemory(T* buffer, size_t capacity, BufferDeleter<T> deleter, const Alloc& alloc)
+    : alloc_(alloc)
+    , deleter_(std::make_unique<BufferDeleter<T>>(std::move(deleter)))
+{
+    assert(*deleter_ && (buffer != nullptr || capacity == 0));
+    buffer_ = buffer;
+    capacity_ = capacity;
+}
+
+template<typename T, typename Alloc>
+RawMemory<T, Alloc>::RawMemory(RawMemory&& other) noexcept
+    : alloc_(other.alloc_)
+    , buffer_(std::exchange(other.buffer_, nullptr))
+    , capacity_(std::exchange(other.capacity_, 0))
+    , deleter_(std::move(other.deleter_))
+{
+}
+
+template<typename T, typename Alloc>
+RawMemory<T, Alloc>& RawMemory<T, Alloc>::operator=(RawMemory&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        RawMemory rhs_move(std::move(rhs));
+        Swap(rhs_move);
+    }
+    return *this;
+}
+
+template<typename T, typename Alloc>
+RawMemory<T, Alloc>::~RawMemory()
+{
+    Deallocate(buffer_, capacity_);
+}
+
+template<typename T, typename Alloc>
+T* RawMemory<T, Alloc>::operator+(size_t offset) noexcept
+{
+    assert(offset <= capacity_);
+    return buffer_ + offset;
+}
+
+template<typename T, typename Alloc>
+const T* RawMemory<T, Alloc>::operator+(size_t offset) const noexcept
+{
+    return const_cast<RawMemory&>(*this) + offset;
+}
+
+template<typename T, typename Alloc>
+const T& RawMemory<T, Alloc>::operator[](size_t index) const noexcept
+{
+    return const_cast<RawMemory&>(*this)[index];
+}
+
+template<typename T, typename Alloc>
+T& RawMemory<T, Alloc>::operator[](size_t index) noexcept
+{
+    assert(index < capacity_);
+    return buffer_[index];
+}
+
+template<typename T, typename Alloc>
+void RawMemory<T, Alloc>::Swap(RawMemory& other) noexcept
+{
+    using std::swap;
+    swap(alloc_, other.alloc_);
+    swap(buffer_, other.buffer_);
+    swap(capacity_, other.capacity_);
+    swap(deleter_, other.deleter_);
+}
+
+template<typename T, typename Alloc>
+const T* RawMemory<T, Alloc>::GetAddress() const noexcept
+{
+    return buffer_;
+}
+
+template<typename T, typename Alloc>
+T* RawMemory<T, Alloc>::GetAddress() noexcept
+{
+    return buffer_;
+}
+
+template<typename T, typename Alloc>
+size_t RawMemory<T, Alloc>::Capacity() const
+{
+    return capacity_;
+}
+
+template<typename T, typename Alloc>
+const Alloc& RawMemory<T, Alloc>::GetAllocator() const noexcept
+{
+    return alloc_;
+}
+
+template<typename T, typename Alloc>
+bool RawMemory<T, Alloc>::IsAdopted() const noexcept
+{
+    return deleter_ != nullptr;
+}
+
+template<typename T, typename Alloc>
+BufferDeleter<T> RawMemory<T, Alloc>::Release()
+{
+    BufferDeleter<T> deleter;
+    if (deleter_ != nullptr)
+    {
+        deleter = std::move(*deleter_);
+    }
+    else if (buffer_ != nullptr)
+    {
+        deleter = [alloc = alloc_](T* buffer, size_t capacity) mutable {
+            AllocTraits::deallocate(alloc, buffer, capacity);
+        };
+    }
+    buffer_ = nullptr;
+    capacity_ = 0;
+    deleter_.reset();
+    return deleter;
+}
+
+template<typename T, typename Alloc>
+T* RawMemory<T, Alloc>::Allocate(size_t& n)
+{
+    if (n == 0)
+    {
+        return nullptr;
+    }
+    if constexpr (detail::HasAllocateAtLeast<Alloc>::value)
+    {
+        const auto [ptr, count] = alloc_.allocate_at_least(n);
+        assert(count >= n);
+        n = count;
+        return ptr;
+    }
+    else
+    {
+        return AllocTraits::allocate(alloc_, n);
+    }
+}
+
+template<typename T, typename Alloc>
+void RawMemory<T, Alloc>::Deallocate(T* buf, size_t n) noexcept
+{
+    if (deleter_ != nullptr)
+    {
+        (*deleter_)(buf, n);
+    }
+    else if (buf != nullptr)
+    {
+        AllocTraits::deallocate(alloc_, buf, n);
+    }
+}
+
+template<typename T, typename Alloc>
+bool RawMemory<T, Alloc>::TryExpand(size_t new_capacity) noexcept
+{
+    if constexpr (detail::HasExpand<Alloc>::value)
+    {
+        if (buffer_ != nullptr && deleter_ == nullptr && alloc_.expand(buffer_, capacity_, new_capacity))
+        {
+            capacity_ = new_capacity;
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename T, typename Alloc>
+void RawMemory<T, Alloc>::Reallocate(size_t new_capacity, size_t used)
+{
+    static_assert(IsTriviallyRelocatable<T>::value);
+    assert(used <= capacity_ && used <= new_capacity);
+    if constexpr (kHasReallocate)
+    {
+        if (buffer_ != nullptr && deleter_ == nullptr)
+        {
+            buffer_ = alloc_.reallocate(buffer_, capacity_, new_capacity);
+            capacity_ = new_capacity;
+            return;
+        }
+    }
+    RawMemory new_data(new_capacity, alloc_);
+    if (used != 0)
+    {
+        std::memcpy(static_cast<void*>(new_data.buffer_), static_cast<const void*>(buffer_), used * sizeof(T));
+    }
+    Swap(new_data);
+}
+
+template<typename T>
+T* MallocAllocator<T>::allocate(size_t n)
+{
+    if (n > SIZE_MAX / sizeof(T))
+    {
+        throw std::bad_array_new_length();
+    }
+    void* p = std::malloc(n * sizeof(T));
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+}
+
+template<typename T>
+void MallocAllocator<T>::deallocate(T* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+template<typename T>
+T* MallocAllocator<T>::reallocate(T* p, size_t, size_t new_n)
+{
+    if (new_n > SIZE_MAX / sizeof(T))
+    {
+        throw std::bad_array_new_length();
+    }
+    void* new_p = std::realloc(static_cast<void*>(p), new_n * sizeof(T));
+    if (new_p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return static_cast<T*>(new_p);
+}
+
+template<typename T, size_t Alignment, bool PadCapacity>
+T* AlignedAllocator<T, Alignment, PadCapacity>::allocate(size_t n)
+{
+    // Padding adds less than Alignment bytes, so this also covers PaddedCount(n)
+    if (n > (SIZE_MAX - Alignment) / sizeof(T))
+    {
+        throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(operator new(PaddedCount(n) * sizeof(T), std::align_val_t{Alignment}));
+}
+
+template<typename T, size_t Alignment, bool PadCapacity>
+AllocationResult<T*> AlignedAllocator<T, Alignment, PadCapacity>::allocate_at_least(size_t n)
+{
+    return {allocate(n), PaddedCount(n)};
+}
+
+template<typename T, size_t Alignment, bool PadCapacity>
+void AlignedAllocator<T, Alignment, PadCapacity>::deallocate(T* p, size_t) noexcept
+{
+    operator delete(p, std::align_val_t{Alignment});
+}
+
+template<typename T, size_t Alignment, bool PadCapacity>
+constexpr size_t AlignedAllocator<T, Alignment, PadCapacity>::PaddedCount(size_t n) noexcept
+{
+    if constexpr (PadCapacity && Alignment % sizeof(T) == 0)
+    {
+        constexpr size_t block = Alignment / sizeof(T);
+        return (n + block - 1) / block * block;
+    }
+    else
+    {
+        return n;
+    }
+}
+
+template<typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(const Alloc& alloc) noexcept
+    : data_(alloc)
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(size_t size, const Alloc& alloc)
+    : data_(size, alloc)
+    , size_(size)
+{
+    std::uninitialized_value_construct_n(data_.GetAddress(), size);
+    RecordCapacity(data_.Capacity(), true);
+}
+
+template<typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(size_t size, default_init_t, const Alloc& alloc)
+    : data_(size, alloc)
+    , size_(size)
+{
+    std::uninitialized_default_construct_n(data_.GetAddress(), size);
+    RecordCapacity(data_.Capacity(), true);
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename InputIt, typename>
+Vector<T, Alloc, Growth>::Vector(InputIt first, InputIt last, const Alloc& alloc)
+    : Vector(alloc)
+{
+    Append(first, last);
+}
+
+template<typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(std::initializer_list<T> init, const Alloc& alloc)
+    : Vector(init.begin(), init.end(), alloc)
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(const Vector& other)
+    : data_(other.size_, AllocTraits::select_on_container_copy_construction(other.data_.GetAllocator()))
+    , size_(other.size_)
+#ifdef VECTOR_ENABLE_STATS
+    , stats_(other.stats_)
+#endif
+{
+    std::uninitialized_copy_n(other.data_.GetAddress(), size_, data_.GetAddress());
+    RecordCapacity(data_.Capacity(), true);
+}
+
+template<typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(size_t size, const ParallelPolicy& policy, const Alloc& alloc)
+    : data_(size, alloc)
+{
+    detail::ParallelConstruct(data_.GetAddress(), size, policy, [](T* first, size_t, size_t n) {
+        std::uninitialized_value_construct_n(first, n);
+    });
+    size_ = size;
+    RecordCapacity(data_.Capacity(), true);
+}
+
+template<typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(const Vector& other, const ParallelPolicy& policy)
+    : data_(other.size_, AllocTraits::select_on_container_copy_construction(other.data_.GetAllocator()))
+#ifdef VECTOR_ENABLE_STATS
+    , stats_(other.stats_)
+#endif
+{
+    const T* source = other.data_.GetAddress();
+    detail::ParallelConstruct(data_.GetAddress(), other.size_, policy, [source](T* first, size_t index, size_t n) {
+        std::uninitialized_copy_n(source + index, n, first);
+    });
+    size_ = other.size_;
+    RecordCapacity(data_.Capacity(), true);
+}
+
+template<typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>& Vector<T, Alloc, Growth>::operator=(const Vector& rhs)
+{
+    if (this != &rhs)
+    {
+        if constexpr (AllocTraits::propagate_on_container_copy_assignment::value)
+        {
+            if (data_.GetAllocator() != rhs.data_.GetAllocator())
+            {
+                std::destroy_n(data_.GetAddress(), size_);
+                size_ = 0;
+                RawMemory<T, Alloc> rhs_alloc_data(rhs.data_.GetAllocator());
+                data_.Swap(rhs_alloc_data);
+            }
+        }
+        Assign(rhs.data_.GetAddress(), rhs.size_);
+    }
+    return *this;
+}
+
+template<typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(Vector&& other) noexcept
+    : data_(std::move(other.data_))
+    , size_(std::exchange(other.size_, 0))
+#ifdef VECTOR_ENABLE_STATS
+    , stats_(other.stats_)
+#endif
+{
+}
+
+template<typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>& Vector<T, Alloc, Growth>::operator=(Vector&& rhs) noexcept(
+    std::allocator_traits<Alloc>::propagate_on_container_move_assignment::value ||
+    std::allocator_traits<Alloc>::is_always_equal::value)
+{
+    if (this != &rhs)
+    {
+        if constexpr (AllocTraits::propagate_on_container_move_assignment::value ||
+            AllocTraits::is_always_equal::value)
+        {
+            data_.Swap(rhs.data_);
+            std::swap(size_, rhs.size_);
+        }
+        else if (data_.GetAllocator() == rhs.data_.GetAllocator())
+        {
+            data_.Swap(rhs.data_);
+            std::swap(size_, rhs.size_);
+        }
+        else
+        {
+            Assign(std::make_move_iterator(rhs.begin()), rhs.size_);
+        }
+    }
+    return *this;
+}
+
+template<typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::~Vector()
+{
+    std::destroy_n(data_.GetAddress(), size_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::begin() noexcept
+{
+    return data_.GetAddress();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::end() noexcept
+{
+    return data_ + size_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::const_iterator Vector<T, Alloc, Growth>::begin() const noexcept
+{
+    return static_cast<const T*>(data_.GetAddress());
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::const_iterator Vector<T, Alloc, Growth>::end() const noexcept
+{
+    return static_cast<const T*>(data_ + size_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::const_iterator Vector<T, Alloc, Growth>::cbegin() const noexcept
+{
+    return begin();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::const_iterator Vector<T, Alloc, Growth>::cend() const noexcept
+{
+    return end();
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t Vector<T, Alloc, Growth>::Size() const noexcept
+{
+    return size_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t Vector<T, Alloc, Growth>::Capacity() const noexcept
+{
+    return data_.Capacity();
+}
+
+template<typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::allocator_type Vector<T, Alloc, Growth>::GetAllocator() const noexcept
+{
+    return data_.GetAllocator();
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Reserve(size_t new_capacity)
+{
+    if (new_capacity <= data_.Capacity() || TryExpand(new_capacity))
+    {
+        return;
+    }
+    ReallocateTo(new_capacity);
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t Vector<T, Alloc, Growth>::ShrinkTo(size_t new_capacity)
+{
+    const size_t old_capacity = data_.Capacity();
+    new_capacity = std::max(new_capacity, size_);
+    if (new_capacity >= old_capacity)
+    {
+        return 0;
+    }
+    if (new_capacity == 0)
+    {
+        RawMemory<T, Alloc> empty(data_.GetAllocator());
+        data_.Swap(empty);
+    }
+    else
+    {
+        ReallocateTo(new_capacity);
+    }
+    return (old_capacity - data_.Capacity()) * sizeof(T);
+}
+
+template<typename T, typename Alloc, typename Growth>
+size_t Vector<T, Alloc, Growth>::ShrinkToFit()
+{
+    return ShrinkTo(size_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Clear() noexcept
+{
+    std::destroy_n(data_.GetAddress(), size_);
+    size_ = 0;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Clear(const ParallelPolicy& policy) noexcept
+{
+    detail::ParallelDestroy(data_.GetAddress(), size_, policy);
+    size_ = 0;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Assign(const Vector& rhs, const ParallelPolicy& policy)
+{
+    if (this == &rhs)
+    {
+        return;
+    }
+    const T* source = rhs.data_.GetAddress();
+    bool replace_allocator = false;
+    if constexpr (AllocTraits::propagate_on_container_copy_assignment::value)
+    {
+        replace_allocator = data_.GetAllocator() != rhs.data_.GetAllocator();
+    }
+    if (replace_allocator || rhs.size_ > data_.Capacity())
+    {
+        RawMemory<T, Alloc> new_data(rhs.size_, replace_allocator ? rhs.data_.GetAllocator() : data_.GetAllocator());
+        detail::ParallelConstruct(new_data.GetAddress(), rhs.size_, policy, [source](T* first, size_t index, size_t n) {
+            std::uninitialized_copy_n(source + index, n, first);
+        });
+        Clear(policy);
+        data_.Swap(new_data);
+        size_ = rhs.size_;
+        RecordCapacity(data_.Capacity(), true);
+        return;
+    }
+    T* data = data_.GetAddress();
+    const size_t common = std::min(size_, rhs.size_);
+    detail::ParallelFor(common, policy,
+        [data, source](size_t first, size_t last) {
+            std::copy(source + first, source + last, data + first);
+        },
+        [](size_t, size_t) noexcept {});
+    if (rhs.size_ > size_)
+    {
+        detail::ParallelConstruct(data + size_, rhs.size_ - size_, policy, [source, this](T* first, size_t index, size_t n) {
+            std::uninitialized_copy_n(source + size_ + index, n, first);
+        });
+    }
+    else
+    {
+        detail::ParallelDestroy(data + rhs.size_, size_ - rhs.size_, policy);
+    }
+    size_ = rhs.size_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Adopt(T* data, size_t size, size_t capacity, BufferDeleter<T> deleter)
+{
+    assert(size <= capacity);
+    RawMemory<T, Alloc> adopted(data, capacity, std::move(deleter), data_.GetAllocator());
+    Clear();
+    data_.Swap(adopted);
+    size_ = size;
+}
+
+template<typename T, typename Alloc, typename Growth>
+ReleasedBuffer<T> Vector<T, Alloc, Growth>::Release()
+{
+    ReleasedBuffer<T> released;
+    released.data = data_.GetAddress();
+    released.capacity = data_.Capacity();
+    released.deleter = data_.Release();
+    released.size = std::exchange(size_, 0);
+    return released;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Relocate(T* from, size_t count, T* to) noexcept(kNothrowRelocate)
+{
+    if constexpr (kParallelRelocate)
+    {
+        if (count >= Growth::kRelocationPolicy.threshold)
+        {
+            detail::ParallelRelocate(from, count, to, Growth::kRelocationPolicy);
+            return;
+        }
+    }
+    detail::Relocate(from, count, to);
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::ReallocateTo(size_t new_capacity)
+{
+    assert(new_capacity >= size_);
+    const size_t old_capacity = data_.Capacity();
+    if constexpr (kReallocate)
+    {
+        data_.Reallocate(new_capacity, size_);
+    }
+    else
+    {
+        RawMemory<T, Alloc> new_data(new_capacity, data_.GetAllocator());
+        Relocate(data_.GetAddress(), size_, new_data.GetAddress());
+        data_.Swap(new_data);
+    }
+    RecordRelocation(old_capacity, size_);
+    RecordCapacity(data_.Capacity(), true);
+}
+
+template<typename T, typename Alloc, typename Growth>
+bool Vector<T, Alloc, Growth>::TryExpand(size_t new_capacity) noexcept
+{
+    if (!data_.TryExpand(new_capacity))
+    {
+        return false;
+    }
+    RecordRelocation(new_capacity, 0);
+    RecordCapacity(data_.Capacity(), false);
+    return true;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::SetStatsTag([[maybe_unused]] const char* tag)
+{
+#ifdef VECTOR_ENABLE_STATS
+    stats_ = &detail::GetVectorStatsCounters(tag);
+#endif
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::RecordCapacity([[maybe_unused]] size_t capacity, [[maybe_unused]] bool new_block) const noexcept
+{
+#ifdef VECTOR_ENABLE_STATS
+    if (capacity == 0)
+    {
+        return;
+    }
+    if (new_block)
+    {
+        stats_->allocations.fetch_add(1, std::memory_order_relaxed);
+        stats_->bytes_allocated.fetch_add(capacity * sizeof(T), std::memory_order_relaxed);
+    }
+    stats_->UpdatePeak(capacity * sizeof(T));
+#endif
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::RecordRelocation([[maybe_unused]] size_t old_capacity, [[maybe_unused]] size_t count) const noexcept
+{
+#ifdef VECTOR_ENABLE_STATS
+    if (old_capacity == 0)
+    {
+        return;
+    }
+    stats_->reallocations.fetch_add(1, std::memory_order_relaxed);
+    if constexpr (IsTriviallyRelocatable<T>::value)
+    {
+        stats_->relocated_bitwise.fetch_add(count, std::memory_order_relaxed);
+    }
+    else if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>)
+    {
+        stats_->relocated_by_move.fetch_add(count, std::memory_order_relaxed);
+    }
+    else
+    {
+        stats_->relocated_by_copy.fetch_add(count, std::memory_order_relaxed);
+    }
+#endif
+}
+
+template<typename T, typename Alloc, typename Growth>
+const T& Vector<T, Alloc, Growth>::operator[](size_t index) const noexcept
+{
+    return const_cast<Vector&>(*this)[index];
+}
+
+template<typename T, typename Alloc, typename Growth>
+T& Vector<T, Alloc, Growth>::operator[](size_t index) noexcept
+{
+    assert(index < size_);
+    return data_[index];
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Swap(Vector& other) noexcept
+{
+    if constexpr (!AllocTraits::propagate_on_container_swap::value)
+    {
+        assert(data_.GetAllocator() == other.data_.GetAllocator());
+    }
+    data_.Swap(other.data_);
+    std::swap(size_, other.size_);
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Resize(size_t new_size)
+{
+    if (new_size < size_)
+    {
+        std::destroy_n(&data_[new_size], size_ - new_size);
+    }
+    else if (new_size > size_)
+    {
+        Reserve(new_size);
+        std::uninitialized_value_construct_n(&data_[size_], new_size - size_);
+    }
+    size_ = new_size;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::ResizeDefaultInit(size_t new_size)
+{
+    if (new_size < size_)
+    {
+        std::destroy_n(&data_[new_size], size_ - new_size);
+    }
+    else if (new_size > size_)
+    {
+        Reserve(new_size);
+        std::uninitialized_default_construct_n(&data_[size_], new_size - size_);
+    }
+    size_ = new_size;
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename F>
+void Vector<T, Alloc, Growth>::PushBack(F&& value)
+{
+    EmplaceBack(std::forward<F>(value));
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::PopBack() noexcept
+{
+    std::destroy_at(&data_[size_ - 1]);
+    --size_;
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename ...Ts>
+T& Vector<T, Alloc, Growth>::EmplaceBack(Ts && ...vs)
+{
+    T* result;
+    const bool full = size_ == data_.Capacity();
+    const size_t new_capacity = full ? NextCapacity() : size_;
+    if (full && !TryExpand(new_capacity))
+    {
+        if constexpr (kReallocate)
+        {
+            // vs may refer to an element of the block being reallocated
+            T value(std::forward<Ts>(vs)...);
+            ReallocateTo(new_capacity);
+            result = new (data_ + size_) T(std::move(value));
+        }
+        else
+        {
+            RawMemory<T, Alloc> new_data(new_capacity, data_.GetAllocator());
+            result = new (new_data + size_) T(std::forward<Ts>(vs)...);
+            try
+            {
+                Relocate(data_.GetAddress(), size_, new_data.GetAddress());
+            }
+            catch (...)
+            {
+                std::destroy_at(result);
+                throw;
+            }
+            data_.Swap(new_data);
+            RecordRelocation(new_data.Capacity(), size_);
+            RecordCapacity(data_.Capacity(), true);
+        }
+    }
+    else
+    {
+        result = new (data_ + size_) T(std::forward<Ts>(vs)...);
+    }
+    ++size_;
+    return *result;
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename... Ts>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Emplace(const_iterator pos, Ts&& ...vs)
+{
+    assert(pos >= begin() && pos <= end());
+    if (pos == end())
+    {
+        return &EmplaceBack(std::forward<Ts>(vs)...);
+    }
+    iterator result;
+    size_t pos_index = pos - begin();
+    const bool full = size_ == data_.Capacity();
+    const size_t new_capacity = full ? NextCapacity() : size_;
+    if (full && !TryExpand(new_capacity))
+    {
+        if constexpr (kReallocate)
+        {
+            T value(std::forward<Ts>(vs)...);
+            ReallocateTo(new_capacity);
+            return Emplace(begin() + pos_index, std::move(value));
+        }
+        RawMemory<T, Alloc> new_data(new_capacity, data_.GetAllocator());
+        result = new (new_data + pos_index) T(std::forward<Ts>(vs)...);
+        try
+        {
+            RelocateAround(new_data, pos_index, 1);
+        }
+        catch (...)
+        {
+            std::destroy_at(result);
+            throw;
+        }
+        data_.Swap(new_data);
+        RecordRelocation(new_data.Capacity(), size_);
+        RecordCapacity(data_.Capacity(), true);
+    }
+    else
+    {
+        // Built before anything moves: vs may refer to an element, and if
+        // this throws the vector is still intact
+        T buffer(std::forward<Ts>(vs)...);
+        new (data_ + size_) T(std::move(*(end() - 1)));
+        std::move_backward(begin() + pos_index, end() - 1, end());
+        *(data_ + pos_index) = std::move(buffer);
+        result = data_ + pos_index;
+    }
+    ++size_;
+    return result;
+}
+
+template<typename T, typename Alloc, typename Growth>
+template<typename F>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Insert(const_iterator pos, F&& value)
+{
+    return Emplace(pos, std::forward<F>(value));
+}
 
-template<typename T>
-RawMemory<T>::RawMemory(size_t capacity)
-    : buffer_(Allocate(capacity))
-    , capacity_(capacity)
+template<typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Erase(const_iterator pos) noexcept(std::is_nothrow_move_assignable_v<T>)
 {
+    assert(pos >= begin() && pos < end());
+    return Erase(pos, pos + 1);
 }
 
-template<typename T>
-RawMemory<T>::RawMemory(RawMemory&& other) noexcept
+template<typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Erase(const_iterator first, const_iterator last) noexcept(std::is_nothrow_move_assignable_v<T>)
 {
-    Swap(other);
+    assert(first >= begin() && first <= last && last <= end());
+    const size_t first_index = first - begin();
+    const size_t count = last - first;
+    if (count == 0)
+    {
+        return begin() + first_index;
+    }
+    if constexpr (IsTriviallyRelocatable<T>::value)
+    {
+        std::destroy_n(begin() + first_index, count);
+        detail::RelocateOverlapping(begin() + first_index + count, size_ - first_index - count, begin() + first_index);
+    }
+    else
+    {
+        if constexpr (std::is_nothrow_move_constructible_v<T> ||
+            !std::is_copy_constructible_v<T>)
+        {
+            std::move(begin() + first_index + count, end(), begin() + first_index);
+        }
+        else
+        {
+            std::copy(begin() + first_index + count, end(), begin() + first_index);
+        }
+        std::destroy_n(end() - count, count);
+    }
+    size_ -= count;
+    return begin() + first_index;
 }
 
-template<typename T>
-RawMemory<T>& RawMemory<T>::operator=(RawMemory&& rhs) noexcept
+template<typename T, typename Alloc, typename Growth>
+template<typename Pred>
+size_t Vector<T, Alloc, Growth>::EraseIf(Pred pred)
 {
-    if (this != &rhs)
+    const size_t old_size = size_;
+    if constexpr (IsTriviallyRelocatable<T>::value)
+    {
+        T* write = std::find_if(begin(), end(), pred);
+        T* read = write;
+        T* unprocessed = write;
+        try
+        {
+            while (read != end())
+            {
+                while (read != end() && pred(*read))
+                {
+                    ++read;
+                }
+                std::destroy(unprocessed, read);
+                unprocessed = read;
+                while (read != end() && !pred(*read))
+                {
+                    ++read;
+                }
+                detail::RelocateOverlapping(unprocessed, read - unprocessed, write);
+                write += read - unprocessed;
+                unprocessed = read;
+            }
+        }
+        catch (...)
+        {
+            const size_t rest = end() - unprocessed;
+            detail::RelocateOverlapping(unprocessed, rest, write);
+            size_ = write - begin() + rest;
+            throw;
+        }
+        size_ = write - begin();
+    }
+    else
     {
-        Deallocate(buffer_);
-        //RawMemory<T> rhs_move(std::move(rhs));
-        Swap(rhs);
+        Erase(std::remove_if(begin(), end(), pred), end());
     }
-    return *this;
+    return old_size - size_;
 }
 
-template<typename T>
-RawMemory<T>::~RawMemory()
+template<typename T, typename Alloc, typename Growth>
+template<typename InputIt>
+void Vector<T, Alloc, Growth>::Assign(InputIt first, size_t count)
 {
-    Deallocate(buffer_);
+    if (count > data_.Capacity())
+    {
+        RawMemory<T, Alloc> new_data(count, data_.GetAllocator());
+        std::uninitialized_copy_n(first, count, new_data.GetAddress());
+        std::destroy_n(data_.GetAddress(), size_);
+        data_.Swap(new_data);
+        RecordCapacity(data_.Capacity(), true);
+    }
+    else if (count < size_)
+    {
+        std::copy_n(first, count, data_.GetAddress());
+        std::destroy_n(data_ + count, size_ - count);
+    }
+    else
+    {
+        std::copy_n(first, size_, data_.GetAddress());
+        std::uninitialized_copy_n(std::next(first, size_), count - size_, data_ + size_);
+    }
+    size_ = count;
 }
 
-template<typename T>
-T* RawMemory<T>::operator+(size_t offset) noexcept
+template<typename T, typename Alloc, typename Growth, typename Pred>
+size_t EraseIf(Vector<T, Alloc, Growth>& v, Pred pred)
 {
-    assert(offset <= capacity_);
-    return buffer_ + offset;
+    return v.EraseIf(std::move(pred));
 }
 
-template<typename T>
-const T* RawMemory<T>::operator+(size_t offset) const noexcept
+// For trivial element types std::equal and std::lexicographical_compare
+// reduce to memcmp where that is valid. vector_algorithms.h has SIMD
+// kernels for int32_t and float
+template<typename T, typename Alloc, typename Growth>
+bool operator==(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs)
 {
-    return const_cast<RawMemory&>(*this) + offset;
+    return lhs.Size() == rhs.Size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
 }
 
-template<typename T>
-const T& RawMemory<T>::operator[](size_t index) const noexcept
+template<typename T, typename Alloc, typename Growth>
+bool operator!=(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs)
 {
-    return const_cast<RawMemory&>(*this)[index];
+    return !(lhs == rhs);
 }
 
-template<typename T>
-T& RawMemory<T>::operator[](size_t index) noexcept
+template<typename T, typename Alloc, typename Growth>
+bool operator<(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs)
 {
-    assert(index < capacity_);
-    return buffer_[index];
+    return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
 }
 
-template<typename T>
-void RawMemory<T>::Swap(RawMemory& other) noexcept
+template<typename T, typename Alloc, typename Growth>
+bool operator>(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs)
 {
-    std::swap(buffer_, other.buffer_);
-    std::swap(capacity_, other.capacity_);
+    return rhs < lhs;
 }
 
-template<typename T>
-const T* RawMemory<T>::GetAddress() const noexcept
+template<typename T, typename Alloc, typename Growth>
+bool operator<=(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs)
 {
-    return buffer_;
+    return !(rhs < lhs);
 }
 
-template<typename T>
-T* RawMemory<T>::GetAddress() noexcept
+template<typename T, typename Alloc, typename Growth>
+bool operator>=(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs)
 {
-    return buffer_;
+    return !(lhs < rhs);
 }
 
-template<typename T>
-size_t RawMemory<T>::Capacity() const
+template<typename T, typename Alloc, typename Growth>
+size_t Vector<T, Alloc, Growth>::NextCapacity() const noexcept
 {
-    return capacity_;
+    const size_t new_capacity = Growth::NextCapacity(size_, sizeof(T));
+    assert(new_capacity > size_);
+    return new_capacity;
 }
 
-template<typename T>
-T* RawMemory<T>::Allocate(size_t n)
+template<typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Insert(const_iterator pos, size_t count, const T& value)
 {
-    return n != 0 ? static_cast<T*>(operator new(n * sizeof(T))) : nullptr;
+    assert(pos >= begin() && pos <= end());
+    // value may be an element of this vector
+    const T value_copy(value);
+    return InsertUninitialized(pos - begin(), count, [&value_copy, count](T* first)
+        {
+            std::uninitialized_fill_n(first, count, value_copy);
+        });
 }
 
-template<typename T>
-void RawMemory<T>::Deallocate(T* buf) noexcept
+template<typename T, typename Alloc, typename Growth>
+template<typename InputIt, typename>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Insert(const_iterator pos, InputIt first, InputIt last)
 {
-    operator delete(buf);
+    assert(pos >= begin() && pos <= end());
+    const size_t pos_index = pos - begin();
+    if constexpr (detail::kIsForwardIterator<InputIt>)
+    {
+        const size_t count = std::distance(first, last);
+        return InsertUninitialized(pos_index, count, [first, count](T* to)
+            {
+                std::uninitialized_copy_n(first, count, to);
+            });
+    }
+    else
+    {
+        const size_t old_size = size_;
+        Append(first, last);
+        std::rotate(begin() + pos_index, begin() + old_size, end());
+        return begin() + pos_index;
+    }
 }
 
-template<typename T>
-Vector<T>::Vector(size_t size)
-    : data_(size)
-    , size_(size)
+template<typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Insert(const_iterator pos, std::initializer_list<T> init)
 {
-    std::uninitialized_value_construct_n(data_.GetAddress(), size);
+    return Insert(pos, init.begin(), init.end());
 }
 
-template<typename T>
-Vector<T>::Vector(const Vector& other)
-    : data_(other.size_)
-    , size_(other.size_)
+template<typename T, typename Alloc, typename Growth>
+template<typename InputIt, typename>
+void Vector<T, Alloc, Growth>::Append(InputIt first, InputIt last)
 {
-    std::uninitialized_copy_n(other.data_.GetAddress(), size_, data_.GetAddress());
+    if constexpr (detail::kIsForwardIterator<InputIt>)
+    {
+        Insert(end(), first, last);
+    }
+    else
+    {
+        for (; first != last; ++first)
+        {
+            EmplaceBack(*first);
+        }
+    }
 }
 
-template<typename T>
-Vector<T>& Vector<T>::operator=(const Vector& rhs)
+template<typename T, typename Alloc, typename Growth>
+template<typename Init>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::InsertUninitialized(size_t pos_index, size_t count, Init&& init)
 {
-    if (this != &rhs)
+    if (count == 0)
+    {
+        return begin() + pos_index;
+    }
+    size_t new_capacity = data_.Capacity();
+    if (size_ + count > data_.Capacity())
     {
-        if (rhs.size_ > data_.Capacity())
+        new_capacity = std::max(size_ + count, NextCapacity());
+        if (!TryExpand(new_capacity) && kReallocate)
         {
-            Vector<T> rhs_copy(rhs);
-            Swap(rhs_copy);
+            ReallocateTo(new_capacity);
         }
-        else
+    }
+    // Appending into spare room shifts nothing, so any T can be built in place
+    if (pos_index == size_ && new_capacity == data_.Capacity())
+    {
+        init(data_ + size_);
+        size_ += count;
+        return begin() + pos_index;
+    }
+    if constexpr (detail::kNothrowShift<T>)
+    {
+        if (new_capacity == data_.Capacity())
         {
-            if (rhs.size_ < size_)
+            detail::RelocateOverlapping(data_ + pos_index, size_ - pos_index, data_ + pos_index + count);
+            try
             {
-                std::copy_n(rhs.data_.GetAddress(), rhs.size_, data_.GetAddress());
-                std::destroy_n(data_ + rhs.size_, size_ - rhs.size_);
+                init(data_ + pos_index);
             }
-            else
+            catch (...)
             {
-                std::copy_n(rhs.data_.GetAddress(), size_, data_.GetAddress());
-                std::uninitialized_copy_n(rhs.data_ + size_, rhs.size_ - size_, data_ + size_);
+                detail::RelocateOverlapping(data_ + pos_index + count, size_ - pos_index, data_ + pos_index);
+                throw;
             }
+            size_ += count;
+            return begin() + pos_index;
+        }
+    }
+    // Shifting a tail of throwing elements in place cannot be undone,
+    // so such vectors always build the result in a new block
+    RawMemory<T, Alloc> new_data(new_capacity, data_.GetAllocator());
+    init(new_data + pos_index);
+    try
+    {
+        RelocateAround(new_data, pos_index, count);
+    }
+    catch (...)
+    {
+        std::destroy_n(new_data + pos_index, count);
+        throw;
+    }
+    data_.Swap(new_data);
+    RecordRelocation(new_data.Capacity(), size_);
+    RecordCapacity(data_.Capacity(), true);
+    size_ += count;
+    return begin() + pos_index;
+}
+
+template<typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::RelocateAround(RawMemory<T, Alloc>& new_data, size_t pos_index, size_t count) noexcept(kNothrowRelocate)
+{
+    if constexpr (kNothrowRelocate)
+    {
+        Relocate(data_.GetAddress(), pos_index, new_data.GetAddress());
+        Relocate(data_ + pos_index, size_ - pos_index, new_data + pos_index + count);
+    }
+    else
+    {
+        detail::UninitializedCopyOrMoveN(data_.GetAddress(), pos_index, new_data.GetAddress());
+        try
+        {
+            detail::UninitializedCopyOrMoveN(data_ + pos_index, size_ - pos_index, new_data + pos_index + count);
+        }
+        catch (...)
+        {
+            std::destroy_n(new_data.GetAddress(), pos_index);
+            throw;
+        }
+        std::destroy_n(data_.GetAddress(), size_);
+    }
+}
+
+template<typename T, size_t N, typename Alloc, typename Growth>
+SmallVector<T, N, Alloc, Growth>::SmallVector(const Alloc& alloc) noexcept
+    : heap_(alloc)
+{
+}
+
+template<typename T, size_t N, typename Alloc, typename Growth>
+SmallVector<T, N, Alloc, Growth>::SmallVector(size_t size, const Alloc& alloc)
+    : heap_(size > N ? size : 0, alloc)
+{
+    std::uninitialized_value_construct_n(Data(), size);
+    size_ = size;
+}
+
+template<typename T, size_t N, typename Alloc, typename Growth>
+SmallVector<T, N, Alloc, Growth>::SmallVector(const SmallVector& other)
+    : heap_(other.size_ > N ? other.size_ : 0,
+        std::allocator_traits<Alloc>::select_on_container_copy_construction(other.heap_.GetAllocator()))
+{
+    std::uninitialized_copy_n(other.Data(), other.size_, Data());
+    size_ = other.size_;
+}
+
+template<typename T, size_t N, typename Alloc, typename Growth>
+SmallVector<T, N, Alloc, Growth>& SmallVector<T, N, Alloc, Growth>::operator=(const SmallVector& rhs)
+{
+    if (this != &rhs)
+    {
+        if (rhs.size_ > Capacity())
+        {
+            SmallVector rhs_copy(rhs);
+            Swap(rhs_copy);
+        }
+        else if (rhs.size_ < size_)
+        {
+            std::copy_n(rhs.Data(), rhs.size_, Data());
+            std::destroy_n(Data() + rhs.size_, size_ - rhs.size_);
+            size_ = rhs.size_;
+        }
+        else
+        {
+            std::copy_n(rhs.Data(), size_, Data());
+            std::uninitialized_copy_n(rhs.Data() + size_, rhs.size_ - size_, Data() + size_);
             size_ = rhs.size_;
         }
     }
     return *this;
 }
 
-template<typename T>
-Vector<T>::Vector(Vector&& other) noexcept
-    : data_(std::move(other.data_))
-    , size_(std::exchange(other.size_, 0))
+template<typename T, size_t N, typename Alloc, typename Growth>
+SmallVector<T, N, Alloc, Growth>::SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    : heap_(other.heap_.GetAllocator())
 {
+    if (other.IsInline())
+    {
+        other.MoveInlineTo(*this);
+    }
+    else
+    {
+        heap_.Swap(other.heap_);
+        size_ = std::exchange(other.size_, 0);
+    }
 }
 
-template<typename T>
-Vector<T>& Vector<T>::operator=(Vector&& rhs) noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+SmallVector<T, N, Alloc, Growth>& SmallVector<T, N, Alloc, Growth>::operator=(SmallVector&& rhs) noexcept(
+    std::is_nothrow_move_constructible_v<T> && std::is_nothrow_swappable_v<T>)
 {
     if (this != &rhs)
     {
-        data_.Swap(rhs.data_);
-        std::swap(size_, rhs.size_);
+        SmallVector rhs_move(std::move(rhs));
+        Swap(rhs_move);
     }
     return *this;
 }
 
-
-template<typename T>
-Vector<T>::~Vector()
+template<typename T, size_t N, typename Alloc, typename Growth>
+SmallVector<T, N, Alloc, Growth>::~SmallVector()
 {
-    std::destroy_n(data_.GetAddress(), size_);
+    std::destroy_n(Data(), size_);
 }
 
-template<typename T>
-typename Vector<T>::iterator Vector<T>::begin() noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+typename SmallVector<T, N, Alloc, Growth>::iterator SmallVector<T, N, Alloc, Growth>::begin() noexcept
 {
-    return data_.GetAddress();
+    return Data();
 }
 
-template<typename T>
-typename Vector<T>::iterator Vector<T>::end() noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+typename SmallVector<T, N, Alloc, Growth>::iterator SmallVector<T, N, Alloc, Growth>::end() noexcept
 {
-    return data_ + size_;
+    return Data() + size_;
 }
 
-template<typename T>
-typename Vector<T>::const_iterator Vector<T>::begin() const noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+typename SmallVector<T, N, Alloc, Growth>::const_iterator SmallVector<T, N, Alloc, Growth>::begin() const noexcept
 {
-    return static_cast<const T*>(data_.GetAddress());
+    return Data();
 }
 
-template<typename T>
-typename Vector<T>::const_iterator Vector<T>::end() const noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+typename SmallVector<T, N, Alloc, Growth>::const_iterator SmallVector<T, N, Alloc, Growth>::end() const noexcept
 {
-    return static_cast<const T*>(data_ + size_);
+    return Data() + size_;
 }
 
-template<typename T>
-typename Vector<T>::const_iterator Vector<T>::cbegin() const noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+typename SmallVector<T, N, Alloc, Growth>::const_iterator SmallVector<T, N, Alloc, Growth>::cbegin() const noexcept
 {
     return begin();
 }
 
-template<typename T>
-typename Vector<T>::const_iterator Vector<T>::cend() const noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+typename SmallVector<T, N, Alloc, Growth>::const_iterator SmallVector<T, N, Alloc, Growth>::cend() const noexcept
 {
     return end();
 }
 
-template<typename T>
-size_t Vector<T>::Size() const noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+size_t SmallVector<T, N, Alloc, Growth>::Size() const noexcept
 {
     return size_;
 }
 
-template<typename T>
-size_t Vector<T>::Capacity() const noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+size_t SmallVector<T, N, Alloc, Growth>::Capacity() const noexcept
 {
-    return data_.Capacity();
+    return IsInline() ? N : heap_.Capacity();
 }
 
-template<typename T>
-void Vector<T>::Reserve(size_t new_capacity)
+template<typename T, size_t N, typename Alloc, typename Growth>
+bool SmallVector<T, N, Alloc, Growth>::IsInline() const noexcept
+{
+    return heap_.GetAddress() == nullptr;
+}
+
+template<typename T, size_t N, typename Alloc, typename Growth>
+typename SmallVector<T, N, Alloc, Growth>::allocator_type SmallVector<T, N, Alloc, Growth>::GetAllocator() const noexcept
 {
-    if (new_capacity <= data_.Capacity())
+    return heap_.GetAllocator();
+}
+
+template<typename T, size_t N, typename Alloc, typename Growth>
+void SmallVector<T, N, Alloc, Growth>::Reserve(size_t new_capacity)
+{
+    if (new_capacity <= Capacity())
     {
         return;
     }
-    RawMemory<T> new_data(new_capacity);
-    if constexpr (std::is_nothrow_move_constructible_v<T> ||
-        !std::is_copy_constructible_v<T>)
-    {
-        std::uninitialized_move_n(data_.GetAddress(), size_, new_data.GetAddress());
-    }
-    else
-    {
-        std::uninitialized_copy_n(data_.GetAddress(), size_, new_data.GetAddress());
-    }
-    std::destroy_n(data_.GetAddress(), size_);
-    data_.Swap(new_data);
+    RawMemory<T, Alloc> new_data(new_capacity, heap_.GetAllocator());
+    detail::Relocate(Data(), size_, new_data.GetAddress());
+    heap_.Swap(new_data);
 }
 
-template<typename T>
-const T& Vector<T>::operator[](size_t index) const noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+const T& SmallVector<T, N, Alloc, Growth>::operator[](size_t index) const noexcept
 {
-    return const_cast<Vector&>(*this)[index];
+    return const_cast<SmallVector&>(*this)[index];
 }
 
-template<typename T>
-T& Vector<T>::operator[](size_t index) noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+T& SmallVector<T, N, Alloc, Growth>::operator[](size_t index) noexcept
 {
     assert(index < size_);
-    return data_[index];
+    return Data()[index];
 }
 
-template<typename T>
-void Vector<T>::Swap(Vector& other) noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+void SmallVector<T, N, Alloc, Growth>::Swap(SmallVector& other) noexcept(
+    std::is_nothrow_move_constructible_v<T> && std::is_nothrow_swappable_v<T>)
 {
-    data_.Swap(other.data_);
-    std::swap(size_, other.size_);
+    if (!IsInline() && !other.IsInline())
+    {
+        heap_.Swap(other.heap_);
+        std::swap(size_, other.size_);
+    }
+    else if (IsInline() && other.IsInline())
+    {
+        SmallVector& longer = size_ < other.size_ ? other : *this;
+        SmallVector& shorter = size_ < other.size_ ? *this : other;
+        std::swap_ranges(shorter.Data(), shorter.Data() + shorter.size_, longer.Data());
+        const size_t tail = longer.size_ - shorter.size_;
+        std::uninitialized_move_n(longer.Data() + shorter.size_, tail, shorter.Data() + shorter.size_);
+        std::destroy_n(longer.Data() + shorter.size_, tail);
+        std::swap(size_, other.size_);
+    }
+    else
+    {
+        SmallVector& on_heap = IsInline() ? other : *this;
+        SmallVector& on_stack = IsInline() ? *this : other;
+        const size_t heap_size = on_heap.size_;
+        on_heap.size_ = 0;
+        on_stack.MoveInlineTo(on_heap);
+        on_stack.heap_.Swap(on_heap.heap_);
+        on_stack.size_ = heap_size;
+    }
 }
 
-template<typename T>
-void Vector<T>::Resize(size_t new_size)
+template<typename T, size_t N, typename Alloc, typename Growth>
+void SmallVector<T, N, Alloc, Growth>::Resize(size_t new_size)
 {
     if (new_size < size_)
     {
-        std::destroy_n(&data_[new_size], size_ - new_size);
+        std::destroy_n(Data() + new_size, size_ - new_size);
     }
     else if (new_size > size_)
     {
         Reserve(new_size);
-        std::uninitialized_value_construct_n(&data_[size_], new_size - size_);
+        std::uninitialized_value_construct_n(Data() + size_, new_size - size_);
     }
     size_ = new_size;
 }
 
-template<typename T>
+template<typename T, size_t N, typename Alloc, typename Growth>
 template<typename F>
-void Vector<T>::PushBack(F&& value)
+void SmallVector<T, N, Alloc, Growth>::PushBack(F&& value)
 {
     EmplaceBack(std::forward<F>(value));
 }
 
-template<typename T>
-void Vector<T>::PopBack() noexcept
+template<typename T, size_t N, typename Alloc, typename Growth>
+void SmallVector<T, N, Alloc, Growth>::PopBack() noexcept
 {
-    std::destroy_at(&data_[size_ - 1]);
+    assert(size_ > 0);
+    std::destroy_at(Data() + size_ - 1);
     --size_;
 }
 
-template<typename T>
+template<typename T, size_t N, typename Alloc, typename Growth>
 template<typename ...Ts>
-T& Vector<T>::EmplaceBack(Ts && ...vs)
+T& SmallVector<T, N, Alloc, Growth>::EmplaceBack(Ts && ...vs)
 {
     T* result;
-    if (size_ == data_.Capacity())
+    if (size_ == Capacity())
     {
-        size_t new_capacity = size_ == 0 ? 1 : size_ * 2;
-        RawMemory<T> new_data(new_capacity);
+        RawMemory<T, Alloc> new_data(NextCapacity(), heap_.GetAllocator());
         result = new (new_data + size_) T(std::forward<Ts>(vs)...);
-        if constexpr (std::is_nothrow_move_constructible_v<T> ||
-            !std::is_copy_constructible_v<T>)
+        try
         {
-            std::uninitialized_move_n(data_.GetAddress(), size_, new_data.GetAddress());
+            detail::Relocate(Data(), size_, new_data.GetAddress());
         }
-        else
+        catch (...)
         {
-            std::uninitialized_copy_n(data_.GetAddress(), size_, new_data.GetAddress());
+            std::destroy_at(result);
+            throw;
         }
-        std::destroy_n(data_.GetAddress(), size_);
-        data_.Swap(new_data);
+        heap_.Swap(new_data);
     }
     else
     {
-        result = new (data_ + size_) T(std::forward<Ts>(vs)...);
+        result = new (Data() + size_) T(std::forward<Ts>(vs)...);
     }
     ++size_;
     return *result;
 }
 
-template<typename T>
+template<typename T, size_t N, typename Alloc, typename Growth>
 template<typename... Ts>
-typename Vector<T>::iterator Vector<T>::Emplace(const_iterator pos, Ts&& ...vs)
+typename SmallVector<T, N, Alloc, Growth>::iterator SmallVector<T, N, Alloc, Growth>::Emplace(const_iterator pos, Ts&& ...vs)
 {
     assert(pos >= begin() && pos <= end());
     if (pos == end())
@@ -400,23 +2199,20 @@ typename Vector<T>::iterator Vector<T>::Emplace(const_iterator pos, Ts&& ...vs)
     }
     iterator result;
     size_t pos_index = pos - begin();
-    if (size_ == data_.Capacity())
+    if (size_ == Capacity())
     {
-        size_t pos_index = pos - begin();
-        size_t new_capacity = size_ == 0 ? 1 : size_ * 2;
-        RawMemory<T> new_data(new_capacity);
+        RawMemory<T, Alloc> new_data(NextCapacity(), heap_.GetAllocator());
         result = new (new_data + pos_index) T(std::forward<Ts>(vs)...);
-        if constexpr (std::is_nothrow_move_constructible_v<T> ||
-            !std::is_copy_constructible_v<T>)
+        if constexpr (kNothrowRelocate)
         {
-            std::uninitialized_move(begin(), begin() + pos_index, new_data.GetAddress());
-            std::uninitialized_move(begin() + pos_index, end(), result + 1);
+            detail::Relocate(Data(), pos_index, new_data.GetAddress());
+            detail::Relocate(Data() + pos_index, size_ - pos_index, result + 1);
         }
         else
         {
             try
             {
-                std::uninitialized_copy(begin(), begin() + pos_index, new_data.GetAddress());
+                detail::UninitializedCopyOrMoveN(Data(), pos_index, new_data.GetAddress());
             }
             catch (...)
             {
@@ -425,40 +2221,42 @@ typename Vector<T>::iterator Vector<T>::Emplace(const_iterator pos, Ts&& ...vs)
             }
             try
             {
-                std::uninitialized_copy(begin() + pos_index, end(), result + 1);
+                detail::UninitializedCopyOrMoveN(Data() + pos_index, size_ - pos_index, result + 1);
             }
             catch (...)
             {
                 std::destroy_n(new_data.GetAddress(), pos_index + 1);
                 throw;
             }
+            std::destroy_n(Data(), size_);
         }
-        std::destroy_n(data_.GetAddress(), size_);
-        data_.Swap(new_data);
+        heap_.Swap(new_data);
     }
     else
     {
-        new (data_ + size_) T(std::move(*(end() - 1)));
+        // Built before anything moves: vs may refer to an element, and if
+        // this throws the vector is still intact
         T buffer(std::forward<Ts>(vs)...);
+        new (end()) T(std::move(*(end() - 1)));
         std::move_backward(begin() + pos_index, end() - 1, end());
-        *(data_ + pos_index) = std::move(buffer);
-        result = data_ + pos_index;
+        *(begin() + pos_index) = std::move(buffer);
+        result = begin() + pos_index;
     }
     ++size_;
     return result;
 }
 
-template<typename T>
+template<typename T, size_t N, typename Alloc, typename Growth>
 template<typename F>
-typename Vector<T>::iterator Vector<T>::Insert(const_iterator pos, F&& value)
+typename SmallVector<T, N, Alloc, Growth>::iterator SmallVector<T, N, Alloc, Growth>::Insert(const_iterator pos, F&& value)
 {
     return Emplace(pos, std::forward<F>(value));
 }
 
-template<typename T>
-typename Vector<T>::iterator Vector<T>::Erase(const_iterator pos) noexcept(std::is_nothrow_move_assignable_v<T>)
+template<typename T, size_t N, typename Alloc, typename Growth>
+typename SmallVector<T, N, Alloc, Growth>::iterator SmallVector<T, N, Alloc, Growth>::Erase(const_iterator pos) noexcept(std::is_nothrow_move_assignable_v<T>)
 {
-    assert(pos >= begin() && pos <= end());
+    assert(pos >= begin() && pos < end());
     size_t pos_index = pos - begin();
     if constexpr (std::is_nothrow_move_constructible_v<T> ||
         !std::is_copy_constructible_v<T>)
@@ -473,3 +2271,72 @@ typename Vector<T>::iterator Vector<T>::Erase(const_iterator pos) noexcept(std::
     --size_;
     return begin() + pos_index;
 }
+
+template<typename T, size_t N, typename Alloc, typename Growth>
+T* SmallVector<T, N, Alloc, Growth>::Data() noexcept
+{
+    return IsInline() ? reinterpret_cast<T*>(inline_) : heap_.GetAddress();
+}
+
+template<typename T, size_t N, typename Alloc, typename Growth>
+const T* SmallVector<T, N, Alloc, Growth>::Data() const noexcept
+{
+    return const_cast<SmallVector&>(*this).Data();
+}
+
+template<typename T, size_t N, typename Alloc, typename Growth>
+size_t SmallVector<T, N, Alloc, Growth>::NextCapacity() const noexcept
+{
+    const size_t new_capacity = Growth::NextCapacity(size_, sizeof(T));
+    assert(new_capacity > size_);
+    return new_capacity;
+}
+
+template<typename T, size_t N, typename Alloc, typename Growth>
+void SmallVector<T, N, Alloc, Growth>::MoveInlineTo(SmallVector& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+{
+    assert(IsInline() && other.size_ == 0);
+    T* to = reinterpret_cast<T*>(other.inline_);
+    std::uninitialized_move_n(Data(), size_, to);
+    std::destroy_n(Data(), size_);
+    other.size_ = std::exchange(size_, 0);
+}
+
+inline std::map<std::string, VectorStats> GetVectorStatsSnapshot()
+{
+    std::map<std::string, VectorStats> snapshot;
+#ifdef VECTOR_ENABLE_STATS
+    detail::VectorStatsRegistry& registry = detail::GetVectorStatsRegistry();
+    std::lock_guard lock(registry.mutex);
+    for (const auto& [tag, counters] : registry.counters)
+    {
+        VectorStats& stats = snapshot[tag];
+        stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+        stats.bytes_allocated = counters.bytes_allocated.load(std::memory_order_relaxed);
+        stats.reallocations = counters.reallocations.load(std::memory_order_relaxed);
+        stats.relocated_bitwise = counters.relocated_bitwise.load(std::memory_order_relaxed);
+        stats.relocated_by_move = counters.relocated_by_move.load(std::memory_order_relaxed);
+        stats.relocated_by_copy = counters.relocated_by_copy.load(std::memory_order_relaxed);
+        stats.peak_capacity_bytes = counters.peak_capacity_bytes.load(std::memory_order_relaxed);
+    }
+#endif
+    return snapshot;
+}
+
+inline void ResetVectorStats()
+{
+#ifdef VECTOR_ENABLE_STATS
+    detail::VectorStatsRegistry& registry = detail::GetVectorStatsRegistry();
+    std::lock_guard lock(registry.mutex);
+    for (auto& [tag, counters] : registry.counters)
+    {
+        counters.allocations.store(0, std::memory_order_relaxed);
+        counters.bytes_allocated.store(0, std::memory_order_relaxed);
+        counters.reallocations.store(0, std::memory_order_relaxed);
+        counters.relocated_bitwise.store(0, std::memory_order_relaxed);
+        counters.relocated_by_move.store(0, std::memory_order_relaxed);
+        counters.relocated_by_copy.store(0, std::memory_order_relaxed);
+        counters.peak_capacity_bytes.store(0, std::memory_order_relaxed);
+    }
+#endif
+}
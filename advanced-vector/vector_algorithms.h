@@ -0,0 +1,383 @@
+#pragma once
+
+#include "vector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+// Vectorized scans and elementwise operations over arithmetic vectors.
+// int32_t and float ranges run SIMD kernels chosen at runtime among SSE2,
+// AVX2 and AVX-512, other arithmetic types fall back to scalar loops.
+// Single-range kernels process a short scalar head until the data is
+// register aligned, so vectors with AlignedAllocator<T, 64> skip it.
+//
+// Float results follow the scalar loop except that Sum adds in a different
+// order, so it can differ in rounding, and MinMax is unspecified with NaNs
+
+enum class SimdLevel { SCALAR, SSE2, AVX2, AVX512 };
+
+enum class ElementwiseOp { ADD, SUBTRACT, MULTIPLY, MIN, MAX };
+
+// Best level the CPU supports, unless lowered by SetSimdLevel
+SimdLevel GetSimdLevel() noexcept;
+// Limits the kernels to level, e.g. to compare them in tests or benchmarks.
+// Levels above what the CPU supports are ignored
+void SetSimdLevel(SimdLevel level) noexcept;
+
+template <typename T>
+void Fill(T* first, size_t count, T value) noexcept;
+// Index of the first element equal to value, count if there is none
+template <typename T>
+size_t Find(const T* first, size_t count, T value) noexcept;
+template <typename T>
+size_t Count(const T* first, size_t count, T value) noexcept;
+
+// 64-bit for integers so that sums of int32_t do not overflow
+template <typename T>
+using SumType = std::conditional_t<std::is_integral_v<T>,
+    std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>, T>;
+
+template <typename T>
+SumType<T> Sum(const T* first, size_t count) noexcept;
+// count must not be 0
+template <typename T>
+std::pair<T, T> MinMax(const T* first, size_t count) noexcept;
+// Index of the first position where the ranges differ, count if they are equal
+template <typename T>
+size_t Mismatch(const T* lhs, const T* rhs, size_t count) noexcept;
+template <typename T>
+bool Equal(const T* lhs, const T* rhs, size_t count) noexcept;
+// Lexicographic comparison, negative, zero or positive like strcmp
+template <typename T>
+int Compare(const T* lhs, size_t lhs_count, const T* rhs, size_t rhs_count) noexcept;
+// out[i] = op(lhs[i], rhs[i]). out may be lhs or rhs
+template <typename T>
+void Transform(const T* lhs, const T* rhs, T* out, size_t count, ElementwiseOp op) noexcept;
+
+template <typename T, typename Alloc, typename Growth>
+void Fill(Vector<T, Alloc, Growth>& v, T value) noexcept;
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::const_iterator Find(const Vector<T, Alloc, Growth>& v, T value) noexcept;
+template <typename T, typename Alloc, typename Growth>
+size_t Count(const Vector<T, Alloc, Growth>& v, T value) noexcept;
+template <typename T, typename Alloc, typename Growth>
+SumType<T> Sum(const Vector<T, Alloc, Growth>& v) noexcept;
+template <typename T, typename Alloc, typename Growth>
+std::pair<T, T> MinMax(const Vector<T, Alloc, Growth>& v) noexcept;
+template <typename T, typename Alloc, typename Growth>
+bool Equal(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs) noexcept;
+template <typename T, typename Alloc, typename Growth>
+int Compare(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs) noexcept;
+// Resizes out to the common size first
+template <typename T, typename Alloc, typename Growth>
+void Transform(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs,
+    Vector<T, Alloc, Growth>& out, ElementwiseOp op);
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define VECTOR_HAS_X86_SIMD 1
+#include <immintrin.h>
+
+// Every copy of the kernels is compiled for its own instruction set, the
+// caller switches between them after checking the CPU
+#define VECTOR_SIMD_NAMESPACE sse2
+#define VECTOR_SIMD_BYTES 16
+#include "vector_algorithms_kernels.h"
+#undef VECTOR_SIMD_NAMESPACE
+#undef VECTOR_SIMD_BYTES
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#ifdef __clang__
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#endif
+#define VECTOR_SIMD_NAMESPACE avx2
+#define VECTOR_SIMD_BYTES 32
+#include "vector_algorithms_kernels.h"
+#undef VECTOR_SIMD_NAMESPACE
+#undef VECTOR_SIMD_BYTES
+#ifdef __clang__
+#pragma clang attribute pop
+#endif
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#ifdef __clang__
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#endif
+#define VECTOR_SIMD_NAMESPACE avx512
+#define VECTOR_SIMD_BYTES 64
+#include "vector_algorithms_kernels.h"
+#undef VECTOR_SIMD_NAMESPACE
+#undef VECTOR_SIMD_BYTES
+#ifdef __clang__
+#pragma clang attribute pop
+#endif
+#pragma GCC pop_options
+#endif
+
+namespace detail {
+
+template <typename T>
+inline constexpr bool kSimdElement =
+#ifdef VECTOR_HAS_X86_SIMD
+    std::is_same_v<T, int32_t> || std::is_same_v<T, float>;
+#else
+    false;
+#endif
+
+inline SimdLevel DetectSimdLevel() noexcept
+{
+#ifdef VECTOR_HAS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE2;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+inline std::atomic<SimdLevel>& CurrentSimdLevel() noexcept
+{
+    static std::atomic<SimdLevel> level = DetectSimdLevel();
+    return level;
+}
+
+}  // namespace detail
+
+// Calls detail::<level>::call for the current level. The caller handles SCALAR
+#ifdef VECTOR_HAS_X86_SIMD
+#define VECTOR_SIMD_DISPATCH(call)                                        \
+    switch (detail::CurrentSimdLevel().load(std::memory_order_relaxed))   \
+    {                                                                     \
+    case SimdLevel::AVX512:                                               \
+        return detail::avx512::call;                                      \
+    case SimdLevel::AVX2:                                                 \
+        return detail::avx2::call;                                        \
+    default:                                                              \
+        return detail::sse2::call;                                        \
+    }
+#else
+#define VECTOR_SIMD_DISPATCH(call)
+#endif
+
+inline SimdLevel GetSimdLevel() noexcept
+{
+    return detail::CurrentSimdLevel().load(std::memory_order_relaxed);
+}
+
+inline void SetSimdLevel(SimdLevel level) noexcept
+{
+    const SimdLevel supported = detail::DetectSimdLevel();
+    detail::CurrentSimdLevel().store(level < supported ? level : supported, std::memory_order_relaxed);
+}
+
+template <typename T>
+void Fill(T* first, size_t count, T value) noexcept
+{
+    static_assert(std::is_arithmetic_v<T>);
+    if constexpr (detail::kSimdElement<T>)
+    {
+        if (GetSimdLevel() != SimdLevel::SCALAR)
+        {
+            VECTOR_SIMD_DISPATCH(Fill(first, count, value))
+        }
+    }
+    std::fill_n(first, count, value);
+}
+
+template <typename T>
+size_t Find(const T* first, size_t count, T value) noexcept
+{
+    static_assert(std::is_arithmetic_v<T>);
+    if constexpr (detail::kSimdElement<T>)
+    {
+        if (GetSimdLevel() != SimdLevel::SCALAR)
+        {
+            VECTOR_SIMD_DISPATCH(Find(first, count, value))
+        }
+    }
+    return std::find(first, first + count, value) - first;
+}
+
+template <typename T>
+size_t Count(const T* first, size_t count, T value) noexcept
+{
+    static_assert(std::is_arithmetic_v<T>);
+    if constexpr (detail::kSimdElement<T>)
+    {
+        if (GetSimdLevel() != SimdLevel::SCALAR)
+        {
+            VECTOR_SIMD_DISPATCH(Count(first, count, value))
+        }
+    }
+    return std::count(first, first + count, value);
+}
+
+template <typename T>
+SumType<T> Sum(const T* first, size_t count) noexcept
+{
+    static_assert(std::is_arithmetic_v<T>);
+    if constexpr (detail::kSimdElement<T>)
+    {
+        if (GetSimdLevel() != SimdLevel::SCALAR)
+        {
+            VECTOR_SIMD_DISPATCH(Sum(first, count))
+        }
+    }
+    SumType<T> result = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        result += first[i];
+    }
+    return result;
+}
+
+template <typename T>
+std::pair<T, T> MinMax(const T* first, size_t count) noexcept
+{
+    static_assert(std::is_arithmetic_v<T>);
+    assert(count > 0);
+    if constexpr (detail::kSimdElement<T>)
+    {
+        if (GetSimdLevel() != SimdLevel::SCALAR)
+        {
+            VECTOR_SIMD_DISPATCH(MinMax(first, count))
+        }
+    }
+    const auto [min, max] = std::minmax_element(first, first + count);
+    return {*min, *max};
+}
+
+template <typename T>
+size_t Mismatch(const T* lhs, const T* rhs, size_t count) noexcept
+{
+    static_assert(std::is_arithmetic_v<T>);
+    if constexpr (detail::kSimdElement<T>)
+    {
+        if (GetSimdLevel() != SimdLevel::SCALAR)
+        {
+            VECTOR_SIMD_DISPATCH(Mismatch(lhs, rhs, count))
+        }
+    }
+    return std::mismatch(lhs, lhs + count, rhs).first - lhs;
+}
+
+template <typename T>
+bool Equal(const T* lhs, const T* rhs, size_t count) noexcept
+{
+    return Mismatch(lhs, rhs, count) == count;
+}
+
+template <typename T>
+int Compare(const T* lhs, size_t lhs_count, const T* rhs, size_t rhs_count) noexcept
+{
+    const size_t common = std::min(lhs_count, rhs_count);
+    const size_t index = Mismatch(lhs, rhs, common);
+    if (index < common)
+    {
+        // NaN is neither less nor greater and compares as equal here
+        return lhs[index] < rhs[index] ? -1 : (rhs[index] < lhs[index] ? 1 : 0);
+    }
+    return lhs_count < rhs_count ? -1 : (rhs_count < lhs_count ? 1 : 0);
+}
+
+template <typename T>
+void Transform(const T* lhs, const T* rhs, T* out, size_t count, ElementwiseOp op) noexcept
+{
+    static_assert(std::is_arithmetic_v<T>);
+    if constexpr (detail::kSimdElement<T>)
+    {
+        if (GetSimdLevel() != SimdLevel::SCALAR)
+        {
+            VECTOR_SIMD_DISPATCH(Transform(lhs, rhs, out, count, op))
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        switch (op)
+        {
+        case ElementwiseOp::ADD:
+            out[i] = lhs[i] + rhs[i];
+            break;
+        case ElementwiseOp::SUBTRACT:
+            out[i] = lhs[i] - rhs[i];
+            break;
+        case ElementwiseOp::MULTIPLY:
+            out[i] = lhs[i] * rhs[i];
+            break;
+        case ElementwiseOp::MIN:
+            out[i] = std::min(lhs[i], rhs[i]);
+            break;
+        case ElementwiseOp::MAX:
+            out[i] = std::max(lhs[i], rhs[i]);
+            break;
+        }
+    }
+}
+
+#undef VECTOR_SIMD_DISPATCH
+
+template <typename T, typename Alloc, typename Growth>
+void Fill(Vector<T, Alloc, Growth>& v, T value) noexcept
+{
+    Fill(v.begin(), v.Size(), value);
+}
+
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::const_iterator Find(const Vector<T, Alloc, Growth>& v, T value) noexcept
+{
+    return v.begin() + Find(v.begin(), v.Size(), value);
+}
+
+template <typename T, typename Alloc, typename Growth>
+size_t Count(const Vector<T, Alloc, Growth>& v, T value) noexcept
+{
+    return Count(v.begin(), v.Size(), value);
+}
+
+template <typename T, typename Alloc, typename Growth>
+SumType<T> Sum(const Vector<T, Alloc, Growth>& v) noexcept
+{
+    return Sum(v.begin(), v.Size());
+}
+
+template <typename T, typename Alloc, typename Growth>
+std::pair<T, T> MinMax(const Vector<T, Alloc, Growth>& v) noexcept
+{
+    return MinMax(v.begin(), v.Size());
+}
+
+template <typename T, typename Alloc, typename Growth>
+bool Equal(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs) noexcept
+{
+    return lhs.Size() == rhs.Size() && Equal(lhs.begin(), rhs.begin(), lhs.Size());
+}
+
+template <typename T, typename Alloc, typename Growth>
+int Compare(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs) noexcept
+{
+    return Compare(lhs.begin(), lhs.Size(), rhs.begin(), rhs.Size());
+}
+
+template <typename T, typename Alloc, typename Growth>
+void Transform(const Vector<T, Alloc, Growth>& lhs, const Vector<T, Alloc, Growth>& rhs,
+    Vector<T, Alloc, Growth>& out, ElementwiseOp op)
+{
+    const size_t count = std::min(lhs.Size(), rhs.Size());
+    // Only shrinks out if it is one of the inputs
+    out.ResizeDefaultInit(count);
+    Transform(lhs.begin(), rhs.begin(), out.begin(), count, op);
+}
@@ -0,0 +1,317 @@
+// Kernels of vector_algorithms.h written once with GCC vector extensions.
+// Included several times, each time compiled for another instruction set:
+//     VECTOR_SIMD_NAMESPACE  namespace of this copy inside detail
+//     VECTOR_SIMD_BYTES      register width, 16, 32 or 64
+// No include guard on purpose
+
+namespace detail {
+namespace VECTOR_SIMD_NAMESPACE {
+
+inline constexpr size_t kBytes = VECTOR_SIMD_BYTES;
+
+typedef int32_t VecI32 __attribute__((vector_size(kBytes)));
+typedef float VecF32 __attribute__((vector_size(kBytes)));
+typedef int64_t VecI64x2 __attribute__((vector_size(kBytes * 2)));
+
+template <typename T>
+struct VecOf;
+
+template <>
+struct VecOf<int32_t> {
+    using Type = VecI32;
+};
+
+template <>
+struct VecOf<float> {
+    using Type = VecF32;
+};
+
+template <typename T>
+using Vec = typename VecOf<T>::Type;
+
+template <typename T>
+inline constexpr size_t kLanes = kBytes / sizeof(T);
+
+template <typename T>
+inline Vec<T> Load(const T* p) noexcept
+{
+    Vec<T> v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template <typename T>
+inline Vec<T> LoadAligned(const T* p) noexcept
+{
+    Vec<T> v;
+    std::memcpy(&v, __builtin_assume_aligned(p, kBytes), sizeof(v));
+    return v;
+}
+
+template <typename T>
+inline void StoreAligned(T* p, Vec<T> v) noexcept
+{
+    std::memcpy(__builtin_assume_aligned(p, kBytes), &v, sizeof(v));
+}
+
+template <typename T>
+inline void Store(T* p, Vec<T> v) noexcept
+{
+    std::memcpy(p, &v, sizeof(v));
+}
+
+template <typename T>
+inline Vec<T> Broadcast(T value) noexcept
+{
+    return Vec<T>{} + value;
+}
+
+// Bit i is set if lane i of the comparison result is true
+inline uint64_t MaskBits(VecI32 mask) noexcept
+{
+#if VECTOR_SIMD_BYTES == 16
+    return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(reinterpret_cast<__m128i>(mask))));
+#elif VECTOR_SIMD_BYTES == 32
+    return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(reinterpret_cast<__m256i>(mask))));
+#else
+    return _mm512_cmpneq_epi32_mask(reinterpret_cast<__m512i>(mask), _mm512_setzero_si512());
+#endif
+}
+
+// Number of leading elements to process one by one until p is register aligned
+template <typename T>
+inline size_t HeadCount(const T* p, size_t count) noexcept
+{
+    const size_t misalignment = reinterpret_cast<uintptr_t>(p) % kBytes;
+    return std::min(count, (kBytes - misalignment) % kBytes / sizeof(T));
+}
+
+template <typename T>
+void Fill(T* first, size_t count, T value) noexcept
+{
+    const size_t head = HeadCount(first, count);
+    std::fill_n(first, head, value);
+    const Vec<T> v = Broadcast(value);
+    size_t i = head;
+    for (; i + kLanes<T> <= count; i += kLanes<T>)
+    {
+        StoreAligned(first + i, v);
+    }
+    std::fill(first + i, first + count, value);
+}
+
+template <typename T>
+size_t Find(const T* first, size_t count, T value) noexcept
+{
+    const size_t head = HeadCount(first, count);
+    for (size_t i = 0; i < head; ++i)
+    {
+        if (first[i] == value)
+        {
+            return i;
+        }
+    }
+    const Vec<T> needle = Broadcast(value);
+    size_t i = head;
+    for (; i + kLanes<T> <= count; i += kLanes<T>)
+    {
+        const uint64_t bits = MaskBits(LoadAligned(first + i) == needle);
+        if (bits != 0)
+        {
+            return i + __builtin_ctzll(bits);
+        }
+    }
+    for (; i < count; ++i)
+    {
+        if (first[i] == value)
+        {
+            return i;
+        }
+    }
+    return count;
+}
+
+template <typename T>
+size_t Count(const T* first, size_t count, T value) noexcept
+{
+    const size_t head = HeadCount(first, count);
+    size_t result = std::count(first, first + head, value);
+    const Vec<T> needle = Broadcast(value);
+    size_t i = head;
+    while (i + kLanes<T> <= count)
+    {
+        // Lanes count down from 0 by the -1 of every match. Flush before they can overflow
+        VecI32 lanes{};
+        const size_t block_end = std::min(count - (count - i) % kLanes<T>, i + (size_t{1} << 30) * kLanes<T>);
+        for (; i < block_end; i += kLanes<T>)
+        {
+            lanes += LoadAligned(first + i) == needle;
+        }
+        for (size_t lane = 0; lane < kLanes<T>; ++lane)
+        {
+            result -= static_cast<int64_t>(lanes[lane]);
+        }
+    }
+    return result + std::count(first + i, first + count, value);
+}
+
+inline int64_t Sum(const int32_t* first, size_t count) noexcept
+{
+    const size_t head = HeadCount(first, count);
+    int64_t result = 0;
+    for (size_t i = 0; i < head; ++i)
+    {
+        result += first[i];
+    }
+    VecI64x2 sum{};
+    size_t i = head;
+    for (; i + kLanes<int32_t> <= count; i += kLanes<int32_t>)
+    {
+        sum += __builtin_convertvector(LoadAligned(first + i), VecI64x2);
+    }
+    for (size_t lane = 0; lane < kLanes<int32_t>; ++lane)
+    {
+        result += sum[lane];
+    }
+    for (; i < count; ++i)
+    {
+        result += first[i];
+    }
+    return result;
+}
+
+inline float Sum(const float* first, size_t count) noexcept
+{
+    const size_t head = HeadCount(first, count);
+    float result = 0;
+    for (size_t i = 0; i < head; ++i)
+    {
+        result += first[i];
+    }
+    // Two accumulators hide the latency of the additions
+    constexpr size_t lanes = kLanes<float>;
+    VecF32 sum0{};
+    VecF32 sum1{};
+    size_t i = head;
+    for (; i + 2 * lanes <= count; i += 2 * lanes)
+    {
+        sum0 += LoadAligned(first + i);
+        sum1 += LoadAligned(first + i + lanes);
+    }
+    if (i + lanes <= count)
+    {
+        sum0 += LoadAligned(first + i);
+        i += lanes;
+    }
+    sum0 += sum1;
+    for (size_t lane = 0; lane < lanes; ++lane)
+    {
+        result += sum0[lane];
+    }
+    for (; i < count; ++i)
+    {
+        result += first[i];
+    }
+    return result;
+}
+
+template <typename T>
+std::pair<T, T> MinMax(const T* first, size_t count) noexcept
+{
+    T min = first[0];
+    T max = first[0];
+    const auto update = [&min, &max](T value) {
+        min = value < min ? value : min;
+        max = max < value ? value : max;
+    };
+    const size_t head = HeadCount(first, count);
+    for (size_t i = 0; i < head; ++i)
+    {
+        update(first[i]);
+    }
+    Vec<T> vmin = Broadcast(min);
+    Vec<T> vmax = vmin;
+    size_t i = head;
+    for (; i + kLanes<T> <= count; i += kLanes<T>)
+    {
+        const Vec<T> v = LoadAligned(first + i);
+        vmin = v < vmin ? v : vmin;
+        vmax = vmax < v ? v : vmax;
+    }
+    for (size_t lane = 0; lane < kLanes<T>; ++lane)
+    {
+        update(vmin[lane]);
+        update(vmax[lane]);
+    }
+    for (; i < count; ++i)
+    {
+        update(first[i]);
+    }
+    return {min, max};
+}
+
+template <typename T>
+size_t Mismatch(const T* lhs, const T* rhs, size_t count) noexcept
+{
+    size_t i = 0;
+    for (; i + kLanes<T> <= count; i += kLanes<T>)
+    {
+        const uint64_t bits = MaskBits(Load(lhs + i) != Load(rhs + i));
+        if (bits != 0)
+        {
+            return i + __builtin_ctzll(bits);
+        }
+    }
+    for (; i < count; ++i)
+    {
+        if (lhs[i] != rhs[i])
+        {
+            return i;
+        }
+    }
+    return count;
+}
+
+template <typename T, typename Op, typename VecOp>
+void Transform(const T* lhs, const T* rhs, T* out, size_t count, Op op, VecOp vec_op) noexcept
+{
+    const size_t vector_end = count - count % kLanes<T>;
+    size_t i = 0;
+    for (; i < vector_end; i += kLanes<T>)
+    {
+        Store(out + i, vec_op(Load(lhs + i), Load(rhs + i)));
+    }
+    for (; i < count; ++i)
+    {
+        out[i] = op(lhs[i], rhs[i]);
+    }
+}
+
+template <typename T>
+void Transform(const T* lhs, const T* rhs, T* out, size_t count, ElementwiseOp op) noexcept
+{
+    const auto apply = [&](auto f) {
+        Transform(lhs, rhs, out, count, f, f);
+    };
+    switch (op)
+    {
+    case ElementwiseOp::ADD:
+        apply([](auto a, auto b) { return a + b; });
+        break;
+    case ElementwiseOp::SUBTRACT:
+        apply([](auto a, auto b) { return a - b; });
+        break;
+    case ElementwiseOp::MULTIPLY:
+        apply([](auto a, auto b) { return a * b; });
+        break;
+    case ElementwiseOp::MIN:
+        apply([](auto a, auto b) { return b < a ? b : a; });
+        break;
+    case ElementwiseOp::MAX:
+        apply([](auto a, auto b) { return a < b ? b : a; });
+        break;
+    }
+}
+
+}  // namespace VECTOR_SIMD_NAMESPACE
+}  // namespace detail